@@ -21,12 +21,14 @@
 
 #include <stdbool.h>
 #include <stddef.h>
+#include <stdint.h>
 
 enum al_status {
     AL_OK = 0,
     AL_ERROR = 1,
     AL_NOTIMPLEMENTED = 2,
     AL_NOMEMORY = 3,
+    AL_TIMEOUT = 4,
 };
 
 static inline
@@ -42,6 +44,8 @@ al_status_string(enum al_status status)
             return "AL_NOTIMPLEMENTED";
         case AL_NOMEMORY:
             return "AL_NOMEMORY";
+        case AL_TIMEOUT:
+            return "AL_TIMEOUT";
     }
 }
 
@@ -57,6 +61,11 @@ enum al_camera_facing {
     AL_CAMERA_FACING_BACK = 1,
 };
 
+enum al_stream_format {
+    AL_STREAM_FORMAT_NV12 = 0,
+    AL_STREAM_FORMAT_MJPEG = 1,
+};
+
 void __attribute__((constructor)) al_init(void);
 
 extern const char *const copyright;
@@ -73,6 +82,7 @@ int al_display_orientation(void);
 char *al_net_get_local_ip_address(void);
 
 struct al_camera;
+struct al_image;
 enum al_status al_camera_new(struct al_camera **, size_t, size_t, size_t);
 void al_camera_free(struct al_camera *);
 void al_camera_start(struct al_camera *);
@@ -82,10 +92,57 @@ enum al_status al_camera_get_color_format(struct al_camera *, enum al_color_form
 enum al_status al_camera_get_width(struct al_camera *, size_t *);
 enum al_status al_camera_get_height(struct al_camera *, size_t *);
 enum al_status al_camera_get_data(struct al_camera *, enum al_color_format, void **);
+enum al_status al_camera_get_image(struct al_camera *, enum al_color_format, struct al_image *);
 enum al_status al_camera_get_rgba(struct al_camera *, void **);
 enum al_status al_camera_get_facing(struct al_camera *, enum al_camera_facing *);
 enum al_status al_camera_get_orientation(struct al_camera *, int *);
 enum al_status al_camera_set_stride(struct al_camera *, size_t);
+enum al_status al_camera_read_into(struct al_camera *, enum al_color_format, struct al_image *, int);
+enum al_status al_camera_copy_into(struct al_camera *, enum al_color_format, struct al_image *, uint64_t *);
+enum al_status al_camera_get_fd(struct al_camera *, int *);
+enum al_status al_camera_wait(struct al_camera *, int);
+
+struct al_camera_stats {
+    uint64_t frames; // made available by the camera
+    uint64_t delivered; // read by al_camera_get_rgba or al_camera_read_into
+    uint64_t dropped; // lost before they could be made available
+    uint64_t unread; // replaced by the next frame before being read
+    uint64_t bytes_copied;
+    uint64_t process_ns; // the whole frame callback
+    uint64_t process_max_ns;
+    uint64_t repack_ns; // copying the planes
+    uint64_t repack_max_ns;
+    uint64_t convert_ns; // YUV to RGBA
+    uint64_t convert_max_ns;
+    uint64_t latency_ns; // from capture to delivery, of every frame delivered
+};
+enum al_status al_camera_get_stats(struct al_camera *, struct al_camera_stats *);
+
+struct al_camera_frame {
+    uint64_t sequence; // from 1
+    uint64_t timestamp; // capture time, in nanoseconds
+};
+enum al_status al_camera_get_frame(struct al_camera *, struct al_camera_frame *);
+enum al_status al_camera_get_latency(struct al_camera *, double, uint64_t *);
+enum al_status al_camera_get_latency_histogram(struct al_camera *, const uint64_t *, uint64_t *, size_t);
+
+enum al_status al_trace_flush(const char *);
+
+struct al_memory_stats {
+    uint64_t bytes; // in image buffers allocated by libal
+    uint64_t buffers;
+    uint64_t peak_bytes;
+    uint64_t allocations; // since the start
+};
+enum al_status al_memory_get_stats(struct al_memory_stats *);
+enum al_status al_camera_get_memory(struct al_camera *, struct al_memory_stats *);
+
+struct al_metrics;
+enum al_status al_metrics_new(struct al_metrics **, const char *, int);
+void al_metrics_free(struct al_metrics *);
+enum al_status al_metrics_get_port(struct al_metrics *, int *);
+enum al_status al_metrics_add_camera(struct al_metrics *, struct al_camera *, const char *);
+enum al_status al_metrics_remove_camera(struct al_metrics *, struct al_camera *);
 
 struct al_image {
     size_t width;
@@ -95,7 +152,42 @@ struct al_image {
     enum al_color_format format;
 };
 enum al_status al_image_alloc(struct al_image *);
+#define AL_IMAGE_PADDING 64
+enum al_status al_image_alloc_padded(struct al_image *);
+// The data of an image given to al_image_alloc* or al_image_free must be
+// NULL or from al_image_alloc*: libal keeps a header before it. Memory
+// the caller allocated or borrowed may be read and written through
+// struct al_image, but not freed by libal.
 void al_image_free(struct al_image *);
 enum al_status al_image_convert(const struct al_image *, struct al_image *);
 enum al_status al_image_rotate(struct al_image *, struct al_image *, int);
 enum al_status al_image_copy(const struct al_image *, struct al_image *);
+enum al_status al_image_resize(const struct al_image *, struct al_image *);
+
+enum al_image_output {
+    AL_IMAGE_OUTPUT_AUTO = 0, // STREAM copies larger than half the cache
+    AL_IMAGE_OUTPUT_STREAM = 1, // non-temporal stores, not read again soon
+    AL_IMAGE_OUTPUT_CACHE = 2, // read next on this core
+};
+enum al_status al_image_copy_output(const struct al_image *, struct al_image *, enum al_image_output);
+enum al_status al_image_convert_output(const struct al_image *, struct al_image *, enum al_image_output);
+
+enum al_image_operation {
+    AL_IMAGE_COPY = 0,
+    AL_IMAGE_CONVERT = 1,
+    AL_IMAGE_RESIZE = 2,
+    AL_IMAGE_ROTATE = 3,
+};
+struct al_image_op {
+    enum al_image_operation operation;
+    int degrees; // AL_IMAGE_ROTATE
+};
+enum al_status al_image_batch(const struct al_image_op *, struct al_image *, struct al_image *, size_t);
+
+struct al_stream;
+enum al_status al_stream_new(struct al_stream **, enum al_stream_format, const char *, int);
+void al_stream_free(struct al_stream *);
+enum al_status al_stream_get_port(struct al_stream *, int *);
+enum al_status al_stream_poll(struct al_stream *, int);
+enum al_status al_stream_send(struct al_stream *, const struct al_image *);
+enum al_status al_stream_send_camera(struct al_stream *, struct al_camera *);
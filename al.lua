@@ -59,6 +59,7 @@ enum al_status {
     AL_ERROR = 1,
     AL_NOTIMPLEMENTED = 2,
     AL_NOMEMORY = 3,
+    AL_TIMEOUT = 4,
 };
 
 enum al_color_format {
@@ -73,6 +74,11 @@ enum al_camera_facing {
     AL_CAMERA_FACING_BACK = 1,
 };
 
+enum al_stream_format {
+    AL_STREAM_FORMAT_NV12 = 0,
+    AL_STREAM_FORMAT_MJPEG = 1,
+};
+
 void al_init(void);
 
 extern const char *const copyright;
@@ -89,6 +95,7 @@ int al_display_orientation(void);
 char *al_net_get_local_ip_address(void);
 
 struct al_camera;
+struct al_image;
 enum al_status al_camera_new(struct al_camera **, size_t, size_t, size_t);
 void al_camera_free(struct al_camera *);
 void al_camera_start(struct al_camera *);
@@ -98,10 +105,57 @@ enum al_status al_camera_get_color_format(struct al_camera *, enum al_color_form
 enum al_status al_camera_get_width(struct al_camera *, size_t *);
 enum al_status al_camera_get_height(struct al_camera *, size_t *);
 enum al_status al_camera_get_data(struct al_camera *, enum al_color_format, void **);
+enum al_status al_camera_get_image(struct al_camera *, enum al_color_format, struct al_image *);
 enum al_status al_camera_get_rgba(struct al_camera *, void **);
 enum al_status al_camera_get_facing(struct al_camera *, enum al_camera_facing *);
 enum al_status al_camera_get_orientation(struct al_camera *, int *);
 enum al_status al_camera_set_stride(struct al_camera *, size_t);
+enum al_status al_camera_read_into(struct al_camera *, enum al_color_format, struct al_image *, int);
+enum al_status al_camera_copy_into(struct al_camera *, enum al_color_format, struct al_image *, uint64_t *);
+enum al_status al_camera_get_fd(struct al_camera *, int *);
+enum al_status al_camera_wait(struct al_camera *, int);
+
+struct al_camera_stats {
+    uint64_t frames;
+    uint64_t delivered;
+    uint64_t dropped;
+    uint64_t unread;
+    uint64_t bytes_copied;
+    uint64_t process_ns;
+    uint64_t process_max_ns;
+    uint64_t repack_ns;
+    uint64_t repack_max_ns;
+    uint64_t convert_ns;
+    uint64_t convert_max_ns;
+    uint64_t latency_ns; // from capture to delivery, of every frame delivered
+};
+enum al_status al_camera_get_stats(struct al_camera *, struct al_camera_stats *);
+
+struct al_camera_frame {
+    uint64_t sequence;
+    uint64_t timestamp;
+};
+enum al_status al_camera_get_frame(struct al_camera *, struct al_camera_frame *);
+enum al_status al_camera_get_latency(struct al_camera *, double, uint64_t *);
+enum al_status al_camera_get_latency_histogram(struct al_camera *, const uint64_t *, uint64_t *, size_t);
+
+enum al_status al_trace_flush(const char *);
+
+struct al_memory_stats {
+    uint64_t bytes; // in image buffers allocated by libal
+    uint64_t buffers;
+    uint64_t peak_bytes;
+    uint64_t allocations; // since the start
+};
+enum al_status al_memory_get_stats(struct al_memory_stats *);
+enum al_status al_camera_get_memory(struct al_camera *, struct al_memory_stats *);
+
+struct al_metrics;
+enum al_status al_metrics_new(struct al_metrics **, const char *, int);
+void al_metrics_free(struct al_metrics *);
+enum al_status al_metrics_get_port(struct al_metrics *, int *);
+enum al_status al_metrics_add_camera(struct al_metrics *, struct al_camera *, const char *);
+enum al_status al_metrics_remove_camera(struct al_metrics *, struct al_camera *);
 
 struct al_image {
     size_t width;
@@ -111,16 +165,47 @@ struct al_image {
     enum al_color_format format;
 };
 enum al_status al_image_alloc(struct al_image *);
+enum al_status al_image_alloc_padded(struct al_image *);
 void al_image_free(struct al_image *);
 enum al_status al_image_convert(const struct al_image *, struct al_image *);
 enum al_status al_image_rotate(struct al_image *, struct al_image *, int);
 enum al_status al_image_copy(const struct al_image *, struct al_image *);
+enum al_status al_image_resize(const struct al_image *, struct al_image *);
+
+enum al_image_output {
+    AL_IMAGE_OUTPUT_AUTO = 0,
+    AL_IMAGE_OUTPUT_STREAM = 1,
+    AL_IMAGE_OUTPUT_CACHE = 2,
+};
+enum al_status al_image_copy_output(const struct al_image *, struct al_image *, enum al_image_output);
+enum al_status al_image_convert_output(const struct al_image *, struct al_image *, enum al_image_output);
+
+enum al_image_operation {
+    AL_IMAGE_COPY = 0,
+    AL_IMAGE_CONVERT = 1,
+    AL_IMAGE_RESIZE = 2,
+    AL_IMAGE_ROTATE = 3,
+};
+struct al_image_op {
+    enum al_image_operation operation;
+    int degrees;
+};
+enum al_status al_image_batch(const struct al_image_op *, struct al_image *, struct al_image *, size_t);
+
+struct al_stream;
+enum al_status al_stream_new(struct al_stream **, enum al_stream_format, const char *, int);
+void al_stream_free(struct al_stream *);
+enum al_status al_stream_get_port(struct al_stream *, int *);
+enum al_status al_stream_poll(struct al_stream *, int);
+enum al_status al_stream_send(struct al_stream *, const struct al_image *);
+enum al_status al_stream_send_camera(struct al_stream *, struct al_camera *);
 ]])
 
 al.OK = 0
 al.ERROR = 1
 al.NOTIMPLEMENTED = 2
 al.NOMEMORY = 3
+al.TIMEOUT = 4
 
 al.COLOR_FORMAT_UNKNOWN = 0
 al.COLOR_FORMAT_YUV420SP = 1
@@ -130,6 +215,19 @@ al.COLOR_FORMAT_RGBA = 3
 al.CAMERA_FACING_FRONT = 0
 al.CAMERA_FACING_BACK = 1
 
+al.STREAM_FORMAT_NV12 = 0
+al.STREAM_FORMAT_MJPEG = 1
+
+al.IMAGE_COPY = 0
+al.IMAGE_CONVERT = 1
+al.IMAGE_RESIZE = 2
+al.IMAGE_ROTATE = 3
+al.IMAGE_PADDING = 64
+
+al.IMAGE_OUTPUT_AUTO = 0
+al.IMAGE_OUTPUT_STREAM = 1
+al.IMAGE_OUTPUT_CACHE = 2
+
 al.platform = ffi.string(libal.platform)
 
 function al.init()
@@ -194,6 +292,37 @@ function al.libdir()
     return ffi.string(dir)
 end
 
+-- Write the trace of the frame pipeline to a file for chrome://tracing,
+-- by default at $AL_TRACE_FILE (only if libal was built with TRACE=1).
+-- Returns true, or false and the status.
+function al.trace_flush(path)
+    local status = libal.al_trace_flush(path)
+    if status == al.OK then
+        return true
+    end
+    return false, tonumber(status)
+end
+
+local function memory_stats(stats)
+    return {
+        bytes = tonumber(stats.bytes),
+        buffers = tonumber(stats.buffers),
+        peak_bytes = tonumber(stats.peak_bytes),
+        allocations = tonumber(stats.allocations),
+    }
+end
+
+-- Return the memory held by all the image buffers allocated by libal as a
+-- table of numbers (see struct al_memory_stats in al.h), or nil.
+function al.memory()
+    local stats = ffi.new('struct al_memory_stats')
+    local status = libal.al_memory_get_stats(stats)
+    if status ~= al.OK then
+        return nil
+    end
+    return memory_stats(stats)
+end
+
 al.permissions = {}
 
 if al.platform == 'android' then
@@ -385,8 +514,376 @@ function al.camera.stride(camera, stride)
     libal.al_camera_set_stride(camera, stride)
 end
 
+-- Return a file descriptor that becomes readable when a new frame
+-- arrives, for use with an event loop. Drain it before reading the frame.
+function al.camera.fd(camera)
+    local fd = ffi.new('int [1]')
+    local status = libal.al_camera_get_fd(camera, fd)
+    if status == al.OK then
+        return tonumber(fd[0])
+    end
+    return nil
+end
+
+-- Wait at most timeout milliseconds (forever if negative, default) for a
+-- new frame, without consuming it. Returns true, or false and the status.
+function al.camera.wait(camera, timeout)
+    local status = libal.al_camera_wait(camera, timeout or -1)
+    if status == al.OK then
+        return true
+    end
+    return false, tonumber(status)
+end
+
+-- Return the pipeline statistics of the camera as a table of numbers
+-- (see struct al_camera_stats in al.h), or nil.
+function al.camera.stats(camera)
+    local stats = ffi.new('struct al_camera_stats')
+    local status = libal.al_camera_get_stats(camera, stats)
+    if status ~= al.OK then
+        return nil
+    end
+    return {
+        frames = tonumber(stats.frames),
+        delivered = tonumber(stats.delivered),
+        dropped = tonumber(stats.dropped),
+        unread = tonumber(stats.unread),
+        bytes_copied = tonumber(stats.bytes_copied),
+        process_ns = tonumber(stats.process_ns),
+        process_max_ns = tonumber(stats.process_max_ns),
+        repack_ns = tonumber(stats.repack_ns),
+        repack_max_ns = tonumber(stats.repack_max_ns),
+        convert_ns = tonumber(stats.convert_ns),
+        convert_max_ns = tonumber(stats.convert_max_ns),
+        latency_ns = tonumber(stats.latency_ns),
+    }
+end
+
+-- Return the memory held by the image buffers of the camera, like
+-- al.memory, or nil.
+function al.camera.memory(camera)
+    local stats = ffi.new('struct al_memory_stats')
+    local status = libal.al_camera_get_memory(camera, stats)
+    if status ~= al.OK then
+        return nil
+    end
+    return memory_stats(stats)
+end
+
+-- Return the sequence number (from 1) and capture timestamp (in
+-- nanoseconds) of the last frame read, or nil.
+function al.camera.frame(camera)
+    local frame = ffi.new('struct al_camera_frame')
+    local status = libal.al_camera_get_frame(camera, frame)
+    if status ~= al.OK then
+        return nil
+    end
+    return tonumber(frame.sequence), tonumber(frame.timestamp)
+end
+
+-- Return a percentile (0 to 100, default 50) of the latency from capture
+-- to delivery of the frames read so far, in nanoseconds, or nil.
+function al.camera.latency(camera, percentile)
+    local ns = ffi.new('uint64_t [1]')
+    local status = libal.al_camera_get_latency(camera, percentile or 50, ns)
+    if status ~= al.OK then
+        return nil
+    end
+    return tonumber(ns[0])
+end
+
+-- Iterate over new frames, sleeping in libal between them:
+--
+--     for frame in al.camera.frames(camera) do ... end
+--
+-- Each frame is the RGBA pointer from al.camera.rgba, or the image if
+-- given (a struct al_image, see al.camera.read_into). Waits at most
+-- timeout milliseconds for each frame (forever if negative, default);
+-- on timeout, yields if called from a coroutine, so that a scheduler
+-- can run other work and resume it, and otherwise ends the loop.
+function al.camera.frames(camera, timeout, image)
+    timeout = timeout or -1
+    return function()
+        while true do
+            local ok, status
+            if image ~= nil then
+                ok, status = al.camera.read_into(camera, image, timeout)
+                if ok then
+                    return image
+                end
+            else
+                ok, status = al.camera.wait(camera, timeout)
+                if ok then
+                    local frame = al.camera.rgba(camera)
+                    if frame ~= nil then
+                        return frame
+                    end
+                end
+            end
+            if not ok then
+                if status ~= al.TIMEOUT then
+                    return nil
+                end
+                local co, main = coroutine.running()
+                if co == nil or main then
+                    return nil
+                end
+                coroutine.yield()
+            end
+        end
+    end
+end
+
+-- Read the next frame into image, a preallocated struct al_image (cdata)
+-- of the camera's size, converting it to the image's format.
+-- Waits at most timeout milliseconds (forever if negative, default 0).
+-- Returns true, or false and the status (al.TIMEOUT if there was no frame).
+function al.camera.read_into(camera, image, timeout)
+    local status = libal.al_camera_read_into(
+        camera,
+        image.format,
+        image,
+        timeout or 0
+    )
+    if status == al.OK then
+        return true
+    end
+    return false, tonumber(status)
+end
+
+al.stream = {}
+
+function al.stream.new(format, address, port)
+    local p = ffi.new('struct al_stream *[1]')
+    local status = libal.al_stream_new(
+        p,
+        format or al.STREAM_FORMAT_MJPEG,
+        address,
+        port or 0
+    )
+    if status == al.OK then
+        return p[0]
+    else
+        return nil
+    end
+end
+
+function al.stream.free(stream)
+    if stream == nil then
+        return
+    end
+    libal.al_stream_free(stream)
+end
+
+function al.stream.port(stream)
+    local port = ffi.new('int [1]')
+    local status = libal.al_stream_get_port(stream, port)
+    if status == al.OK then
+        return tonumber(port[0])
+    end
+    return nil
+end
+
+function al.stream.poll(stream, timeout)
+    return libal.al_stream_poll(stream, timeout or 0)
+end
+
+function al.stream.send(stream, image)
+    return libal.al_stream_send(stream, image)
+end
+
+function al.stream.send_camera(stream, camera)
+    return libal.al_stream_send_camera(stream, camera)
+end
+
+-- Serve the statistics of libal and of the cameras added to Prometheus, at
+-- http://address:port/metrics (localhost and any free port by default).
+al.metrics = {}
+
+function al.metrics.new(address, port)
+    local p = ffi.new('struct al_metrics *[1]')
+    local status = libal.al_metrics_new(p, address, port or 0)
+    if status == al.OK then
+        return p[0]
+    else
+        return nil
+    end
+end
+
+function al.metrics.free(metrics)
+    if metrics == nil then
+        return
+    end
+    libal.al_metrics_free(metrics)
+end
+
+function al.metrics.port(metrics)
+    local port = ffi.new('int [1]')
+    local status = libal.al_metrics_get_port(metrics, port)
+    if status == al.OK then
+        return tonumber(port[0])
+    end
+    return nil
+end
+
+-- Export the statistics of a camera, labelled camera="name", until it is
+-- removed; remove it before freeing it.
+function al.metrics.add_camera(metrics, camera, name)
+    return libal.al_metrics_add_camera(metrics, camera, name)
+end
+
+function al.metrics.remove_camera(metrics, camera)
+    return libal.al_metrics_remove_camera(metrics, camera)
+end
+
 al.image = {}
 
+-- Allocate a struct al_image (cdata) of the given size and format (RGBA by
+-- default), with rows stride pixels apart (0 for the default alignment).
+-- If padded, the stride is rounded up to rows of whole multiples of
+-- al.IMAGE_PADDING bytes, with as many bytes after the last row (see
+-- al_image_alloc_padded). The pixels are freed when the image is garbage
+-- collected.
+function al.image.new(width, height, format, stride, padded)
+    local image = ffi.new('struct al_image')
+    image.width = width
+    image.height = height
+    image.stride = stride or 0
+    image.format = format or al.COLOR_FORMAT_RGBA
+    local status
+    if padded then
+        status = libal.al_image_alloc_padded(image)
+    else
+        status = libal.al_image_alloc(image)
+    end
+    if status == al.OK then
+        return ffi.gc(image, libal.al_image_free)
+    else
+        return nil
+    end
+end
+
+function al.image.free(image)
+    if image == nil then
+        return
+    end
+    ffi.gc(image, nil)
+    libal.al_image_free(image)
+end
+
+-- Return the size of the image's buffer in bytes, including any padding.
+function al.image.size(image)
+    local n = tonumber(image.stride * image.height)
+    if image.format == al.COLOR_FORMAT_RGBA then
+        return n * 4
+    end
+    return math.floor(n * 3 / 2)
+end
+
+-- Return a pointer to the pixels: uint32_t * for RGBA, or uint8_t *
+-- for YUV, with rows image.stride elements apart. The pointer does not
+-- keep the image alive.
+function al.image.data(image)
+    if image.format == al.COLOR_FORMAT_RGBA then
+        return ffi.cast('uint32_t *', image.data)
+    end
+    return ffi.cast('uint8_t *', image.data)
+end
+
+-- Return a copy of the pixels as a string.
+function al.image.string(image)
+    return ffi.string(image.data, al.image.size(image))
+end
+
+local function result(s)
+    if s == al.OK then
+        return true
+    end
+    return false, tonumber(s)
+end
+
+-- The following functions write into the preallocated image dst and
+-- return true, or false and the status.
+
+-- The output (al.IMAGE_OUTPUT_*) chooses the stores: streamed past the
+-- cache, or kept in it for the next stage; by default, large copies are
+-- streamed.
+function al.image.copy(src, dst, output)
+    return result(libal.al_image_copy_output(src, dst, output or al.IMAGE_OUTPUT_AUTO))
+end
+
+function al.image.convert(src, dst, output)
+    return result(libal.al_image_convert_output(src, dst, output or al.IMAGE_OUTPUT_AUTO))
+end
+
+function al.image.resize(src, dst)
+    return result(libal.al_image_resize(src, dst))
+end
+
+function al.image.rotate(src, dst, degrees)
+    return result(libal.al_image_rotate(src, dst, degrees))
+end
+
+-- Apply operation (al.IMAGE_COPY, al.IMAGE_CONVERT, al.IMAGE_RESIZE or
+-- al.IMAGE_ROTATE) to every pair src[i], dst[i] of struct al_image (cdata)
+-- in one call, spread over one thread per CPU.
+-- Returns true, or false and the status of the first failure.
+function al.image.batch(operation, src, dst, degrees)
+    assert(#src == #dst)
+    degrees = degrees or 0
+    local swap = operation == al.IMAGE_ROTATE and degrees % 180 ~= 0
+    assert(operation ~= al.IMAGE_ROTATE or degrees % 90 == 0)
+    for i = 1, #src do
+        local x, y = src[i], dst[i]
+        if operation ~= al.IMAGE_CONVERT then
+            assert(x.format == y.format, 'formats differ')
+        end
+        if operation == al.IMAGE_COPY then
+            assert(x.width <= y.width and x.height <= y.height, 'sizes differ')
+        elseif operation == al.IMAGE_CONVERT
+            or (operation == al.IMAGE_ROTATE and not swap) then
+            assert(x.width == y.width and x.height == y.height, 'sizes differ')
+        elseif operation == al.IMAGE_ROTATE then
+            assert(x.width == y.height and x.height == y.width, 'sizes differ')
+        end
+    end
+    local n = #src
+    local op = ffi.new('struct al_image_op', operation, degrees)
+    local src_array = ffi.new('struct al_image [?]', n)
+    local dst_array = ffi.new('struct al_image [?]', n)
+    for i = 1, n do
+        src_array[i - 1] = src[i]
+        dst_array[i - 1] = dst[i]
+    end
+    return result(libal.al_image_batch(op, src_array, dst_array, n))
+end
+
+-- A video is a clip of n preallocated images of the same size and format,
+-- in a table, for use with al.image.batch.
 al.video = {}
 
+function al.video.new(n, width, height, format, stride)
+    local video = {}
+    for i = 1, n do
+        local image = al.image.new(width, height, format, stride)
+        if image == nil then
+            return nil
+        end
+        video[i] = image
+    end
+    return video
+end
+
+-- Read the camera's next #video frames into the video, waiting at most
+-- timeout milliseconds for each (forever if negative, the default).
+-- Returns the number of frames read.
+function al.video.record(camera, video, timeout)
+    for i = 1, #video do
+        if not al.camera.read_into(camera, video[i], timeout or -1) then
+            return i - 1
+        end
+    end
+    return #video
+end
+
 return al
@@ -29,6 +29,7 @@
 #include <stdlib.h> // calloc
 #include <string.h> // strdup, strcmp
 #include <strings.h> // strcasecmp
+#include <time.h> // clock_gettime
 #include <unistd.h> // usleep
 
 #include <android/log.h>
@@ -49,9 +50,21 @@
 #include "arithmetic.h" // _al_calc_next_multiple, _al_l2norm
 #include "camera.h" // DEBUG_ACAMERA
 #include "common.h" // DEBUG, DEBUG_AMEDIA, COLOR_Format*
+#include "event.h"
 #include "mediacodec.h"
+#include "memory.h"
+#include "stats.h"
+#include "trace.h"
 #include "yuv.h"
 
+// The buffers of one frame.
+struct frame_buffers {
+    struct al_image yuv420p; // I420
+    struct al_image yuv420sp; // NV12
+    struct al_image rgba;
+    struct al_image image;
+};
+
 struct metadata {
     uint8_t facing;
     int32_t orientation;
@@ -76,15 +89,21 @@ struct al_camera {
     ACaptureRequest *request;
     size_t width;
     size_t height;
-    size_t stride;
+    size_t stride; // of image, from al_camera_set_stride
     int32_t image_format;
     int color_format;
-    struct al_image yuv420p; // NV12
-    struct al_image yuv420sp; // I420
+    struct al_image yuv420p; // I420
+    struct al_image yuv420sp; // NV12
     struct al_image rgba;
     struct al_image image;
+    // The next frame is made here without the frame lock, then swapped
+    // with the buffers above.
+    struct frame_buffers back;
+    struct al_event frame;
     atomic_bool read;
     atomic_bool stop;
+    struct al_stats stats;
+    struct al_memory memory; // of the buffers above
 };
 
 #define N_CAMERAS 64
@@ -104,6 +123,25 @@ on_unavailable(void *context, const char *id)
     DEBUG("onCameraUnavailable(context=%p, id=%s)", context, id);
 }
 
+// The clock of the sensor timestamps (SENSOR_INFO_TIMESTAMP_SOURCE_REALTIME).
+static inline
+uint64_t
+_now(void)
+{
+    struct timespec t;
+    clock_gettime(CLOCK_BOOTTIME, &t);
+    return (uint64_t) t.tv_sec * 1000000000 + (uint64_t) t.tv_nsec;
+}
+
+static inline
+void
+_swap(struct al_image *x, struct al_image *y)
+{
+    const struct al_image z = *x;
+    *x = *y;
+    *y = z;
+}
+
 static
 void
 process_image(struct al_camera *cam, AImage *image)
@@ -111,6 +149,8 @@ process_image(struct al_camera *cam, AImage *image)
     assert(cam != NULL);
     assert(image != NULL);
 
+    const uint64_t start = al_stats_now();
+    AL_TRACE_BEGIN("process_image");
     int32_t format = 0;
     int32_t y_stride = 0;
     int32_t uv_stride = 0;
@@ -142,6 +182,13 @@ process_image(struct al_camera *cam, AImage *image)
     size_t width = (size_t) w;
     size_t height = (size_t) h;
 
+    int64_t timestamp = 0;
+    status = AImage_getTimestamp(image, &timestamp);
+    if (status != AMEDIA_OK) {
+        DEBUG_AMEDIA("AImage_getTimestamp", status);
+        timestamp = 0;
+    }
+
     status = AImage_getFormat(image, &format);
     if (status != AMEDIA_OK) {
         DEBUG_AMEDIA("AImage_getFormat", status);
@@ -197,37 +244,42 @@ process_image(struct al_camera *cam, AImage *image)
             goto error;
     }
 
-    if (cam->yuv420sp.width < width || cam->yuv420sp.height < height)
-        al_image_free(&cam->yuv420sp);
-    if (cam->yuv420sp.data == NULL) {
-        cam->yuv420sp.width = width;
-        cam->yuv420sp.height = height;
-        cam->yuv420sp.stride = width;
-        cam->yuv420sp.format = AL_COLOR_FORMAT_YUV420SP;
-        status2 = al_image_alloc(&cam->yuv420sp);
+    struct frame_buffers *const back = &cam->back;
+
+    if (back->yuv420sp.width < width || back->yuv420sp.height < height)
+        al_image_free(&back->yuv420sp);
+    if (back->yuv420sp.data == NULL) {
+        back->yuv420sp.width = width;
+        back->yuv420sp.height = height;
+        back->yuv420sp.stride = width;
+        back->yuv420sp.format = AL_COLOR_FORMAT_YUV420SP;
+        status2 = al_memory_image_alloc(&cam->memory, &back->yuv420sp);
         assert(status2 == AL_OK);
     }
-    if (cam->yuv420p.width < width || cam->yuv420p.height < height)
-        al_image_free(&cam->yuv420p);
-    if (cam->yuv420p.data == NULL) {
-        cam->yuv420p.width = width;
-        cam->yuv420p.height = height;
-        cam->yuv420p.stride = width;
-        cam->yuv420p.format = AL_COLOR_FORMAT_YUV420P;
-        status2 = al_image_alloc(&cam->yuv420p);
+    if (back->yuv420p.width < width || back->yuv420p.height < height)
+        al_image_free(&back->yuv420p);
+    if (back->yuv420p.data == NULL) {
+        back->yuv420p.width = width;
+        back->yuv420p.height = height;
+        back->yuv420p.stride = width;
+        back->yuv420p.format = AL_COLOR_FORMAT_YUV420P;
+        status2 = al_memory_image_alloc(&cam->memory, &back->yuv420p);
         assert(status2 == AL_OK);
     }
-    if (cam->rgba.width < width || cam->rgba.height < height)
-        al_image_free(&cam->rgba);
-    if (cam->rgba.data == NULL) {
-        cam->rgba.width = width;
-        cam->rgba.height = height;
-        cam->rgba.stride = width;
-        cam->rgba.format = AL_COLOR_FORMAT_RGBA;
-        status2 = al_image_alloc(&cam->rgba);
+    if (back->rgba.width < width || back->rgba.height < height)
+        al_image_free(&back->rgba);
+    if (back->rgba.data == NULL) {
+        back->rgba.width = width;
+        back->rgba.height = height;
+        back->rgba.stride = width;
+        back->rgba.format = AL_COLOR_FORMAT_RGBA;
+        status2 = al_memory_image_alloc(&cam->memory, &back->rgba);
         assert(status2 == AL_OK);
     }
 
+    uint64_t t = al_stats_now();
+    AL_TRACE_BEGIN("repack");
+
     switch (format) {
         case AIMAGE_FORMAT_YUV_420_888:
             switch (uv_pixel_stride) {
@@ -249,11 +301,11 @@ process_image(struct al_camera *cam, AImage *image)
         case COLOR_FormatYUV420Planar:
             // YV12 to I420
             {
-            uint8_t *const y = cam->yuv420p.data;
+            uint8_t *const y = back->yuv420p.data;
             for (size_t i = 0; i < height; i++) {
                 memcpy(&(y[i * width]), &(y_pixel[i * y_stride]), width);
             }
-            uint8_t *const u = (uint8_t *) cam->yuv420p.data + height * width;
+            uint8_t *const u = (uint8_t *) back->yuv420p.data + height * width;
             uint8_t *const v = u + (height / 2) * (width / 2);
             for (size_t i = 0; i < height / 2; i++) {
                 memcpy(&(u[i * width / 2]), &(u_pixel[i * uv_stride]), width / 2);
@@ -265,10 +317,10 @@ process_image(struct al_camera *cam, AImage *image)
             // NV21 to NV12
             {
             for (size_t i = 0; i < height; i++) {
-                uint8_t *y = cam->yuv420sp.data;
+                uint8_t *y = back->yuv420sp.data;
                 memcpy(&(y[i * width]), &(y_pixel[i * y_stride]), width);
             }
-            uint8_t *uv = (uint8_t *) cam->yuv420sp.data + height * width;
+            uint8_t *uv = (uint8_t *) back->yuv420sp.data + height * width;
             assert(u_pixel == v_pixel + 1);
             for (size_t i = 0; i < height / 2; i++) {
                 for (size_t j = 0; j < width / 2; j++) {
@@ -284,19 +336,24 @@ process_image(struct al_camera *cam, AImage *image)
 
     switch (cam->color_format) {
         case COLOR_FormatYUV420Planar:
-            cam->image.format = AL_COLOR_FORMAT_YUV420P;
+            back->image.format = AL_COLOR_FORMAT_YUV420P;
             break;
         case COLOR_FormatYUV420SemiPlanar:
-            cam->image.format = AL_COLOR_FORMAT_YUV420SP;
+            back->image.format = AL_COLOR_FORMAT_YUV420SP;
             break;
         default:
             break;
     }
 
-    if (cam->image.width < width || cam->image.height < height)
-        al_image_free(&cam->image);
-    if (cam->image.data == NULL) {
-        status2 = al_image_alloc(&cam->image);
+    if (back->image.width < width || back->image.height < height)
+        al_image_free(&back->image);
+    if (back->image.data == NULL) {
+        back->image.width = width;
+        back->image.height = height;
+        // Kept at the last swap, to follow al_camera_set_stride.
+        if (back->image.stride < width)
+            back->image.stride = width;
+        status2 = al_memory_image_alloc(&cam->memory, &back->image);
         assert(status2 == AL_OK);
     }
 
@@ -307,10 +364,10 @@ process_image(struct al_camera *cam, AImage *image)
                     .width = cam->width,
                     .height = cam->height,
                     .stride = cam->width,
-                    .data = cam->yuv420p.data,
+                    .data = back->yuv420p.data,
                     .format = AL_COLOR_FORMAT_YUV420P,
                 }),
-                &cam->image
+                &back->image
             );
             assert(status2 == AL_OK);
             break;
@@ -320,16 +377,27 @@ process_image(struct al_camera *cam, AImage *image)
                     .width = cam->width,
                     .height = cam->height,
                     .stride = cam->width,
-                    .data = cam->yuv420sp.data,
+                    .data = back->yuv420sp.data,
                     .format = AL_COLOR_FORMAT_YUV420SP,
                 }),
-                &cam->image
+                &back->image
             );
             assert(status2 == AL_OK);
             break;
         default:
             break;
     }
+    switch (cam->color_format) {
+        case COLOR_FormatYUV420Planar:
+        case COLOR_FormatYUV420SemiPlanar:
+            // Repacked, then copied.
+            al_stats_add(&cam->stats.bytes, (uint64_t) width * height * 3);
+            break;
+        default:
+            break;
+    }
+    t = al_stats_time(&cam->stats.repack, t);
+    AL_TRACE_END("repack");
 
     switch (cam->color_format) {
         case COLOR_FormatYUV420Planar:
@@ -338,9 +406,9 @@ process_image(struct al_camera *cam, AImage *image)
                 y_pixel,
                 u_pixel,
                 v_pixel,
-                cam->rgba.data,
-                cam->image.width,
-                cam->image.height,
+                back->rgba.data,
+                back->image.width,
+                back->image.height,
                 y_stride,
                 uv_stride,
                 y_pixel_stride,
@@ -350,10 +418,38 @@ process_image(struct al_camera *cam, AImage *image)
         default:
             break;
     }
-
+    al_stats_time(&cam->stats.convert, t);
+
+    // The timestamp source may be unknown: then use the time of arrival.
+    const uint64_t now = _now();
+    if (timestamp <= 0 || (uint64_t) timestamp > now)
+        timestamp = (int64_t) now;
+
+    // Publish the frame: the buffers the application reads become the
+    // back buffers, for the next frame.
+    al_event_lock(&cam->frame);
+    _swap(&cam->yuv420p, &back->yuv420p);
+    _swap(&cam->yuv420sp, &back->yuv420sp);
+    _swap(&cam->rgba, &back->rgba);
+    _swap(&cam->image, &back->image);
+    if (back->image.stride != cam->stride) {
+        al_image_free(&back->image);
+        back->image.stride = cam->stride;
+    }
+    al_stats_frame(&cam->stats, (uint64_t) timestamp);
+    if (cam->read)
+        al_stats_add(&cam->stats.unread, 1);
     cam->read = true;
+    AL_TRACE_INSTANT("frame");
+    al_event_signal(&cam->frame);
+    al_event_unlock(&cam->frame);
+    al_stats_time(&cam->stats.process, start);
+    AL_TRACE_END("process_image");
+    return;
 
 error:
+    al_stats_add(&cam->stats.dropped, 1);
+    AL_TRACE_END("process_image");
     return;
 }
 
@@ -384,12 +480,14 @@ on_image_available(void *context, AImageReader *reader)
         status = AImageReader_acquireNextImage(reader, &image);
         if (status != AMEDIA_OK) {
             DEBUG_AMEDIA("AImageReader_acquireNextImage", status);
+            al_stats_add(&cam->stats.dropped, 1);
             return;
         }
     } else {
         status = AImageReader_acquireLatestImage(reader, &image);
         if (status != AMEDIA_OK) {
             DEBUG_AMEDIA("AImageReader_acquireLatestImage", status);
+            al_stats_add(&cam->stats.dropped, 1);
             return;
         }
     }
@@ -807,6 +905,12 @@ al_camera_new(
         goto error0;
     }
 
+    if (al_event_init(&(*cam)->frame) != AL_OK) {
+        free(*cam);
+        *cam = NULL;
+        goto error0;
+    }
+
     (*cam)->index = index;
     if (index < N_CAMERAS)
         _al_cameras[index] = *cam;
@@ -906,6 +1010,8 @@ al_camera_new(
     }
     // (*cam)->image.stride = _al_calc_next_multiple((*cam)->width, 32);
     (*cam)->image.stride = (*cam)->width;
+    (*cam)->stride = (*cam)->image.stride;
+    (*cam)->back.image = (*cam)->image;
 
     ret = AL_OK;
     return ret;
@@ -944,6 +1050,7 @@ error2:
     free((*cam)->availability_callbacks);
     (*cam)->availability_callbacks = NULL;
 error1:
+    al_event_destroy(&(*cam)->frame);
     free(*cam);
     *cam = NULL;
 error0:
@@ -974,6 +1081,10 @@ al_camera_free(struct al_camera *cam)
     al_image_free(&cam->rgba);
     al_image_free(&cam->yuv420sp);
     al_image_free(&cam->yuv420p);
+    al_image_free(&cam->back.image);
+    al_image_free(&cam->back.rgba);
+    al_image_free(&cam->back.yuv420sp);
+    al_image_free(&cam->back.yuv420p);
     free(cam->listener);
     cam->listener = NULL;
     if (cam->window != NULL)
@@ -998,7 +1109,9 @@ al_camera_free(struct al_camera *cam)
     cam->availability_callbacks = NULL;
     if (cam->index < N_CAMERAS)
         _al_cameras[cam->index] = NULL;
+    al_event_destroy(&cam->frame);
     free(cam);
+    (void) al_trace_flush(NULL);
 }
 
 static
@@ -1093,6 +1206,9 @@ on_capture_failed(
         (void *) request,
         failures[failure->reason]
     );
+    struct al_camera *cam = context;
+    if (cam != NULL)
+        al_stats_add(&cam->stats.dropped, 1);
 }
 
 static
@@ -1149,6 +1265,9 @@ on_capture_buffer_lost(
         (void *) window,
         frameNumber
     );
+    struct al_camera *cam = context;
+    if (cam != NULL)
+        al_stats_add(&cam->stats.dropped, 1);
 }
 
 void
@@ -1255,6 +1374,9 @@ al_camera_get_data(struct al_camera *cam, enum al_color_format format, void **da
         *data = cam->image.data;
         return AL_OK;
     }
+    enum al_status status = AL_ERROR;
+    // The conversion writes into the buffers of the frame.
+    al_event_lock(&cam->frame);
     switch (format) {
         case AL_COLOR_FORMAT_YUV420SP:
             switch (cam->color_format) {
@@ -1266,10 +1388,12 @@ al_camera_get_data(struct al_camera *cam, enum al_color_format format, void **da
                         cam->height
                     );
                     *data = cam->yuv420sp.data;
-                    return AL_OK;
+                    status = AL_OK;
+                    break;
                 case COLOR_FormatYUV420SemiPlanar:
                     *data = cam->yuv420sp.data;
-                    return AL_OK;
+                    status = AL_OK;
+                    break;
                 default:
                     break;
             }
@@ -1278,7 +1402,8 @@ al_camera_get_data(struct al_camera *cam, enum al_color_format format, void **da
             switch (cam->color_format) {
                 case COLOR_FormatYUV420Planar:
                     *data = cam->yuv420p.data;
-                    return AL_OK;
+                    status = AL_OK;
+                    break;
                 case COLOR_FormatYUV420SemiPlanar:
                     al_yuv_nv12_to_i420(
                         cam->yuv420sp.data,
@@ -1287,13 +1412,48 @@ al_camera_get_data(struct al_camera *cam, enum al_color_format format, void **da
                         cam->height
                     );
                     *data = cam->yuv420p.data;
-                    return AL_OK;
+                    status = AL_OK;
+                    break;
                 default:
                     break;
             }
             break;
     }
-    return AL_ERROR;
+    al_event_unlock(&cam->frame);
+    return status;
+}
+
+/*
+ * Like al_camera_get_data, but describe the frame as an image, with the
+ * stride of the buffer it is in. Like al_camera_get_data, this does not
+ * consume the frame.
+ */
+enum al_status
+al_camera_get_image(
+    struct al_camera *cam,
+    enum al_color_format format,
+    struct al_image *image
+) {
+    assert(cam != NULL);
+    assert(image != NULL);
+    if (format == cam->image.format) {
+        *image = cam->image;
+        return AL_OK;
+    }
+    *image = (struct al_image) {
+        .width = cam->width,
+        .height = cam->height,
+        .stride = cam->width,
+        .format = format,
+    };
+    if (format == AL_COLOR_FORMAT_RGBA) {
+        image->data = cam->rgba.data;
+        return AL_OK;
+    }
+    void *data = NULL;
+    enum al_status status = al_camera_get_data(cam, format, &data);
+    image->data = data;
+    return status;
 }
 
 enum al_status
@@ -1307,6 +1467,233 @@ al_camera_get_rgba(struct al_camera *cam, void **data)
     }
     cam->read = false;
     *data = cam->rgba.data;
+    al_stats_deliver(&cam->stats, _now());
+    AL_TRACE_INSTANT("al_camera_get_rgba");
+    return AL_OK;
+}
+
+/*
+ * The frame the application reads, in the given format if the camera
+ * has it, or else in the format the camera delivers. Call with the frame
+ * lock held.
+ */
+static
+struct al_image
+_front(const struct al_camera *cam, enum al_color_format format)
+{
+    if (format == cam->image.format)
+        return cam->image;
+    struct al_image image = {
+        .width = cam->width,
+        .height = cam->height,
+        .stride = cam->width,
+    };
+    if (format == AL_COLOR_FORMAT_RGBA) {
+        image.data = cam->rgba.data;
+        image.format = AL_COLOR_FORMAT_RGBA;
+        return image;
+    }
+    switch (cam->color_format) {
+        case COLOR_FormatYUV420Planar:
+            image.data = cam->yuv420p.data;
+            image.format = AL_COLOR_FORMAT_YUV420P;
+            break;
+        case COLOR_FormatYUV420SemiPlanar:
+            image.data = cam->yuv420sp.data;
+            image.format = AL_COLOR_FORMAT_YUV420SP;
+            break;
+        default:
+            break;
+    }
+    return image;
+}
+
+/*
+ * Wait for a new frame and copy it into dst, converting it to the
+ * given format. dst is allocated by the caller, with the camera's width
+ * and height and any stride (in pixels, as in al_image_alloc).
+ * Waits at most timeout milliseconds, or indefinitely if negative;
+ * returns AL_TIMEOUT if there was no new frame.
+ */
+enum al_status
+al_camera_read_into(
+    struct al_camera *cam,
+    enum al_color_format format,
+    struct al_image *dst,
+    int timeout
+) {
+    assert(cam != NULL);
+    assert(dst != NULL);
+    if (dst->data == NULL || dst->format != format)
+        return AL_ERROR;
+    enum al_status status;
+    AL_TRACE_BEGIN("al_camera_read_into");
+    al_event_lock(&cam->frame);
+    status = al_event_wait(&cam->frame, &cam->read, timeout);
+    if (status != AL_OK)
+        goto done;
+    if (dst->width != cam->width || dst->height != cam->height) {
+        status = AL_ERROR;
+        goto done;
+    }
+    // Convert or copy.
+    const struct al_image src = _front(cam, format);
+    status = al_image_convert(&src, dst);
+    if (status == AL_OK) {
+        cam->read = false;
+        al_stats_deliver(&cam->stats, _now());
+        al_stats_add(&cam->stats.bytes, al_stats_image_bytes(dst));
+    }
+done:
+    al_event_unlock(&cam->frame);
+    AL_TRACE_END("al_camera_read_into");
+    return status;
+}
+
+/*
+ * Copy the latest frame into dst, converting it to the given format,
+ * under the frame lock, if it is newer than the frame numbered *sequence;
+ * then set *sequence to its number. Unlike al_camera_read_into, this does
+ * not wait, and does not consume the frame.
+ */
+enum al_status
+al_camera_copy_into(
+    struct al_camera *cam,
+    enum al_color_format format,
+    struct al_image *dst,
+    uint64_t *sequence
+) {
+    assert(cam != NULL);
+    assert(dst != NULL);
+    assert(sequence != NULL);
+    if (dst->data == NULL || dst->format != format)
+        return AL_ERROR;
+    enum al_status status = AL_OK;
+    AL_TRACE_BEGIN("al_camera_copy_into");
+    al_event_lock(&cam->frame);
+    const uint64_t frames = atomic_load(&cam->stats.frames);
+    if (frames == 0 || frames == *sequence)
+        goto done;
+    if (dst->width != cam->width || dst->height != cam->height) {
+        status = AL_ERROR;
+        goto done;
+    }
+    const struct al_image src = _front(cam, format);
+    status = al_image_convert(&src, dst);
+    if (status == AL_OK)
+        *sequence = frames;
+done:
+    al_event_unlock(&cam->frame);
+    AL_TRACE_END("al_camera_copy_into");
+    return status;
+}
+
+/*
+ * Return a non-blocking file descriptor that becomes readable when a new
+ * frame arrives. The camera owns it; drain it with read before calling
+ * al_camera_get_rgba, etc.
+ */
+enum al_status
+al_camera_get_fd(struct al_camera *cam, int *fd)
+{
+    assert(cam != NULL);
+    assert(fd != NULL);
+    al_event_lock(&cam->frame);
+    enum al_status status = al_event_get_fd(&cam->frame, fd);
+    al_event_unlock(&cam->frame);
+    return status;
+}
+
+/*
+ * Wait for a new frame without consuming it, so that the next call to
+ * al_camera_get_rgba, etc. returns it. Waits at most timeout milliseconds,
+ * or indefinitely if negative; returns AL_TIMEOUT if there was no new frame.
+ */
+enum al_status
+al_camera_wait(struct al_camera *cam, int timeout)
+{
+    assert(cam != NULL);
+    AL_TRACE_BEGIN("al_camera_wait");
+    al_event_lock(&cam->frame);
+    enum al_status status = al_event_wait(&cam->frame, &cam->read, timeout);
+    al_event_unlock(&cam->frame);
+    AL_TRACE_END("al_camera_wait");
+    return status;
+}
+
+/*
+ * Return a snapshot of the camera's pipeline statistics since it was
+ * created. The counters are updated without the frame lock, so this
+ * never blocks the camera.
+ */
+enum al_status
+al_camera_get_stats(struct al_camera *cam, struct al_camera_stats *stats)
+{
+    assert(cam != NULL);
+    assert(stats != NULL);
+    al_stats_get(&cam->stats, stats);
+    return AL_OK;
+}
+
+/*
+ * Return the memory held by the image buffers of the camera, which are
+ * allocated as frames of a new size arrive and kept until it is freed.
+ */
+enum al_status
+al_camera_get_memory(struct al_camera *cam, struct al_memory_stats *stats)
+{
+    assert(cam != NULL);
+    assert(stats != NULL);
+    al_memory_get(&cam->memory, stats);
+    return AL_OK;
+}
+
+/*
+ * Return the sequence number and capture timestamp (on CLOCK_BOOTTIME)
+ * of the last frame delivered by al_camera_get_rgba or
+ * al_camera_read_into, or zeros before the first.
+ */
+enum al_status
+al_camera_get_frame(struct al_camera *cam, struct al_camera_frame *frame)
+{
+    assert(cam != NULL);
+    assert(frame != NULL);
+    al_stats_get_frame(&cam->stats, frame);
+    return AL_OK;
+}
+
+/*
+ * Return a percentile (0 to 100) of the latency from capture to delivery
+ * of the frames so far, in nanoseconds, within 3%, or 0 if none.
+ */
+enum al_status
+al_camera_get_latency(struct al_camera *cam, double percentile, uint64_t *ns)
+{
+    assert(cam != NULL);
+    assert(ns != NULL);
+    if (!(percentile >= 0 && percentile <= 100))
+        return AL_ERROR;
+    *ns = al_histogram_percentile(&cam->stats.latency, percentile);
+    return AL_OK;
+}
+
+/*
+ * Count the latencies so far at most each of n bounds in nanoseconds, in
+ * increasing order, into counts (cumulative, like Prometheus buckets).
+ */
+enum al_status
+al_camera_get_latency_histogram(
+    struct al_camera *cam,
+    const uint64_t *bounds,
+    uint64_t *counts,
+    size_t n
+) {
+    assert(cam != NULL);
+    for (size_t i = 1; i < n; i++) {
+        if (bounds[i] < bounds[i - 1])
+            return AL_ERROR;
+    }
+    al_histogram_cumulative(&cam->stats.latency, bounds, counts, n);
     return AL_OK;
 }
 
@@ -1343,26 +1730,19 @@ al_camera_set_stride(struct al_camera *cam, size_t stride)
     assert(cam != NULL);
     assert(stride >= cam->image.width);
     assert(stride % 16 == 0);
-    void *data = NULL;
-    size_t size = 0;
-    switch (cam->image.format) {
-        case AL_COLOR_FORMAT_YUV420P:
-        case AL_COLOR_FORMAT_YUV420SP:
-            size = stride * cam->image.height * 3 / 2 * sizeof (uint8_t);
-            break;
-        case AL_COLOR_FORMAT_RGBA:
-            size = stride * cam->image.height * sizeof (uint32_t);
-            break;
-        case AL_COLOR_FORMAT_UNKNOWN:
-            break;
-    }
-    if (size > 0)
-        data = realloc(cam->image.data, size);
-    if (data == NULL)
-        return AL_NOMEMORY;
-    cam->image.data = data;
+    al_event_lock(&cam->frame);
+    const size_t old = cam->image.stride;
     cam->image.stride = stride;
-    return AL_OK;
+    enum al_status status = AL_OK;
+    // Before the first frame, the image is allocated by process_image.
+    if (cam->image.data != NULL)
+        status = al_memory_image_alloc(&cam->memory, &cam->image);
+    if (status == AL_OK)
+        cam->stride = stride;
+    else
+        cam->image.stride = old;
+    al_event_unlock(&cam->frame);
+    return status;
 }
 
 void
@@ -32,6 +32,8 @@
 #include "al.h"
 
 #include "common.h"
+#include "batch.h" // al_batch_init
+#include "cpu.h" // al_kernels_init
 
 const char *const copyright = "Copyright 2023-2025, Mansour Moufid <mansourmoufid@gmail.com>";
 const char *const platform = "android";
@@ -192,4 +194,6 @@ __attribute__((constructor))
 al_init(void)
 {
     catch_fatal_signals();
+    al_kernels_init();
+    al_batch_init();
 }
@@ -22,6 +22,8 @@
 #include <float.h> // FLT_MANT_DIG
 #include <math.h> // sqrtf
 #include <stddef.h>
+#include <stdint.h>
+#include <string.h> // memcpy
 
 #define FLT_MAX_ZERO_EXP (((uint32_t) 1 << FLT_MANT_DIG) - 1)
 
@@ -42,3 +44,429 @@ _al_l2norm(float x, float y, float a, float b)
 {
     return sqrtf((x - a) * (x - a) + (y - b) * (y - b));
 }
+
+/*
+ * Portable 128-bit vectors, for kernels written once and compiled for
+ * each target in the dispatch tables (see cpu.c).
+ *
+ * The types are Clang/GCC vector extensions, so ordinary arithmetic and
+ * comparisons work on them and each target lowers them itself. The
+ * primitives below that have no direct form in the extensions use the
+ * instruction of the baseline ISA where there is one (SSE2 on x86-64,
+ * NEON on AArch64 and on ARMv7 built with -mfpu=neon), and plain vector
+ * code otherwise. They are only what the kernels need: loads and stores
+ * (also non-temporal), interleave and deinterleave, widening, widening
+ * multiply, saturating pack, byte shuffle and horizontal add.
+ *
+ * The #if below see the ISA of the translation unit, not the target
+ * attribute of a dispatch variant, which defines no macros: the AVX2
+ * variant gets SSE2 instructions (VEX encoded) from them. The 256-bit
+ * forms at the end are written with the extensions only, so that the
+ * AVX2 and AVX-512 variants lower them to AVX2.
+ *
+ * AL_SIMD is defined if the compiler supports them.
+ */
+#if defined(__clang__) || (defined(__GNUC__) && __GNUC__ >= 12)
+#define AL_SIMD 1
+#endif
+
+#if defined(AL_SIMD)
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+#if defined(__SSSE3__)
+#include <tmmintrin.h> // _mm_shuffle_epi8
+#endif
+#if defined(__ARM_NEON)
+#include <arm_neon.h>
+#define AL_SIMD_NEON 1
+#endif
+
+typedef uint8_t al_u8x16 __attribute__((vector_size(16)));
+typedef uint16_t al_u16x8 __attribute__((vector_size(16)));
+typedef int16_t al_i16x8 __attribute__((vector_size(16)));
+typedef uint32_t al_u32x4 __attribute__((vector_size(16)));
+typedef int32_t al_i32x4 __attribute__((vector_size(16)));
+
+#define AL_SIMD_INLINE static inline __attribute__((always_inline))
+
+// Unaligned loads and stores.
+AL_SIMD_INLINE
+al_u8x16
+al_u8x16_load(const void *p)
+{
+    al_u8x16 x;
+    memcpy(&x, p, sizeof x);
+    return x;
+}
+
+AL_SIMD_INLINE
+void
+al_u8x16_store(void *p, al_u8x16 x)
+{
+    memcpy(p, &x, sizeof x);
+}
+
+AL_SIMD_INLINE
+void
+al_u32x4_store(void *p, al_u32x4 x)
+{
+    memcpy(p, &x, sizeof x);
+}
+
+/*
+ * Store to p, aligned to 16 bytes, without the caches where the ISA can
+ * (non-temporal); follow a series of them with al_stream_fence.
+ */
+AL_SIMD_INLINE
+void
+al_u8x16_stream(void *p, al_u8x16 x)
+{
+#if defined(__SSE2__)
+    _mm_stream_si128((__m128i *) p, (__m128i) x);
+#elif defined(__clang__)
+    __builtin_nontemporal_store(x, (al_u8x16 *) p);
+#else
+    memcpy(p, &x, sizeof x);
+#endif
+}
+
+// Order the streaming stores before the stores that follow.
+AL_SIMD_INLINE
+void
+al_stream_fence(void)
+{
+#if defined(__SSE2__)
+    _mm_sfence();
+#else
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+#endif
+}
+
+AL_SIMD_INLINE
+al_u8x16
+al_u8x16_splat(uint8_t x)
+{
+    return (al_u8x16) {x, x, x, x, x, x, x, x, x, x, x, x, x, x, x, x};
+}
+
+// Interleave: a0 b0 a1 b1 … from the low halves, and from the high halves.
+AL_SIMD_INLINE
+al_u8x16
+al_u8x16_zip_lo(al_u8x16 a, al_u8x16 b)
+{
+#if defined(AL_SIMD_NEON) && defined(__aarch64__)
+    return (al_u8x16) vzip1q_u8((uint8x16_t) a, (uint8x16_t) b);
+#elif defined(AL_SIMD_NEON)
+    return (al_u8x16) vzipq_u8((uint8x16_t) a, (uint8x16_t) b).val[0];
+#elif defined(__SSE2__)
+    return (al_u8x16) _mm_unpacklo_epi8((__m128i) a, (__m128i) b);
+#else
+    return __builtin_shufflevector(a, b,
+        0, 16, 1, 17, 2, 18, 3, 19, 4, 20, 5, 21, 6, 22, 7, 23);
+#endif
+}
+
+AL_SIMD_INLINE
+al_u8x16
+al_u8x16_zip_hi(al_u8x16 a, al_u8x16 b)
+{
+#if defined(AL_SIMD_NEON) && defined(__aarch64__)
+    return (al_u8x16) vzip2q_u8((uint8x16_t) a, (uint8x16_t) b);
+#elif defined(AL_SIMD_NEON)
+    return (al_u8x16) vzipq_u8((uint8x16_t) a, (uint8x16_t) b).val[1];
+#elif defined(__SSE2__)
+    return (al_u8x16) _mm_unpackhi_epi8((__m128i) a, (__m128i) b);
+#else
+    return __builtin_shufflevector(a, b,
+        8, 24, 9, 25, 10, 26, 11, 27, 12, 28, 13, 29, 14, 30, 15, 31);
+#endif
+}
+
+// Deinterleave: the even bytes of a then b, and the odd bytes.
+AL_SIMD_INLINE
+al_u8x16
+al_u8x16_unzip_even(al_u8x16 a, al_u8x16 b)
+{
+#if defined(AL_SIMD_NEON) && defined(__aarch64__)
+    return (al_u8x16) vuzp1q_u8((uint8x16_t) a, (uint8x16_t) b);
+#elif defined(AL_SIMD_NEON)
+    return (al_u8x16) vuzpq_u8((uint8x16_t) a, (uint8x16_t) b).val[0];
+#elif defined(__SSE2__)
+    const __m128i mask = _mm_set1_epi16(0x00ff);
+    return (al_u8x16) _mm_packus_epi16(
+        _mm_and_si128((__m128i) a, mask),
+        _mm_and_si128((__m128i) b, mask)
+    );
+#else
+    return __builtin_shufflevector(a, b,
+        0, 2, 4, 6, 8, 10, 12, 14, 16, 18, 20, 22, 24, 26, 28, 30);
+#endif
+}
+
+AL_SIMD_INLINE
+al_u8x16
+al_u8x16_unzip_odd(al_u8x16 a, al_u8x16 b)
+{
+#if defined(AL_SIMD_NEON) && defined(__aarch64__)
+    return (al_u8x16) vuzp2q_u8((uint8x16_t) a, (uint8x16_t) b);
+#elif defined(AL_SIMD_NEON)
+    return (al_u8x16) vuzpq_u8((uint8x16_t) a, (uint8x16_t) b).val[1];
+#elif defined(__SSE2__)
+    return (al_u8x16) _mm_packus_epi16(
+        _mm_srli_epi16((__m128i) a, 8),
+        _mm_srli_epi16((__m128i) b, 8)
+    );
+#else
+    return __builtin_shufflevector(a, b,
+        1, 3, 5, 7, 9, 11, 13, 15, 17, 19, 21, 23, 25, 27, 29, 31);
+#endif
+}
+
+// Zero-extend the low or high 8 bytes to 16 bits.
+AL_SIMD_INLINE
+al_i16x8
+al_u8x16_widen_lo(al_u8x16 x)
+{
+#if defined(AL_SIMD_NEON)
+    return (al_i16x8) vmovl_u8(vget_low_u8((uint8x16_t) x));
+#elif defined(__SSE2__)
+    return (al_i16x8) _mm_unpacklo_epi8((__m128i) x, _mm_setzero_si128());
+#else
+    return __builtin_convertvector(
+        __builtin_shufflevector(x, x, 0, 1, 2, 3, 4, 5, 6, 7),
+        al_i16x8
+    );
+#endif
+}
+
+AL_SIMD_INLINE
+al_i16x8
+al_u8x16_widen_hi(al_u8x16 x)
+{
+#if defined(AL_SIMD_NEON) && defined(__aarch64__)
+    return (al_i16x8) vmovl_high_u8((uint8x16_t) x);
+#elif defined(AL_SIMD_NEON)
+    return (al_i16x8) vmovl_u8(vget_high_u8((uint8x16_t) x));
+#elif defined(__SSE2__)
+    return (al_i16x8) _mm_unpackhi_epi8((__m128i) x, _mm_setzero_si128());
+#else
+    return __builtin_convertvector(
+        __builtin_shufflevector(x, x, 8, 9, 10, 11, 12, 13, 14, 15),
+        al_i16x8
+    );
+#endif
+}
+
+// The full 32-bit products of the low or high four lanes.
+AL_SIMD_INLINE
+al_i32x4
+al_i16x8_mul_widen_lo(al_i16x8 a, al_i16x8 b)
+{
+#if defined(AL_SIMD_NEON)
+    return (al_i32x4) vmull_s16(vget_low_s16((int16x8_t) a), vget_low_s16((int16x8_t) b));
+#elif defined(__SSE2__)
+    const __m128i lo = _mm_mullo_epi16((__m128i) a, (__m128i) b);
+    const __m128i hi = _mm_mulhi_epi16((__m128i) a, (__m128i) b);
+    return (al_i32x4) _mm_unpacklo_epi16(lo, hi);
+#else
+    return __builtin_convertvector(
+        __builtin_shufflevector(a, a, 0, 1, 2, 3), al_i32x4
+    ) * __builtin_convertvector(
+        __builtin_shufflevector(b, b, 0, 1, 2, 3), al_i32x4
+    );
+#endif
+}
+
+AL_SIMD_INLINE
+al_i32x4
+al_i16x8_mul_widen_hi(al_i16x8 a, al_i16x8 b)
+{
+#if defined(AL_SIMD_NEON) && defined(__aarch64__)
+    return (al_i32x4) vmull_high_s16((int16x8_t) a, (int16x8_t) b);
+#elif defined(AL_SIMD_NEON)
+    return (al_i32x4) vmull_s16(vget_high_s16((int16x8_t) a), vget_high_s16((int16x8_t) b));
+#elif defined(__SSE2__)
+    const __m128i lo = _mm_mullo_epi16((__m128i) a, (__m128i) b);
+    const __m128i hi = _mm_mulhi_epi16((__m128i) a, (__m128i) b);
+    return (al_i32x4) _mm_unpackhi_epi16(lo, hi);
+#else
+    return __builtin_convertvector(
+        __builtin_shufflevector(a, a, 4, 5, 6, 7), al_i32x4
+    ) * __builtin_convertvector(
+        __builtin_shufflevector(b, b, 4, 5, 6, 7), al_i32x4
+    );
+#endif
+}
+
+// Narrow with signed saturation: a then b.
+AL_SIMD_INLINE
+al_i16x8
+al_i32x4_pack_i16(al_i32x4 a, al_i32x4 b)
+{
+#if defined(AL_SIMD_NEON)
+    return (al_i16x8) vcombine_s16(vqmovn_s32((int32x4_t) a), vqmovn_s32((int32x4_t) b));
+#elif defined(__SSE2__)
+    return (al_i16x8) _mm_packs_epi32((__m128i) a, (__m128i) b);
+#else
+    const al_i32x4 lo = {INT16_MIN, INT16_MIN, INT16_MIN, INT16_MIN};
+    const al_i32x4 hi = {INT16_MAX, INT16_MAX, INT16_MAX, INT16_MAX};
+    // Comparisons give all ones where true.
+    a = (a & ~(a < lo)) | (lo & (a < lo));
+    a = (a & ~(a > hi)) | (hi & (a > hi));
+    b = (b & ~(b < lo)) | (lo & (b < lo));
+    b = (b & ~(b > hi)) | (hi & (b > hi));
+    return __builtin_convertvector(
+        __builtin_shufflevector(a, b, 0, 1, 2, 3, 4, 5, 6, 7),
+        al_i16x8
+    );
+#endif
+}
+
+// Narrow to unsigned bytes with saturation (0 to 255): a then b.
+AL_SIMD_INLINE
+al_u8x16
+al_i16x8_pack_u8(al_i16x8 a, al_i16x8 b)
+{
+#if defined(AL_SIMD_NEON)
+    return (al_u8x16) vcombine_u8(vqmovun_s16((int16x8_t) a), vqmovun_s16((int16x8_t) b));
+#elif defined(__SSE2__)
+    return (al_u8x16) _mm_packus_epi16((__m128i) a, (__m128i) b);
+#else
+    const al_i16x8 hi = {255, 255, 255, 255, 255, 255, 255, 255};
+    a &= ~(a < 0);
+    a = (a & ~(a > hi)) | (hi & (a > hi));
+    b &= ~(b < 0);
+    b = (b & ~(b > hi)) | (hi & (b > hi));
+    return __builtin_convertvector(
+        __builtin_shufflevector(a, b,
+            0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15),
+        al_u8x16
+    );
+#endif
+}
+
+// Select bytes of x by index; indices of 16 and more select zero.
+AL_SIMD_INLINE
+al_u8x16
+al_u8x16_shuffle(al_u8x16 x, al_u8x16 index)
+{
+#if defined(AL_SIMD_NEON) && defined(__aarch64__)
+    return (al_u8x16) vqtbl1q_u8((uint8x16_t) x, (uint8x16_t) index);
+#elif defined(AL_SIMD_NEON)
+    // vtbl2 also selects zero for indices of 16 and more.
+    const uint8x8x2_t table = {{
+        vget_low_u8((uint8x16_t) x),
+        vget_high_u8((uint8x16_t) x),
+    }};
+    return (al_u8x16) vcombine_u8(
+        vtbl2_u8(table, vget_low_u8((uint8x16_t) index)),
+        vtbl2_u8(table, vget_high_u8((uint8x16_t) index))
+    );
+#elif defined(__SSSE3__)
+    // pshufb zeroes a lane only if the high bit of its index is set.
+    const __m128i high = _mm_cmpgt_epi8(
+        _mm_min_epu8((__m128i) index, _mm_set1_epi8(16)),
+        _mm_set1_epi8(15)
+    );
+    return (al_u8x16) _mm_shuffle_epi8(
+        (__m128i) x,
+        _mm_or_si128((__m128i) index, high)
+    );
+#elif defined(__GNUC__) && !defined(__clang__)
+    // GCC lowers this to pshufb in the variants that have SSSE3.
+    return __builtin_shuffle(x, index) & (al_u8x16) (index < 16);
+#else
+    al_u8x16 y;
+    for (int i = 0; i < 16; i++)
+        y[i] = index[i] < 16 ? x[index[i] & 15] : 0;
+    return y;
+#endif
+}
+
+// The sum of the lanes.
+AL_SIMD_INLINE
+uint32_t
+al_u8x16_hadd(al_u8x16 x)
+{
+#if defined(AL_SIMD_NEON) && defined(__aarch64__)
+    return vaddlvq_u8((uint8x16_t) x);
+#elif defined(AL_SIMD_NEON)
+    const uint64x2_t sums = vpaddlq_u32(vpaddlq_u16(vpaddlq_u8((uint8x16_t) x)));
+    return (uint32_t) (vgetq_lane_u64(sums, 0) + vgetq_lane_u64(sums, 1));
+#elif defined(__SSE2__)
+    const __m128i sums = _mm_sad_epu8((__m128i) x, _mm_setzero_si128());
+    return (uint32_t) (_mm_cvtsi128_si32(sums)
+        + _mm_cvtsi128_si32(_mm_unpackhi_epi64(sums, sums)));
+#else
+    uint32_t sum = 0;
+    for (int i = 0; i < 16; i++)
+        sum += x[i];
+    return sum;
+#endif
+}
+
+AL_SIMD_INLINE
+uint32_t
+al_u32x4_hadd(al_u32x4 x)
+{
+#if defined(AL_SIMD_NEON) && defined(__aarch64__)
+    return vaddvq_u32((uint32x4_t) x);
+#elif defined(AL_SIMD_NEON)
+    const uint32x2_t sums = vadd_u32(
+        vget_low_u32((uint32x4_t) x),
+        vget_high_u32((uint32x4_t) x)
+    );
+    return vget_lane_u32(vpadd_u32(sums, sums), 0);
+#else
+    return x[0] + x[1] + x[2] + x[3];
+#endif
+}
+
+
+/*
+ * 256-bit interleave and deinterleave, on memory: one AVX2 instruction
+ * per operation in the AVX2 and AVX-512 variants, but many more in the
+ * others, which should use the 128-bit forms above. They take pointers,
+ * as a 256-bit argument would change the ABI of the baseline.
+ */
+typedef uint8_t al_u8x32 __attribute__((vector_size(32)));
+
+// Copy the even bytes of the 64 at p to even, and the odd bytes to odd.
+AL_SIMD_INLINE
+void
+al_u8x32_unzip(uint8_t *even, uint8_t *odd, const uint8_t *p)
+{
+    al_u8x32 a, b;
+    memcpy(&a, p, sizeof a);
+    memcpy(&b, p + sizeof a, sizeof b);
+    const al_u8x32 x = __builtin_shufflevector(a, b,
+        0, 2, 4, 6, 8, 10, 12, 14, 16, 18, 20, 22, 24, 26, 28, 30,
+        32, 34, 36, 38, 40, 42, 44, 46, 48, 50, 52, 54, 56, 58, 60, 62);
+    const al_u8x32 y = __builtin_shufflevector(a, b,
+        1, 3, 5, 7, 9, 11, 13, 15, 17, 19, 21, 23, 25, 27, 29, 31,
+        33, 35, 37, 39, 41, 43, 45, 47, 49, 51, 53, 55, 57, 59, 61, 63);
+    memcpy(even, &x, sizeof x);
+    memcpy(odd, &y, sizeof y);
+}
+
+// Write the 32 bytes at a and the 32 at b interleaved to p: a0 b0 a1 b1 …
+AL_SIMD_INLINE
+void
+al_u8x32_zip(uint8_t *p, const uint8_t *a, const uint8_t *b)
+{
+    al_u8x32 x, y;
+    memcpy(&x, a, sizeof x);
+    memcpy(&y, b, sizeof y);
+    const al_u8x32 lo = __builtin_shufflevector(x, y,
+        0, 32, 1, 33, 2, 34, 3, 35, 4, 36, 5, 37, 6, 38, 7, 39,
+        8, 40, 9, 41, 10, 42, 11, 43, 12, 44, 13, 45, 14, 46, 15, 47);
+    const al_u8x32 hi = __builtin_shufflevector(x, y,
+        16, 48, 17, 49, 18, 50, 19, 51, 20, 52, 21, 53, 22, 54, 23, 55,
+        24, 56, 25, 57, 26, 58, 27, 59, 28, 60, 29, 61, 30, 62, 31, 63);
+    memcpy(p, &lo, sizeof lo);
+    memcpy(p + sizeof lo, &hi, sizeof hi);
+}
+
+#endif
@@ -0,0 +1,286 @@
+/* Copyright 2023-2025, Mansour Moufid <mansourmoufid@gmail.com> */
+
+/*
+ * This file is part of Aluminium Library.
+ *
+ * Aluminium Library is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Aluminium Library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with Aluminium Library. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <assert.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h> // strerror
+#include <unistd.h> // sysconf
+
+#include "al.h"
+#include "batch.h"
+#include "common.h" // DEBUG
+
+#define AL_BATCH_MAX_THREADS 64
+
+// Set in the threads of the pool, and in a thread running tasks for it,
+// which do not start more.
+static _Thread_local bool worker = false;
+
+/*
+ * The worker pool, started once by al_batch_init. It runs one job at a
+ * time: n tasks, fn(arg, k) for k in [0, n), which the calling thread
+ * takes too. Without the pool (before al_batch_init, or if it failed to
+ * start), or when it is busy with another job, the tasks run in turn on
+ * the calling thread.
+ */
+struct pool {
+    pthread_mutex_t lock;
+    pthread_cond_t work; // a job was posted
+    pthread_cond_t done; // the last task of the job finished
+    size_t size; // threads, not counting the calling thread
+    bool busy;
+    void (*fn)(void *, size_t);
+    void *arg;
+    size_t n;
+    size_t next; // the next task to take
+    size_t running; // tasks taken and not finished
+};
+
+static struct pool pool = {
+    .lock = PTHREAD_MUTEX_INITIALIZER,
+    .work = PTHREAD_COND_INITIALIZER,
+    .done = PTHREAD_COND_INITIALIZER,
+};
+
+static pthread_once_t pool_once = PTHREAD_ONCE_INIT;
+
+static
+size_t
+_nthreads(size_t n)
+{
+    long ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+    size_t m = ncpu > 0 ? (size_t) ncpu : 1;
+    if (m > AL_BATCH_MAX_THREADS)
+        m = AL_BATCH_MAX_THREADS;
+    return n < m ? n : m;
+}
+
+// Take and run tasks until there are none left; with the lock held.
+static
+void
+_pool_tasks(void)
+{
+    while (pool.next < pool.n) {
+        void (*fn)(void *, size_t) = pool.fn;
+        void *arg = pool.arg;
+        size_t k = pool.next++;
+        pool.running++;
+        pthread_mutex_unlock(&pool.lock);
+        fn(arg, k);
+        pthread_mutex_lock(&pool.lock);
+        pool.running--;
+    }
+}
+
+static
+void *
+__attribute__((noreturn))
+_pool_worker(void *arg)
+{
+    (void) arg;
+    worker = true;
+    pthread_mutex_lock(&pool.lock);
+    for (;;) {
+        while (pool.next >= pool.n)
+            pthread_cond_wait(&pool.work, &pool.lock);
+        _pool_tasks();
+        if (pool.running == 0)
+            pthread_cond_signal(&pool.done);
+    }
+}
+
+static
+void
+_pool_start(void)
+{
+    const size_t m = _nthreads(AL_BATCH_MAX_THREADS);
+    size_t size = 0;
+    for (size_t k = 1; k < m; k++) {
+        pthread_t thread;
+        int err = pthread_create(&thread, NULL, _pool_worker, NULL);
+        if (err != 0) {
+            // Carry on with the threads we have.
+            DEBUG("pthread_create: %s", strerror(err));
+            break;
+        }
+        pthread_detach(thread);
+        size++;
+    }
+    pthread_mutex_lock(&pool.lock);
+    pool.size = size;
+    pthread_mutex_unlock(&pool.lock);
+    DEBUG("%zu threads", size);
+}
+
+__attribute__((visibility("hidden")))
+void
+al_batch_init(void)
+{
+    pthread_once(&pool_once, _pool_start);
+}
+
+static
+void
+_run(void (*fn)(void *, size_t), void *arg, size_t n)
+{
+    pthread_mutex_lock(&pool.lock);
+    if (pool.size == 0 || pool.busy || worker) {
+        pthread_mutex_unlock(&pool.lock);
+        for (size_t k = 0; k < n; k++)
+            fn(arg, k);
+        return;
+    }
+    pool.busy = true;
+    pool.fn = fn;
+    pool.arg = arg;
+    pool.n = n;
+    pool.next = 0;
+    pool.running = 0;
+    pthread_cond_broadcast(&pool.work);
+    worker = true;
+    _pool_tasks();
+    worker = false;
+    while (pool.running > 0)
+        pthread_cond_wait(&pool.done, &pool.lock);
+    pool.busy = false;
+    pthread_mutex_unlock(&pool.lock);
+}
+
+struct batch {
+    const struct al_image_op *op;
+    struct al_image *src;
+    struct al_image *dst;
+    size_t n;
+    atomic_size_t next;
+    atomic_int status;
+};
+
+static
+enum al_status
+_apply(const struct al_image_op *op, struct al_image *src, struct al_image *dst)
+{
+    switch (op->operation) {
+        case AL_IMAGE_COPY:
+            return al_image_copy(src, dst);
+        case AL_IMAGE_CONVERT:
+            return al_image_convert(src, dst);
+        case AL_IMAGE_RESIZE:
+            return al_image_resize(src, dst);
+        case AL_IMAGE_ROTATE:
+            return al_image_rotate(src, dst, op->degrees);
+    }
+    return AL_NOTIMPLEMENTED;
+}
+
+// Each task takes the next image until the batch is done or has failed.
+static
+void
+_batch_task(void *arg, size_t k)
+{
+    struct batch *batch = arg;
+    (void) k;
+    while (atomic_load(&batch->status) == AL_OK) {
+        size_t i = atomic_fetch_add(&batch->next, 1);
+        if (i >= batch->n)
+            break;
+        enum al_status status = _apply(
+            batch->op,
+            &(batch->src[i]),
+            &(batch->dst[i])
+        );
+        if (status != AL_OK) {
+            int ok = AL_OK;
+            atomic_compare_exchange_strong(&batch->status, &ok, status);
+        }
+    }
+}
+
+/*
+ * Apply one operation to n pairs of images, src[i] → dst[i], on up to one
+ * thread per CPU (including the calling thread). Returns the first error,
+ * after which the remaining images are skipped.
+ */
+enum al_status
+al_image_batch(
+    const struct al_image_op *op,
+    struct al_image *src,
+    struct al_image *dst,
+    size_t n
+) {
+    assert(op != NULL);
+    if (n == 0)
+        return AL_OK;
+    if (src == NULL || dst == NULL)
+        return AL_ERROR;
+    struct batch batch = {
+        .op = op,
+        .src = src,
+        .dst = dst,
+        .n = n,
+    };
+    atomic_init(&batch.next, 0);
+    atomic_init(&batch.status, AL_OK);
+    _run(_batch_task, &batch, _nthreads(n));
+    return (enum al_status) atomic_load(&batch.status);
+}
+
+struct bands {
+    void (*fn)(void *, size_t, size_t);
+    void *arg;
+    size_t n;
+    size_t m;
+};
+
+static
+void
+_band_task(void *arg, size_t k)
+{
+    const struct bands *bands = arg;
+    bands->fn(
+        bands->arg,
+        bands->n * k / bands->m,
+        bands->n * (k + 1) / bands->m
+    );
+}
+
+__attribute__((visibility("hidden")))
+void
+al_batch_rows(
+    void (*fn)(void *, size_t, size_t),
+    void *arg,
+    size_t n,
+    size_t min_rows
+) {
+    assert(fn != NULL);
+    const size_t m = _nthreads(n / (min_rows > 0 ? min_rows : 1));
+    if (m <= 1 || worker) {
+        fn(arg, 0, n);
+        return;
+    }
+    struct bands bands = {
+        .fn = fn,
+        .arg = arg,
+        .n = n,
+        .m = m,
+    };
+    _run(_band_task, &bands, m);
+}
@@ -0,0 +1,37 @@
+/* Copyright 2023-2025, Mansour Moufid <mansourmoufid@gmail.com> */
+
+/*
+ * This file is part of Aluminium Library.
+ *
+ * Aluminium Library is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Aluminium Library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with Aluminium Library. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <stddef.h>
+
+/*
+ * Start the worker pool, one thread per CPU less the calling thread, once.
+ * al_init calls it; until then al_batch_rows and al_image_batch run on
+ * the calling thread alone.
+ */
+void al_batch_init(void);
+
+/*
+ * Run fn(arg, begin, end) over the rows [begin, end) of [0, n), in bands
+ * of at least min_rows rows, on up to one thread per CPU (the pool and the
+ * calling thread), and return when every band is done. Within a batch
+ * (al_image_batch), which has the CPUs already, the bands run in turn.
+ */
+void al_batch_rows(void (*)(void *, size_t, size_t), void *, size_t, size_t);
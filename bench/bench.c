@@ -0,0 +1,638 @@
+/* Copyright 2023-2025, Mansour Moufid <mansourmoufid@gmail.com> */
+
+/*
+ * This file is part of Aluminium Library.
+ *
+ * Aluminium Library is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Aluminium Library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with Aluminium Library. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Benchmarks of the image and YUV kernels.
+ *
+ *     bench [-p] [-w warmup] [-r repeat] [-s WIDTHxHEIGHT] [kernel ...]
+ *
+ * Each kernel runs warmup times, then repeat times under the clock, at
+ * each size. The results are written to stdout as JSON; throughput and
+ * cycles are computed from the median time.
+ *
+ * With -p (Linux only), the hardware counters below are also read around
+ * each run with perf_event_open, and their medians reported per pixel.
+ * Counters the CPU or the kernel does not provide (see
+ * /proc/sys/kernel/perf_event_paranoid) are reported as null. The
+ * counters follow the calling thread, so -p also runs the kernels on one
+ * thread, without the worker pool that splits large planes.
+ *
+ * The images are allocated by al_image_alloc, so run with and without
+ * AL_HUGEPAGES (see image.c) to compare huge pages and the dTLB misses.
+ */
+
+// syscall is not in POSIX (see _perf_open).
+#if defined(__linux__) && !defined(_DEFAULT_SOURCE)
+#define _DEFAULT_SOURCE 1
+#endif
+
+#include <assert.h>
+#include <errno.h>
+#include <math.h> // isnan, NAN, sqrt
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h> // calloc, free, qsort, strtoul
+#include <string.h> // memset, strcmp, strstr
+#include <time.h> // clock_gettime
+#include <unistd.h> // close, getopt, read, syscall
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h> // __rdtsc
+#define AL_BENCH_CYCLES 1
+#endif
+
+#if defined(__linux__)
+#include <linux/perf_event.h> // perf_event_attr, PERF_*
+#include <sys/ioctl.h> // ioctl
+#include <sys/syscall.h> // SYS_perf_event_open
+#define AL_BENCH_PERF 1
+#endif
+
+#include "al.h"
+#include "batch.h" // al_batch_init
+#include "cpu.h"
+#include "memory.h" // al_memory_huge_pages
+#include "yuv.h"
+
+#if !defined(AL_BENCH_TARGET)
+#define AL_BENCH_TARGET "unknown"
+#endif
+
+struct size {
+    size_t width;
+    size_t height;
+};
+
+static const struct size sizes[] = {
+    {640, 480},
+    {1280, 720},
+    {1920, 1080},
+    {3840, 2160},
+};
+
+struct kernel {
+    const char *name;
+    enum al_color_format src_format;
+    enum al_color_format dst_format;
+    // The destination is the source transposed (rotate) or halved (resize).
+    bool transpose;
+    bool half;
+    void (*run)(struct al_image *, struct al_image *);
+};
+
+static
+size_t
+_image_size(const struct al_image *x)
+{
+    switch (x->format) {
+        case AL_COLOR_FORMAT_YUV420SP:
+        case AL_COLOR_FORMAT_YUV420P:
+            return x->stride * x->height * 3 / 2;
+        case AL_COLOR_FORMAT_RGBA:
+            return x->stride * x->height * 4;
+        case AL_COLOR_FORMAT_UNKNOWN:
+            break;
+    }
+    return 0;
+}
+
+static
+void
+_yuv_to_rgba_nv12(struct al_image *src, struct al_image *dst)
+{
+    const uint8_t *y = src->data;
+    const uint8_t *uv = y + src->stride * src->height;
+    al_yuv_to_rgba(
+        y, uv, uv + 1, dst->data,
+        src->width, src->height,
+        src->stride, src->stride,
+        1, 2
+    );
+}
+
+static
+void
+_yuv_to_rgba_i420(struct al_image *src, struct al_image *dst)
+{
+    const uint8_t *y = src->data;
+    const uint8_t *u = y + src->stride * src->height;
+    const uint8_t *v = u + (src->stride / 2) * (src->height / 2);
+    al_yuv_to_rgba(
+        y, u, v, dst->data,
+        src->width, src->height,
+        src->stride, src->stride / 2,
+        1, 1
+    );
+}
+
+static
+void
+_nv12_to_i420(struct al_image *src, struct al_image *dst)
+{
+    al_yuv_nv12_to_i420(src->data, dst->data, src->width, src->height);
+}
+
+static
+void
+_i420_to_nv12(struct al_image *src, struct al_image *dst)
+{
+    al_yuv_i420_to_nv12(src->data, dst->data, src->width, src->height);
+}
+
+static
+void
+_image_copy(struct al_image *src, struct al_image *dst)
+{
+    enum al_status status = al_image_copy(src, dst);
+    assert(status == AL_OK);
+    (void) status;
+}
+
+// The copy with each output, regardless of the size (see al.h).
+static
+void
+_image_copy_stream(struct al_image *src, struct al_image *dst)
+{
+    enum al_status status = al_image_copy_output(src, dst, AL_IMAGE_OUTPUT_STREAM);
+    assert(status == AL_OK);
+    (void) status;
+}
+
+static
+void
+_image_copy_cache(struct al_image *src, struct al_image *dst)
+{
+    enum al_status status = al_image_copy_output(src, dst, AL_IMAGE_OUTPUT_CACHE);
+    assert(status == AL_OK);
+    (void) status;
+}
+
+static
+void
+_image_convert(struct al_image *src, struct al_image *dst)
+{
+    enum al_status status = al_image_convert(src, dst);
+    assert(status == AL_OK);
+    (void) status;
+}
+
+static
+void
+_image_convert_stream(struct al_image *src, struct al_image *dst)
+{
+    enum al_status status = al_image_convert_output(src, dst, AL_IMAGE_OUTPUT_STREAM);
+    assert(status == AL_OK);
+    (void) status;
+}
+
+static
+void
+_image_convert_cache(struct al_image *src, struct al_image *dst)
+{
+    enum al_status status = al_image_convert_output(src, dst, AL_IMAGE_OUTPUT_CACHE);
+    assert(status == AL_OK);
+    (void) status;
+}
+
+static
+void
+_image_resize(struct al_image *src, struct al_image *dst)
+{
+    enum al_status status = al_image_resize(src, dst);
+    assert(status == AL_OK);
+    (void) status;
+}
+
+static
+void
+_image_rotate_90(struct al_image *src, struct al_image *dst)
+{
+    enum al_status status = al_image_rotate(src, dst, 90);
+    assert(status == AL_OK);
+    (void) status;
+}
+
+#define NV12 AL_COLOR_FORMAT_YUV420SP
+#define I420 AL_COLOR_FORMAT_YUV420P
+#define RGBA AL_COLOR_FORMAT_RGBA
+
+// Add new kernels here.
+static const struct kernel kernels[] = {
+    {"yuv_to_rgba_nv12", NV12, RGBA, false, false, _yuv_to_rgba_nv12},
+    {"yuv_to_rgba_i420", I420, RGBA, false, false, _yuv_to_rgba_i420},
+    {"yuv_nv12_to_i420", NV12, I420, false, false, _nv12_to_i420},
+    {"yuv_i420_to_nv12", I420, NV12, false, false, _i420_to_nv12},
+    {"image_copy_nv12", NV12, NV12, false, false, _image_copy},
+    {"image_copy_i420", I420, I420, false, false, _image_copy},
+    {"image_copy_rgba", RGBA, RGBA, false, false, _image_copy},
+    {"image_copy_rgba_stream", RGBA, RGBA, false, false, _image_copy_stream},
+    {"image_copy_rgba_cache", RGBA, RGBA, false, false, _image_copy_cache},
+    {"image_convert_nv12_rgba", NV12, RGBA, false, false, _image_convert},
+    {"image_convert_nv12_rgba_stream", NV12, RGBA, false, false, _image_convert_stream},
+    {"image_convert_nv12_rgba_cache", NV12, RGBA, false, false, _image_convert_cache},
+    {"image_convert_nv12_i420", NV12, I420, false, false, _image_convert},
+    {"image_resize_nv12_half", NV12, NV12, false, true, _image_resize},
+    {"image_resize_rgba_half", RGBA, RGBA, false, true, _image_resize},
+    {"image_rotate_nv12_90", NV12, NV12, true, false, _image_rotate_90},
+};
+
+static inline
+uint64_t
+_now(void)
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (uint64_t) t.tv_sec * 1000000000 + (uint64_t) t.tv_nsec;
+}
+
+struct counter {
+    const char *name;
+    uint32_t type;
+    uint64_t config;
+};
+
+#if defined(AL_BENCH_PERF)
+static const struct counter counters[] = {
+    {"cycles", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+    {"instructions", PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+    {"llc_misses", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES},
+    {"branch_misses", PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+    {
+        "dtlb_misses",
+        PERF_TYPE_HW_CACHE,
+        PERF_COUNT_HW_CACHE_DTLB |
+            (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+            (PERF_COUNT_HW_CACHE_RESULT_MISS << 16),
+    },
+};
+#define N_COUNTERS (sizeof (counters) / sizeof (counters[0]))
+#else
+#define N_COUNTERS 0
+#endif
+
+// File descriptors of the counters of this thread, or -1.
+static int perf_fds[N_COUNTERS > 0 ? N_COUNTERS : 1];
+
+static
+void
+_perf_open(void)
+{
+#if defined(AL_BENCH_PERF)
+    for (size_t k = 0; k < N_COUNTERS; k++) {
+        struct perf_event_attr attr = {
+            .type = counters[k].type,
+            .size = sizeof (struct perf_event_attr),
+            .config = counters[k].config,
+            .disabled = 1,
+            .exclude_kernel = 1,
+            .exclude_hv = 1,
+            .read_format =
+                PERF_FORMAT_TOTAL_TIME_ENABLED |
+                PERF_FORMAT_TOTAL_TIME_RUNNING,
+        };
+        perf_fds[k] = (int) syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+        if (perf_fds[k] < 0)
+            fprintf(stderr, "perf_event_open %s: %s\n",
+                counters[k].name, strerror(errno));
+    }
+#endif
+}
+
+static
+void
+_perf_close(void)
+{
+    for (size_t k = 0; k < N_COUNTERS; k++) {
+        if (perf_fds[k] >= 0)
+            close(perf_fds[k]);
+        perf_fds[k] = -1;
+    }
+}
+
+static inline
+void
+_perf_start(void)
+{
+#if defined(AL_BENCH_PERF)
+    for (size_t k = 0; k < N_COUNTERS; k++) {
+        if (perf_fds[k] < 0)
+            continue;
+        ioctl(perf_fds[k], PERF_EVENT_IOC_RESET, 0);
+        ioctl(perf_fds[k], PERF_EVENT_IOC_ENABLE, 0);
+    }
+#endif
+}
+
+// Stop the counters and read them into x, scaled if multiplexed, or NAN.
+static inline
+void
+_perf_stop(double *x)
+{
+#if defined(AL_BENCH_PERF)
+    for (size_t k = 0; k < N_COUNTERS; k++) {
+        if (perf_fds[k] >= 0)
+            ioctl(perf_fds[k], PERF_EVENT_IOC_DISABLE, 0);
+    }
+    for (size_t k = 0; k < N_COUNTERS; k++) {
+        x[k] = NAN;
+        uint64_t value[3]; // value, time enabled, time running
+        if (perf_fds[k] < 0)
+            continue;
+        if (read(perf_fds[k], value, sizeof (value)) != sizeof (value))
+            continue;
+        if (value[2] == 0)
+            continue;
+        x[k] = (double) value[0] * (double) value[1] / (double) value[2];
+    }
+#else
+    (void) x;
+#endif
+}
+
+static inline
+uint64_t
+_cycles(void)
+{
+#if defined(AL_BENCH_CYCLES)
+    return __rdtsc();
+#else
+    return 0;
+#endif
+}
+
+static
+int
+_compare(const void *a, const void *b)
+{
+    const double x = *(const double *) a;
+    const double y = *(const double *) b;
+    return (x > y) - (x < y);
+}
+
+struct stats {
+    double min;
+    double max;
+    double mean;
+    double median;
+    double stddev;
+};
+
+static
+struct stats
+_stats(double *x, size_t n)
+{
+    assert(n > 0);
+    qsort(x, n, sizeof (double), _compare);
+    double sum = 0;
+    for (size_t i = 0; i < n; i++)
+        sum += x[i];
+    const double mean = sum / (double) n;
+    double var = 0;
+    for (size_t i = 0; i < n; i++)
+        var += (x[i] - mean) * (x[i] - mean);
+    return (struct stats) {
+        .min = x[0],
+        .max = x[n - 1],
+        .mean = mean,
+        .median = n % 2 ? x[n / 2] : (x[n / 2 - 1] + x[n / 2]) / 2,
+        .stddev = n > 1 ? sqrt(var / (double) (n - 1)) : 0,
+    };
+}
+
+static
+bool
+_selected(const char *name, int argc, char **argv)
+{
+    if (argc == 0)
+        return true;
+    for (int i = 0; i < argc; i++) {
+        if (strstr(name, argv[i]) != NULL)
+            return true;
+    }
+    return false;
+}
+
+static
+int
+_bench(
+    const struct kernel *kernel,
+    struct size size,
+    size_t warmup,
+    size_t repeat,
+    bool perf,
+    bool first
+) {
+    struct al_image src = {
+        .width = size.width,
+        .height = size.height,
+        .stride = size.width,
+        .format = kernel->src_format,
+    };
+    struct al_image dst = {
+        .width = size.width,
+        .height = size.height,
+        .stride = size.width,
+        .format = kernel->dst_format,
+    };
+    if (kernel->transpose) {
+        dst.width = dst.stride = size.height;
+        dst.height = size.width;
+    }
+    if (kernel->half) {
+        dst.width = dst.stride = size.width / 2;
+        dst.height = size.height / 2;
+    }
+    double *ns = calloc(repeat, sizeof (double));
+    double *cycles = calloc(repeat, sizeof (double));
+    // counts[k * repeat + i] is counter k of run i.
+    double *counts = calloc(repeat * (N_COUNTERS + 1), sizeof (double));
+    double *run = calloc(N_COUNTERS + 1, sizeof (double));
+    if (ns == NULL || cycles == NULL || counts == NULL || run == NULL)
+        goto error;
+    if (al_image_alloc(&src) != AL_OK)
+        goto error;
+    if (al_image_alloc(&dst) != AL_OK)
+        goto error;
+    uint8_t *data = src.data;
+    for (size_t i = 0; i < _image_size(&src); i++)
+        data[i] = (uint8_t) (i * 31 + 7);
+    memset(dst.data, 0, _image_size(&dst));
+
+    for (size_t i = 0; i < warmup; i++)
+        kernel->run(&src, &dst);
+    for (size_t i = 0; i < repeat; i++) {
+        if (perf)
+            _perf_start();
+        const uint64_t c0 = _cycles();
+        const uint64_t t0 = _now();
+        kernel->run(&src, &dst);
+        const uint64_t t1 = _now();
+        const uint64_t c1 = _cycles();
+        if (perf) {
+            _perf_stop(run);
+            for (size_t k = 0; k < N_COUNTERS; k++)
+                counts[k * repeat + i] = run[k];
+        }
+        ns[i] = (double) (t1 - t0);
+        cycles[i] = (double) (c1 - c0);
+    }
+
+    const double pixels = (double) (size.width * size.height);
+    const double bytes = (double) (_image_size(&src) + _image_size(&dst));
+    const struct stats t = _stats(ns, repeat);
+    const struct stats c = _stats(cycles, repeat);
+    printf("%s\n    {", first ? "" : ",");
+    printf("\"kernel\": \"%s\", ", kernel->name);
+    printf("\"width\": %zu, \"height\": %zu, ", size.width, size.height);
+    printf("\"bytes\": %.0f, ", bytes);
+    printf(
+        "\"ns\": {\"min\": %.0f, \"median\": %.0f, \"mean\": %.0f, "
+        "\"max\": %.0f, \"stddev\": %.0f}, ",
+        t.min, t.median, t.mean, t.max, t.stddev
+    );
+    printf("\"mpix_s\": %.3f, ", pixels / t.median * 1e3);
+    printf("\"gb_s\": %.3f, ", bytes / t.median);
+#if defined(AL_BENCH_CYCLES)
+    printf("\"cycles_per_pixel\": %.3f", c.median / pixels);
+#else
+    (void) c;
+    printf("\"cycles_per_pixel\": null");
+#endif
+    if (perf) {
+        printf(", \"perf\": {");
+        for (size_t k = 0; k < N_COUNTERS; k++) {
+            const struct stats x = _stats(&counts[k * repeat], repeat);
+            printf("%s\"%s_per_pixel\": ", k > 0 ? ", " : "", counters[k].name);
+            if (isnan(x.median))
+                printf("null");
+            else
+                printf("%.4f", x.median / pixels);
+        }
+        printf("}");
+    }
+    printf("}");
+    fflush(stdout);
+
+    al_image_free(&src);
+    al_image_free(&dst);
+    free(ns);
+    free(cycles);
+    free(counts);
+    free(run);
+    return 0;
+
+error:
+    fprintf(stderr, "%s: out of memory\n", kernel->name);
+    al_image_free(&src);
+    al_image_free(&dst);
+    free(ns);
+    free(cycles);
+    free(counts);
+    free(run);
+    return 1;
+}
+
+int
+main(int argc, char **argv)
+{
+    size_t warmup = 3;
+    size_t repeat = 20;
+    struct size size = {0, 0};
+    bool perf = false;
+    int opt;
+    while ((opt = getopt(argc, argv, "pw:r:s:")) != -1) {
+        switch (opt) {
+            case 'p':
+                if (N_COUNTERS == 0) {
+                    fprintf(stderr, "-p: not supported on this system\n");
+                    return 2;
+                }
+                perf = true;
+                break;
+            case 'w':
+                warmup = strtoul(optarg, NULL, 10);
+                break;
+            case 'r':
+                repeat = strtoul(optarg, NULL, 10);
+                break;
+            case 's':
+                if (sscanf(optarg, "%zux%zu", &size.width, &size.height) != 2)
+                    goto usage;
+                break;
+            default:
+                goto usage;
+        }
+    }
+    if (repeat == 0)
+        goto usage;
+    if (size.width % 2 || size.height % 2)
+        goto usage;
+
+    al_kernels_init();
+    // The counters follow this thread only, so with -p every kernel runs
+    // on it, without the worker pool.
+    if (!perf)
+        al_batch_init();
+    for (size_t k = 0; k < N_COUNTERS; k++)
+        perf_fds[k] = -1;
+    if (perf)
+        _perf_open();
+
+    printf("{\n");
+    printf("  \"version\": 1,\n");
+    printf("  \"target\": \"%s\",\n", AL_BENCH_TARGET);
+    printf("  \"cpu\": \"%s\",\n", al_cpu_level());
+    printf("  \"hugepages\": \"%s\",\n", al_memory_huge_pages());
+#if defined(NDEBUG)
+    printf("  \"debug\": false,\n");
+#else
+    printf("  \"debug\": true,\n");
+#endif
+    printf("  \"warmup\": %zu,\n", warmup);
+    printf("  \"repeat\": %zu,\n", repeat);
+    printf("  \"results\": [");
+    bool first = true;
+    int status = 0;
+    for (size_t i = 0; i < sizeof (kernels) / sizeof (kernels[0]); i++) {
+        if (!_selected(kernels[i].name, argc - optind, argv + optind))
+            continue;
+        for (size_t j = 0; j < sizeof (sizes) / sizeof (sizes[0]); j++) {
+            struct size s = size.width > 0 ? size : sizes[j];
+            const int failed = _bench(&kernels[i], s, warmup, repeat, perf, first);
+            status |= failed;
+            // A failed run prints nothing, so the next is still first.
+            if (!failed)
+                first = false;
+            if (size.width > 0)
+                break;
+        }
+    }
+    printf("\n  ]\n}\n");
+    _perf_close();
+    return status;
+
+usage:
+    fprintf(
+        stderr,
+        "usage: %s [-p] [-w warmup] [-r repeat] [-s WIDTHxHEIGHT] "
+            "[kernel ...]\n",
+        argv[0]
+    );
+    return 2;
+}
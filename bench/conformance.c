@@ -0,0 +1,785 @@
+/* Copyright 2023-2025, Mansour Moufid <mansourmoufid@gmail.com> */
+
+/*
+ * This file is part of Aluminium Library.
+ *
+ * Aluminium Library is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Aluminium Library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with Aluminium Library. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Differential conformance tests.
+ *
+ *     conformance [-s seed] [-n rounds]
+ *
+ * Every variant in al_yuv_variants is run against a reference
+ * (_al_yuv_to_rgba_generic for the conversion to RGBA, which every variant
+ * specializes), and al_image_copy, al_image_convert and al_image_resize
+ * with each variant in al_image_variants (and each output of the copy and
+ * the conversion, see al_image_copy_output); the other references are
+ * simple loops written here. The inputs
+ * cover odd and even sizes (multiples of 16 and 32 or not), padded
+ * strides, unaligned pointers and several byte patterns (plus random
+ * ones, from the seed). Outputs are compared byte for byte, including the
+ * bytes around them, and the first mismatch is reported. Then each
+ * variant is timed on a 1280x720 frame. Set AL_CPU to test as if on a
+ * lesser CPU (see cpu.c).
+ */
+
+#include <assert.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h> // calloc, free, qsort, strtoul
+#include <string.h> // memcmp, memset
+#include <time.h> // clock_gettime
+#include <unistd.h> // getopt
+
+#include "al.h"
+#include "batch.h" // al_batch_init
+#include "cpu.h"
+#include "yuv.h"
+
+static const size_t widths[] = {
+    1, 2, 3, 4, 5, 6, 7, 8, 15, 16, 17, 31, 32, 33, 63, 64, 65, 130,
+};
+static const size_t heights[] = {
+    1, 2, 3, 4, 5, 8, 9, 16, 17,
+};
+// Extra bytes per row, and byte offsets from an aligned pointer.
+static const size_t pads[] = {0, 1, 3, 16};
+static const size_t offsets[] = {0, 1, 3};
+
+enum pattern {
+    PATTERN_ZERO,
+    PATTERN_MAX,
+    PATTERN_RAMP,
+    PATTERN_CHECKER,
+    PATTERN_RANDOM,
+    PATTERN_COUNT,
+};
+
+static const char *const pattern_names[] = {
+    "zero",
+    "max",
+    "ramp",
+    "checker",
+    "random",
+};
+
+// Bytes outside the outputs, which no kernel should write.
+#define CANARY 0xa5
+
+// Room before and after each buffer, for odd heights and offsets.
+#define SLACK 64
+
+static uint64_t state = 0x9e3779b97f4a7c15;
+
+static inline
+uint8_t
+_random(void)
+{
+    // xorshift64
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+    return (uint8_t) (state >> 56);
+}
+
+static
+void
+_fill(uint8_t *x, size_t n, enum pattern pattern)
+{
+    for (size_t i = 0; i < n; i++) {
+        switch (pattern) {
+            case PATTERN_ZERO:
+                x[i] = 0;
+                break;
+            case PATTERN_MAX:
+                x[i] = 0xff;
+                break;
+            case PATTERN_RAMP:
+                x[i] = (uint8_t) i;
+                break;
+            case PATTERN_CHECKER:
+                x[i] = (i & 1) ? 0xff : 0;
+                break;
+            case PATTERN_RANDOM:
+            case PATTERN_COUNT:
+                x[i] = _random();
+                break;
+        }
+    }
+}
+
+struct buffer {
+    uint8_t *base;
+    uint8_t *data;
+    size_t size;
+};
+
+static
+bool
+_buffer(struct buffer *x, size_t size, size_t offset)
+{
+    // Aligned to 4 bytes for the RGBA outputs (uint32_t).
+    x->base = NULL;
+    if (posix_memalign((void **) &x->base, 64, size + 2 * SLACK) != 0)
+        return false;
+    x->data = x->base + SLACK + offset;
+    x->size = size;
+    memset(x->base, CANARY, size + 2 * SLACK);
+    return true;
+}
+
+struct mismatch {
+    const char *kernel;
+    const char *variant;
+    size_t width;
+    size_t height;
+    size_t stride;
+    size_t offset;
+    enum pattern pattern;
+};
+
+/*
+ * Compare the whole of two buffers, including the slack around them.
+ * The output's first plane has height rows, stride bytes apart, of bpp
+ * bytes per pixel, to locate the mismatch.
+ */
+static
+bool
+_compare(
+    const struct mismatch *m,
+    const struct buffer *expected,
+    const struct buffer *actual,
+    size_t stride,
+    size_t height,
+    size_t bpp
+) {
+    const uint8_t *x = expected->base;
+    const uint8_t *y = actual->base;
+    const size_t n = expected->size + 2 * SLACK;
+    for (size_t i = 0; i < n; i++) {
+        if (x[i] == y[i])
+            continue;
+        printf(
+            "FAIL %s %s %zux%zu stride=%zu offset=%zu pattern=%s: ",
+            m->kernel, m->variant,
+            m->width, m->height, m->stride, m->offset,
+            pattern_names[m->pattern]
+        );
+        const long j = (long) i - (long) (expected->data - expected->base);
+        if (j < 0 || (size_t) j >= expected->size) {
+            printf("byte %ld outside the output", j);
+        } else {
+            const size_t k = (size_t) j;
+            const size_t plane = stride * height;
+            if (k < plane) {
+                printf(
+                    "pixel (%zu, %zu) byte %zu",
+                    (k % stride) / bpp, k / stride, k % bpp
+                );
+            } else {
+                printf("chroma byte %zu", k - plane);
+            }
+        }
+        printf(": expected %u, got %u\n", x[i], y[i]);
+        return false;
+    }
+    return true;
+}
+
+typedef bool (*test_t)(const struct al_yuv_variant *, struct mismatch *);
+
+/*
+ * YUV variants
+ */
+
+static
+bool
+_test_to_rgba(const struct al_yuv_variant *variant, struct mismatch *m)
+{
+    if (variant->to_rgba == NULL)
+        return true;
+    al_yuv_to_rgb_t *reference = _al_yuv_to_rgba_generic;
+    bool ok = false;
+    const size_t w = m->width;
+    const size_t h = m->height;
+    const size_t stride = m->stride;
+    const size_t chroma = (h + 1) / 2;
+    struct buffer src = {0};
+    struct buffer x = {0};
+    struct buffer y = {0};
+    if (!_buffer(&src, stride * (h + 2 * chroma), m->offset))
+        goto done;
+    if (!_buffer(&x, w * h * 4, 0) || !_buffer(&y, w * h * 4, 0))
+        goto done;
+    _fill(src.data, src.size, m->pattern);
+    const uint8_t *luma = src.data;
+    const uint8_t *u = luma + stride * h;
+    // NV12, then I420 with half strides.
+    reference(luma, u, u + 1, (uint32_t *) x.data, w, h, stride, stride, 1, 2);
+    variant->to_rgba(luma, u, u + 1, (uint32_t *) y.data, w, h, stride, stride, 1, 2);
+    m->kernel = "yuv_to_rgba_nv12";
+    if (!_compare(m, &x, &y, w * 4, h, 4))
+        goto done;
+    const size_t half = (stride + 1) / 2;
+    const uint8_t *v = u + half * chroma;
+    reference(luma, u, v, (uint32_t *) x.data, w, h, stride, half, 1, 1);
+    variant->to_rgba(luma, u, v, (uint32_t *) y.data, w, h, stride, half, 1, 1);
+    m->kernel = "yuv_to_rgba_i420";
+    ok = _compare(m, &x, &y, w * 4, h, 4);
+done:
+    free(src.base);
+    free(x.base);
+    free(y.base);
+    return ok;
+}
+
+/*
+ * NV12 to I420 and back, one pixel pair at a time. Like the kernels, they
+ * skip the last column of an odd width.
+ */
+static
+void
+_reference_nv12_to_i420(const uint8_t *src, uint8_t *dst, size_t w, size_t h)
+{
+    const uint8_t *uv = src + w * h;
+    uint8_t *u = dst + w * h;
+    uint8_t *v = u + (w / 2) * (h / 2);
+    for (size_t i = 0; i < h; i++) {
+        for (size_t j = 0; j < w / 2; j++) {
+            dst[w * i + 2 * j] = src[w * i + 2 * j];
+            dst[w * i + 2 * j + 1] = src[w * i + 2 * j + 1];
+            u[(w / 2) * (i / 2) + j] = uv[w * (i / 2) + 2 * j];
+            v[(w / 2) * (i / 2) + j] = uv[w * (i / 2) + 2 * j + 1];
+        }
+    }
+}
+
+static
+void
+_reference_i420_to_nv12(const uint8_t *src, uint8_t *dst, size_t w, size_t h)
+{
+    const uint8_t *u = src + w * h;
+    const uint8_t *v = u + (w / 2) * (h / 2);
+    uint8_t *uv = dst + w * h;
+    for (size_t i = 0; i < h; i++) {
+        for (size_t j = 0; j < w / 2; j++) {
+            dst[w * i + 2 * j] = src[w * i + 2 * j];
+            dst[w * i + 2 * j + 1] = src[w * i + 2 * j + 1];
+            uv[w * (i / 2) + 2 * j] = u[(w / 2) * (i / 2) + j];
+            uv[w * (i / 2) + 2 * j + 1] = v[(w / 2) * (i / 2) + j];
+        }
+    }
+}
+
+static
+bool
+_test_repack(const struct al_yuv_variant *variant, struct mismatch *m)
+{
+    bool ok = false;
+    const size_t w = m->width;
+    const size_t h = m->height;
+    const size_t size = w * (h + (h + 1) / 2 + 1);
+    struct buffer src = {0};
+    struct buffer x = {0};
+    struct buffer y = {0};
+    if (!_buffer(&src, size, m->offset))
+        goto done;
+    if (!_buffer(&x, size, 0) || !_buffer(&y, size, 0))
+        goto done;
+    _fill(src.data, src.size, m->pattern);
+    // These kernels have no stride.
+    if (variant->nv12_to_i420 != NULL) {
+        _reference_nv12_to_i420(src.data, x.data, w, h);
+        variant->nv12_to_i420(src.data, y.data, w, h);
+        m->kernel = "yuv_nv12_to_i420";
+        if (!_compare(m, &x, &y, w, h, 1))
+            goto done;
+    }
+    if (variant->i420_to_nv12 != NULL) {
+        _reference_i420_to_nv12(src.data, x.data, w, h);
+        variant->i420_to_nv12(src.data, y.data, w, h);
+        m->kernel = "yuv_i420_to_nv12";
+        if (!_compare(m, &x, &y, w, h, 1))
+            goto done;
+    }
+    ok = true;
+done:
+    free(src.base);
+    free(x.base);
+    free(y.base);
+    return ok;
+}
+
+/*
+ * Image operations, against references
+ */
+
+static
+size_t
+_size(enum al_color_format format, size_t stride, size_t height)
+{
+    if (format == AL_COLOR_FORMAT_RGBA)
+        return stride * height * 4;
+    return stride * height * 3 / 2;
+}
+
+static
+void
+_reference_copy(const struct al_image *src, struct al_image *dst)
+{
+    const size_t bpp = src->format == AL_COLOR_FORMAT_RGBA ? 4 : 1;
+    const uint8_t *s = src->data;
+    uint8_t *d = dst->data;
+    for (size_t i = 0; i < src->height; i++)
+        memcpy(&d[i * dst->stride * bpp], &s[i * src->stride * bpp], src->width * bpp);
+    if (src->format == AL_COLOR_FORMAT_RGBA)
+        return;
+    s += src->height * src->stride;
+    d += dst->height * dst->stride;
+    if (src->format == AL_COLOR_FORMAT_YUV420SP) {
+        for (size_t i = 0; i < src->height / 2; i++)
+            memcpy(&d[i * dst->stride], &s[i * src->stride], src->width);
+        return;
+    }
+    for (size_t k = 0; k < 2; k++) {
+        for (size_t i = 0; i < src->height / 2; i++) {
+            memcpy(
+                &d[(k * (dst->height / 2) + i) * (dst->stride / 2)],
+                &s[(k * (src->height / 2) + i) * (src->stride / 2)],
+                src->width / 2
+            );
+        }
+    }
+}
+
+static
+void
+_reference_convert(const struct al_image *src, struct al_image *dst)
+{
+    const uint8_t *y = src->data;
+    const uint8_t *uv = y + src->height * src->stride;
+    const size_t uv_size = (src->height / 2) * (src->stride / 2);
+    uint8_t *d = dst->data;
+    if (dst->format == AL_COLOR_FORMAT_RGBA) {
+        for (size_t i = 0; i < src->height; i++) {
+            const uint8_t *u;
+            const uint8_t *v;
+            size_t uv_stride;
+            size_t uv_pixel_stride;
+            if (src->format == AL_COLOR_FORMAT_YUV420SP) {
+                u = uv + (i / 2) * src->stride;
+                v = u + 1;
+                uv_stride = src->stride;
+                uv_pixel_stride = 2;
+            } else {
+                u = uv + (i / 2) * (src->stride / 2);
+                v = u + uv_size;
+                uv_stride = src->stride / 2;
+                uv_pixel_stride = 1;
+            }
+            _al_yuv_to_rgba_generic(
+                &y[i * src->stride], u, v,
+                (uint32_t *) &d[i * dst->stride * 4],
+                src->width, 1, src->stride, uv_stride, 1, uv_pixel_stride
+            );
+        }
+        return;
+    }
+    for (size_t i = 0; i < src->height; i++)
+        memcpy(&d[i * dst->stride], &y[i * src->stride], src->width);
+    d += dst->height * dst->stride;
+    const size_t d_uv_size = (dst->height / 2) * (dst->stride / 2);
+    for (size_t i = 0; i < src->height / 2; i++) {
+        for (size_t j = 0; j < src->width / 2; j++) {
+            if (src->format == AL_COLOR_FORMAT_YUV420SP) {
+                d[i * (dst->stride / 2) + j] = uv[i * src->stride + 2 * j];
+                d[d_uv_size + i * (dst->stride / 2) + j] =
+                    uv[i * src->stride + 2 * j + 1];
+            } else {
+                d[i * dst->stride + 2 * j] =
+                    uv[i * (src->stride / 2) + j];
+                d[i * dst->stride + 2 * j + 1] =
+                    uv[uv_size + i * (src->stride / 2) + j];
+            }
+        }
+    }
+}
+
+static
+void
+_reference_resize_plane(
+    uint8_t *dst, size_t dst_stride, size_t dst_width, size_t dst_height,
+    const uint8_t *src, size_t src_stride, size_t src_width, size_t src_height,
+    size_t bpp
+) {
+    const uint64_t dx = ((uint64_t) src_width << 16) / dst_width;
+    const uint64_t dy = ((uint64_t) src_height << 16) / dst_height;
+    for (size_t i = 0; i < dst_height; i++) {
+        const size_t si = (size_t) ((dy / 2 + i * dy) >> 16);
+        for (size_t j = 0; j < dst_width; j++) {
+            const size_t sj = (size_t) ((dx / 2 + j * dx) >> 16);
+            for (size_t k = 0; k < bpp; k++) {
+                dst[i * dst_stride + j * bpp + k] =
+                    src[si * src_stride + sj * bpp + k];
+            }
+        }
+    }
+}
+
+static
+void
+_reference_resize(const struct al_image *src, struct al_image *dst)
+{
+    const uint8_t *s = src->data;
+    uint8_t *d = dst->data;
+    if (src->format == AL_COLOR_FORMAT_RGBA) {
+        _reference_resize_plane(
+            d, dst->stride * 4, dst->width, dst->height,
+            s, src->stride * 4, src->width, src->height, 4
+        );
+        return;
+    }
+    _reference_resize_plane(
+        d, dst->stride, dst->width, dst->height,
+        s, src->stride, src->width, src->height, 1
+    );
+    s += src->height * src->stride;
+    d += dst->height * dst->stride;
+    if (src->format == AL_COLOR_FORMAT_YUV420SP) {
+        _reference_resize_plane(
+            d, dst->stride, dst->width / 2, dst->height / 2,
+            s, src->stride, src->width / 2, src->height / 2, 2
+        );
+        return;
+    }
+    for (size_t k = 0; k < 2; k++) {
+        _reference_resize_plane(
+            d + k * (dst->height / 2) * (dst->stride / 2),
+            dst->stride / 2, dst->width / 2, dst->height / 2,
+            s + k * (src->height / 2) * (src->stride / 2),
+            src->stride / 2, src->width / 2, src->height / 2, 1
+        );
+    }
+}
+
+enum operation {
+    OPERATION_COPY,
+    OPERATION_COPY_STREAM,
+    OPERATION_COPY_CACHE,
+    OPERATION_CONVERT,
+    OPERATION_CONVERT_STREAM,
+    OPERATION_RESIZE,
+};
+
+static
+bool
+_test_image(
+    struct mismatch *m,
+    enum operation operation,
+    enum al_color_format src_format,
+    enum al_color_format dst_format
+) {
+    // The YUV formats need even sizes, and the I420 strides too.
+    const size_t w = m->width & ~(size_t) 1;
+    const size_t h = m->height & ~(size_t) 1;
+    if (w == 0 || h == 0)
+        return true;
+    const size_t src_stride = w + (m->stride - m->width + 1) / 2 * 2;
+    const size_t dst_stride = w + 2;
+    size_t dst_width = w;
+    size_t dst_height = h;
+    if (operation == OPERATION_RESIZE) {
+        dst_width = w / 2 > 2 ? w / 2 : w;
+        dst_height = h + 2;
+    }
+    bool ok = false;
+    struct buffer src = {0};
+    struct buffer x = {0};
+    struct buffer y = {0};
+    const size_t dst_size = _size(dst_format, dst_stride, dst_height);
+    if (!_buffer(&src, _size(src_format, src_stride, h), m->offset * 4))
+        goto done;
+    if (!_buffer(&x, dst_size, m->offset * 4))
+        goto done;
+    if (!_buffer(&y, dst_size, m->offset * 4))
+        goto done;
+    _fill(src.data, src.size, m->pattern);
+    struct al_image a = {
+        .width = w,
+        .height = h,
+        .stride = src_stride,
+        .data = src.data,
+        .format = src_format,
+    };
+    struct al_image b = {
+        .width = dst_width,
+        .height = dst_height,
+        .stride = dst_stride,
+        .data = x.data,
+        .format = dst_format,
+    };
+    struct al_image c = b;
+    c.data = y.data;
+    enum al_status status = AL_ERROR;
+    switch (operation) {
+        case OPERATION_COPY:
+            m->kernel = "al_image_copy";
+            _reference_copy(&a, &b);
+            status = al_image_copy(&a, &c);
+            break;
+        case OPERATION_COPY_STREAM:
+            m->kernel = "al_image_copy_output_stream";
+            _reference_copy(&a, &b);
+            status = al_image_copy_output(&a, &c, AL_IMAGE_OUTPUT_STREAM);
+            break;
+        case OPERATION_COPY_CACHE:
+            m->kernel = "al_image_copy_output_cache";
+            _reference_copy(&a, &b);
+            status = al_image_copy_output(&a, &c, AL_IMAGE_OUTPUT_CACHE);
+            break;
+        case OPERATION_CONVERT:
+            m->kernel = "al_image_convert";
+            _reference_convert(&a, &b);
+            status = al_image_convert(&a, &c);
+            break;
+        case OPERATION_CONVERT_STREAM:
+            m->kernel = "al_image_convert_output_stream";
+            _reference_convert(&a, &b);
+            status = al_image_convert_output(&a, &c, AL_IMAGE_OUTPUT_STREAM);
+            break;
+        case OPERATION_RESIZE:
+            m->kernel = "al_image_resize";
+            _reference_resize(&a, &b);
+            status = al_image_resize(&a, &c);
+            break;
+    }
+    if (status != AL_OK) {
+        printf("FAIL %s: %s\n", m->kernel, al_status_string(status));
+        goto done;
+    }
+    const size_t bpp = dst_format == AL_COLOR_FORMAT_RGBA ? 4 : 1;
+    ok = _compare(m, &x, &y, dst_stride * bpp, dst_height, bpp);
+done:
+    free(src.base);
+    free(x.base);
+    free(y.base);
+    return ok;
+}
+
+static
+bool
+_test_images(const struct al_image_variant *variant, struct mismatch *m)
+{
+    // Run libal with this variant's kernels.
+    const struct al_kernels kernels = al_kernels;
+    if (variant->copy_plane != NULL)
+        al_kernels.copy_plane = variant->copy_plane;
+    if (variant->resize_plane != NULL)
+        al_kernels.resize_plane = variant->resize_plane;
+    if (variant->rotate_plane != NULL)
+        al_kernels.rotate_plane = variant->rotate_plane;
+    const enum al_color_format NV12 = AL_COLOR_FORMAT_YUV420SP;
+    const enum al_color_format I420 = AL_COLOR_FORMAT_YUV420P;
+    const enum al_color_format RGBA = AL_COLOR_FORMAT_RGBA;
+    const bool ok = _test_image(m, OPERATION_COPY, NV12, NV12)
+        && _test_image(m, OPERATION_COPY, I420, I420)
+        && _test_image(m, OPERATION_COPY, RGBA, RGBA)
+        && _test_image(m, OPERATION_COPY_STREAM, NV12, NV12)
+        && _test_image(m, OPERATION_COPY_STREAM, I420, I420)
+        && _test_image(m, OPERATION_COPY_STREAM, RGBA, RGBA)
+        && _test_image(m, OPERATION_COPY_CACHE, I420, I420)
+        && _test_image(m, OPERATION_COPY_CACHE, RGBA, RGBA)
+        && _test_image(m, OPERATION_CONVERT, NV12, RGBA)
+        && _test_image(m, OPERATION_CONVERT, I420, RGBA)
+        && _test_image(m, OPERATION_CONVERT, NV12, I420)
+        && _test_image(m, OPERATION_CONVERT, I420, NV12)
+        && _test_image(m, OPERATION_CONVERT_STREAM, NV12, RGBA)
+        && _test_image(m, OPERATION_CONVERT_STREAM, I420, RGBA)
+        && _test_image(m, OPERATION_CONVERT_STREAM, NV12, I420)
+        && _test_image(m, OPERATION_RESIZE, NV12, NV12)
+        && _test_image(m, OPERATION_RESIZE, I420, I420)
+        && _test_image(m, OPERATION_RESIZE, RGBA, RGBA);
+    al_kernels = kernels;
+    return ok;
+}
+
+/*
+ * Timings
+ */
+
+static inline
+uint64_t
+_now(void)
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (uint64_t) t.tv_sec * 1000000000 + (uint64_t) t.tv_nsec;
+}
+
+static
+int
+_compare_u64(const void *a, const void *b)
+{
+    const uint64_t x = *(const uint64_t *) a;
+    const uint64_t y = *(const uint64_t *) b;
+    return (x > y) - (x < y);
+}
+
+#define TIMING_WIDTH 1280
+#define TIMING_HEIGHT 720
+#define TIMING_REPEAT 11
+
+static
+void
+_time(const struct al_yuv_variant *variant)
+{
+    const size_t w = TIMING_WIDTH;
+    const size_t h = TIMING_HEIGHT;
+    uint8_t *src = calloc(w * h * 3 / 2, 1);
+    uint8_t *dst = calloc(w * h * 4, 1);
+    if (src == NULL || dst == NULL)
+        goto done;
+    _fill(src, w * h * 3 / 2, PATTERN_RANDOM);
+    const char *names[] = {
+        "yuv_to_rgba_nv12",
+        "yuv_nv12_to_i420",
+        "yuv_i420_to_nv12",
+    };
+    for (size_t k = 0; k < 3; k++) {
+        uint64_t t[TIMING_REPEAT];
+        for (size_t i = 0; i < TIMING_REPEAT; i++) {
+            const uint64_t t0 = _now();
+            switch (k) {
+                case 0:
+                    if (variant->to_rgba == NULL)
+                        goto next;
+                    variant->to_rgba(
+                        src, src + w * h, src + w * h + 1, (uint32_t *) dst,
+                        w, h, w, w, 1, 2
+                    );
+                    break;
+                case 1:
+                    if (variant->nv12_to_i420 == NULL)
+                        goto next;
+                    variant->nv12_to_i420(src, dst, w, h);
+                    break;
+                case 2:
+                    if (variant->i420_to_nv12 == NULL)
+                        goto next;
+                    variant->i420_to_nv12(src, dst, w, h);
+                    break;
+            }
+            t[i] = _now() - t0;
+        }
+        qsort(t, TIMING_REPEAT, sizeof (uint64_t), _compare_u64);
+        printf(
+            "time %s %s %zux%zu median_ns=%llu min_ns=%llu\n",
+            names[k], variant->name, w, h,
+            (unsigned long long) t[TIMING_REPEAT / 2],
+            (unsigned long long) t[0]
+        );
+next:
+        continue;
+    }
+done:
+    free(src);
+    free(dst);
+}
+
+int
+main(int argc, char **argv)
+{
+    size_t rounds = 2;
+    int opt;
+    while ((opt = getopt(argc, argv, "s:n:")) != -1) {
+        switch (opt) {
+            case 's':
+                state = strtoull(optarg, NULL, 0) | 1;
+                break;
+            case 'n':
+                rounds = strtoul(optarg, NULL, 10);
+                break;
+            default:
+                fprintf(stderr, "usage: %s [-s seed] [-n rounds]\n", argv[0]);
+                return 2;
+        }
+    }
+    al_kernels_init();
+    al_batch_init();
+    printf("seed %llu\n", (unsigned long long) state);
+    printf("cpu %s\n", al_cpu_level());
+
+    const test_t tests[] = {_test_to_rgba, _test_repack};
+    const size_t ntests = sizeof (tests) / sizeof (tests[0]);
+    const size_t nvariants = al_yuv_variants_count + al_image_variants_count;
+    for (size_t v = 0; v < nvariants; v++) {
+        const struct al_yuv_variant *yuv = NULL;
+        const struct al_image_variant *image = NULL;
+        const char *name;
+        bool (*supported)(void);
+        if (v < al_yuv_variants_count) {
+            yuv = &al_yuv_variants[v];
+            name = yuv->name;
+            supported = yuv->supported;
+        } else {
+            image = &al_image_variants[v - al_yuv_variants_count];
+            name = image->name;
+            supported = image->supported;
+        }
+        if (supported != NULL && !supported()) {
+            printf("skip %s: not supported by this CPU\n", name);
+            continue;
+        }
+        size_t cases = 0;
+        for (size_t t = 0; t < (yuv != NULL ? ntests : 1); t++) {
+            for (size_t r = 0; r < rounds; r++)
+            for (size_t i = 0; i < sizeof (widths) / sizeof (widths[0]); i++)
+            for (size_t j = 0; j < sizeof (heights) / sizeof (heights[0]); j++)
+            for (size_t k = 0; k < sizeof (pads) / sizeof (pads[0]); k++)
+            for (size_t l = 0; l < sizeof (offsets) / sizeof (offsets[0]); l++)
+            for (int p = 0; p < PATTERN_COUNT; p++) {
+                // Only the random pattern changes between rounds.
+                if (r > 0 && p != PATTERN_RANDOM)
+                    continue;
+                struct mismatch m = {
+                    .variant = name,
+                    .width = widths[i],
+                    .height = heights[j],
+                    .stride = widths[i] + pads[k],
+                    .offset = offsets[l],
+                    .pattern = (enum pattern) p,
+                };
+                const bool ok = yuv != NULL
+                    ? tests[t](yuv, &m)
+                    : _test_images(image, &m);
+                if (!ok)
+                    return 1;
+                cases++;
+            }
+        }
+        printf(
+            "ok %s %s: %zu cases\n",
+            yuv != NULL ? "yuv" : "image", name, cases
+        );
+    }
+
+    for (size_t v = 0; v < al_yuv_variants_count; v++) {
+        const struct al_yuv_variant *variant = &al_yuv_variants[v];
+        if (variant->supported == NULL || variant->supported())
+            _time(variant);
+    }
+    return 0;
+}
@@ -64,9 +64,9 @@ else
 CFLAGS+=        -Weverything
 endif
 
+# Newer x86 extensions are used at runtime, if available (see cpu.c).
 ifeq ("$(ARCH)","x86_64")
 CFLAGS+=        -mfpmath=sse
-CFLAGS+=        -msse4.2
 endif
 
 ifeq ("$(ARCH)","armv7")
@@ -143,3 +143,7 @@ endif
 ifeq ("$(ANDROID)","true")
 LDFLAGS+=       -landroid -llog -lcamera2ndk -lm -lmediandk
 endif
+
+ifeq ("$(SYS)","linux")
+LDFLAGS+=       -lpthread
+endif
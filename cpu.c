@@ -0,0 +1,189 @@
+/* Copyright 2023-2025, Mansour Moufid <mansourmoufid@gmail.com> */
+
+/*
+ * This file is part of Aluminium Library.
+ *
+ * Aluminium Library is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Aluminium Library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with Aluminium Library. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdlib.h> // getenv
+#include <string.h> // strcmp
+#include <unistd.h> // sysconf
+#if defined(__APPLE__)
+#include <sys/sysctl.h> // sysctlbyname
+#endif
+
+#include "common.h" // DEBUG
+#include "cpu.h"
+#include "yuv.h"
+
+#define AL_CPU_PROBED (1u << 31)
+
+static atomic_uint _al_cpu_features = 0;
+
+static
+unsigned int
+_probe(void)
+{
+    unsigned int features = 0;
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("sse4.2"))
+        features |= AL_CPU_SSE4_2;
+    if (__builtin_cpu_supports("avx2"))
+        features |= AL_CPU_AVX2;
+    if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw"))
+        features |= AL_CPU_AVX512;
+#elif defined(__aarch64__) || defined(__ARM_NEON)
+    features |= AL_CPU_NEON;
+#endif
+    return features;
+}
+
+static const struct {
+    const char *name;
+    unsigned int features;
+} levels[] = {
+    {"scalar", 0},
+    {"sse4.2", AL_CPU_SSE4_2},
+    {"avx2", AL_CPU_SSE4_2 | AL_CPU_AVX2},
+    {"avx512", AL_CPU_SSE4_2 | AL_CPU_AVX2 | AL_CPU_AVX512},
+    {"neon", AL_CPU_NEON},
+};
+
+__attribute__((visibility("hidden")))
+unsigned int
+al_cpu_features(void)
+{
+    unsigned int features = atomic_load(&_al_cpu_features);
+    if (features & AL_CPU_PROBED)
+        return features & ~AL_CPU_PROBED;
+    features = _probe();
+    const char *level = getenv("AL_CPU");
+    if (level != NULL && level[0] != '\0') {
+        size_t i = 0;
+        for (; i < sizeof (levels) / sizeof (levels[0]); i++) {
+            if (strcmp(level, levels[i].name) == 0) {
+                features &= levels[i].features;
+                break;
+            }
+        }
+        if (i == sizeof (levels) / sizeof (levels[0])) {
+            DEBUG("AL_CPU=%s: unknown level", level);
+        }
+    }
+    atomic_store(&_al_cpu_features, features | AL_CPU_PROBED);
+    return features;
+}
+
+__attribute__((visibility("hidden")))
+const char *
+al_cpu_level(void)
+{
+    const unsigned int features = al_cpu_features();
+    const char *name = levels[0].name;
+    for (size_t i = 0; i < sizeof (levels) / sizeof (levels[0]); i++) {
+        if ((features & levels[i].features) == levels[i].features)
+            name = levels[i].name;
+    }
+    return name;
+}
+
+__attribute__((visibility("hidden")))
+bool
+al_cpu_sse4_2(void)
+{
+    return (al_cpu_features() & AL_CPU_SSE4_2) != 0;
+}
+
+__attribute__((visibility("hidden")))
+bool
+al_cpu_avx2(void)
+{
+    return (al_cpu_features() & AL_CPU_AVX2) != 0;
+}
+
+__attribute__((visibility("hidden")))
+bool
+al_cpu_avx512(void)
+{
+    return (al_cpu_features() & AL_CPU_AVX512) != 0;
+}
+
+/*
+ * The size of the last level cache in bytes, as the system reports it, or
+ * a guess of 8 MB; probed once.
+ */
+__attribute__((visibility("hidden")))
+size_t
+al_cpu_cache_size(void)
+{
+    static atomic_size_t cache_size = 0;
+    size_t size = atomic_load(&cache_size);
+    if (size > 0)
+        return size;
+    long n = -1;
+#if defined(_SC_LEVEL3_CACHE_SIZE)
+    n = sysconf(_SC_LEVEL3_CACHE_SIZE);
+    if (n <= 0)
+        n = sysconf(_SC_LEVEL2_CACHE_SIZE);
+#elif defined(__APPLE__)
+    int64_t x = 0;
+    size_t x_size = sizeof (x);
+    if (sysctlbyname("hw.l3cachesize", &x, &x_size, NULL, 0) == 0 && x > 0)
+        n = (long) x;
+    else if (sysctlbyname("hw.l2cachesize", &x, &x_size, NULL, 0) == 0)
+        n = (long) x;
+#endif
+    size = n > 0 ? (size_t) n : (size_t) 8 << 20;
+    atomic_store(&cache_size, size);
+    return size;
+}
+
+__attribute__((visibility("hidden")))
+struct al_kernels al_kernels = {
+    .to_rgba = _al_yuv_to_rgba_scalar,
+    .nv12_to_i420 = _al_yuv_nv12_to_i420_scalar,
+    .i420_to_nv12 = _al_yuv_i420_to_nv12_scalar,
+    .copy_plane = _al_copy_plane_scalar,
+    .resize_plane = _al_resize_plane_scalar,
+    .rotate_plane = _al_rotate_plane_scalar,
+};
+
+// The variants are listed from the most portable to the fastest.
+#define SELECT(variants, count, kernel) \
+    for (size_t i = 0; i < (count); i++) { \
+        if ((variants)[i].kernel == NULL) \
+            continue; \
+        if ((variants)[i].supported != NULL && !(variants)[i].supported()) \
+            continue; \
+        table.kernel = (variants)[i].kernel; \
+    }
+
+__attribute__((visibility("hidden")))
+void
+al_kernels_init(void)
+{
+    struct al_kernels table = al_kernels;
+    SELECT(al_yuv_variants, al_yuv_variants_count, to_rgba);
+    SELECT(al_yuv_variants, al_yuv_variants_count, nv12_to_i420);
+    SELECT(al_yuv_variants, al_yuv_variants_count, i420_to_nv12);
+    SELECT(al_image_variants, al_image_variants_count, copy_plane);
+    SELECT(al_image_variants, al_image_variants_count, resize_plane);
+    SELECT(al_image_variants, al_image_variants_count, rotate_plane);
+    al_kernels = table;
+    DEBUG("%s", al_cpu_level());
+}
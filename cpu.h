@@ -0,0 +1,113 @@
+/* Copyright 2023-2025, Mansour Moufid <mansourmoufid@gmail.com> */
+
+/*
+ * This file is part of Aluminium Library.
+ *
+ * Aluminium Library is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Aluminium Library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with Aluminium Library. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "yuv.h"
+
+enum al_cpu_feature {
+    AL_CPU_SSE4_2 = 1 << 0,
+    AL_CPU_AVX2 = 1 << 1,
+    AL_CPU_AVX512 = 1 << 2, // AVX-512 F and BW
+    AL_CPU_NEON = 1 << 3,
+};
+
+/*
+ * The features of this CPU, probed once. The environment variable AL_CPU
+ * limits them to a level, for testing: scalar, sse4.2, avx2, avx512 or neon.
+ */
+unsigned int al_cpu_features(void);
+const char *al_cpu_level(void);
+
+// The size of the last level cache, in bytes.
+size_t al_cpu_cache_size(void);
+
+bool al_cpu_sse4_2(void);
+bool al_cpu_avx2(void);
+bool al_cpu_avx512(void);
+
+typedef void (al_copy_plane_t)(
+    uint8_t *restrict,
+    size_t,
+    const uint8_t *restrict,
+    size_t,
+    size_t,
+    size_t
+);
+
+typedef void (al_resize_plane_t)(
+    uint8_t *restrict,
+    size_t,
+    size_t,
+    size_t,
+    const uint8_t *restrict,
+    size_t,
+    size_t,
+    size_t,
+    size_t
+);
+
+typedef void (al_rotate_plane_t)(
+    uint8_t *restrict,
+    size_t,
+    const uint8_t *restrict,
+    size_t,
+    size_t,
+    size_t
+);
+
+/*
+ * Implementations of the image kernels, like al_yuv_variants (yuv.h).
+ */
+struct al_image_variant {
+    const char *name;
+    bool (*supported)(void);
+    al_copy_plane_t *copy_plane;
+    al_resize_plane_t *resize_plane;
+    al_rotate_plane_t *rotate_plane;
+};
+
+extern const struct al_image_variant al_image_variants[];
+extern const size_t al_image_variants_count;
+
+al_copy_plane_t _al_copy_plane_scalar;
+al_resize_plane_t _al_resize_plane_scalar;
+al_rotate_plane_t _al_rotate_plane_scalar;
+
+/*
+ * The dispatch table: the best supported variant of each kernel.
+ * It starts out with the scalar variants and is filled by al_kernels_init,
+ * which al_init calls.
+ */
+struct al_kernels {
+    al_yuv_to_rgb_t *to_rgba;
+    al_yuv_to_yuv_t *nv12_to_i420;
+    al_yuv_to_yuv_t *i420_to_nv12;
+    al_copy_plane_t *copy_plane;
+    al_resize_plane_t *resize_plane;
+    al_rotate_plane_t *rotate_plane;
+};
+
+extern struct al_kernels al_kernels;
+
+void al_kernels_init(void);
@@ -46,6 +46,8 @@
 #include <CoreGraphics/CGGeometry.h> // CGSize
 
 #import <CoreMedia/CMSampleBuffer.h> // CMSampleBufferRef
+#import <CoreMedia/CMSync.h> // CMClockGetHostTimeClock
+#import <CoreMedia/CMTime.h> // CMTime
 // typedef struct opaqueCMSampleBuffer *CMSampleBufferRef;
 typedef const struct opaqueCMSampleBuffer *ConstCMSampleBufferRef;
 
@@ -64,8 +66,18 @@ typedef const struct opaqueCMSampleBuffer *ConstCMSampleBufferRef;
 #include "arithmetic.h" // _al_l2norm
 #include "camera.h"
 #include "common.h"
+#include "event.h"
+#include "memory.h"
+#include "stats.h"
+#include "trace.h"
 #include "yuv.h"
 
+// The buffers of one frame.
+struct frame_buffers {
+    struct al_image image;
+    struct al_image rgba;
+};
+
 struct al_camera {
     size_t index;
     AlCameraController *controller;
@@ -84,8 +96,14 @@ struct al_camera {
     vImage_Buffer image_buffers[4];
     struct al_image image;
     struct al_image rgba;
+    // The next frame is made here without the frame lock, then swapped
+    // with the buffers above.
+    struct frame_buffers back;
+    struct al_event frame;
     atomic_bool read;
     atomic_bool stop;
+    struct al_stats stats;
+    struct al_memory memory; // of the buffers above
 };
 
 #define N_CAMERAS 64
@@ -383,14 +401,44 @@ bgra_to_rgba(uint32_t x)
     );
 }
 
+// Sample buffers are timestamped on the host clock.
+static inline
+uint64_t
+_ns(CMTime t)
+{
+    if (!CMTIME_IS_NUMERIC(t))
+        return 0;
+    t = CMTimeConvertScale(t, 1000000000, kCMTimeRoundingMethod_Default);
+    return t.value > 0 ? (uint64_t) t.value : 0;
+}
+
+static inline
+uint64_t
+_now(void)
+{
+    return _ns(CMClockGetTime(CMClockGetHostTimeClock()));
+}
+
+static inline
+void
+_swap(struct al_image *x, struct al_image *y)
+{
+    const struct al_image z = *x;
+    *x = *y;
+    *y = z;
+}
+
 static
 void
-process_image(struct al_camera *cam, CVImageBufferRef image)
+process_image(struct al_camera *cam, CVImageBufferRef image, uint64_t timestamp)
 {
     enum al_status status;
 
     assert(cam != NULL);
 
+    const uint64_t start = al_stats_now();
+    AL_TRACE_BEGIN("process_image");
+
     if (image == NULL)
         goto error0;
 
@@ -414,8 +462,12 @@ process_image(struct al_camera *cam, CVImageBufferRef image)
         goto error2;
     size_t width = (size_t) w;
     size_t height = (size_t) h;
-    cam->image.width = width;
-    cam->image.height = height;
+
+    // The frame is made here without the frame lock, then swapped with
+    // the buffers the application reads.
+    struct frame_buffers *const back = &cam->back;
+    back->image.width = width;
+    back->image.height = height;
 
     Boolean planar = CVPixelBufferIsPlanar(pixel_buffer);
     /*
@@ -458,7 +510,7 @@ process_image(struct al_camera *cam, CVImageBufferRef image)
     if (y_stride < width)
         goto error2;
     // cam->image.stride = _al_calc_next_multiple(width, 32);
-    cam->image.stride = y_stride;
+    back->image.stride = y_stride;
 
     OSType format = CVPixelBufferGetPixelFormatType(pixel_buffer);
     /*
@@ -472,27 +524,31 @@ process_image(struct al_camera *cam, CVImageBufferRef image)
     switch (cam->pixel_format) {
         case kCVPixelFormatType_420YpCbCr8Planar:
         case kCVPixelFormatType_420YpCbCr8PlanarFullRange:
-            cam->image.format = AL_COLOR_FORMAT_YUV420P;
+            back->image.format = AL_COLOR_FORMAT_YUV420P;
             break;
         case kCVPixelFormatType_420YpCbCr8BiPlanarVideoRange:
         case kCVPixelFormatType_420YpCbCr8BiPlanarFullRange:
-            cam->image.format = AL_COLOR_FORMAT_YUV420SP;
+            back->image.format = AL_COLOR_FORMAT_YUV420SP;
             break;
         case kCVPixelFormatType_32RGBA:
         case kCVPixelFormatType_32ARGB:
         case kCVPixelFormatType_32BGRA:
-            cam->image.format = AL_COLOR_FORMAT_RGBA;
+            back->image.format = AL_COLOR_FORMAT_RGBA;
+            // in pixels
+            back->image.stride = y_stride / sizeof (uint32_t);
             break;
         default:
             DEBUG("%s", _cv_pixel_format_string(cam->pixel_format));
-            cam->image.format = AL_COLOR_FORMAT_UNKNOWN;
+            back->image.format = AL_COLOR_FORMAT_UNKNOWN;
             goto error2;
     }
 
-    status = al_image_alloc(&cam->image);
+    status = al_memory_image_alloc(&cam->memory, &back->image);
     if (status != AL_OK)
         goto error2;
 
+    uint64_t t = al_stats_now();
+
     switch (cam->pixel_format) {
         case kCVPixelFormatType_420YpCbCr8Planar:
         case kCVPixelFormatType_420YpCbCr8PlanarFullRange:
@@ -507,7 +563,7 @@ process_image(struct al_camera *cam, CVImageBufferRef image)
                     ),
                     .format = AL_COLOR_FORMAT_YUV420P,
                 }),
-                &cam->image
+                &back->image
             );
             if (status != AL_OK)
                 goto error3;
@@ -525,7 +581,7 @@ process_image(struct al_camera *cam, CVImageBufferRef image)
                     ),
                     .format = AL_COLOR_FORMAT_YUV420SP,
                 }),
-                &cam->image
+                &back->image
             );
             if (status != AL_OK)
                 goto error3;
@@ -537,26 +593,28 @@ process_image(struct al_camera *cam, CVImageBufferRef image)
                 &((const struct al_image) {
                     .width = width,
                     .height = height,
-                    .stride = y_stride,
+                    .stride = y_stride / sizeof (uint32_t),
                     .data = CVPixelBufferGetBaseAddress(pixel_buffer),
                     .format = AL_COLOR_FORMAT_RGBA,
                 }),
-                &cam->image
+                &back->image
             );
             if (status != AL_OK)
                 goto error3;
             break;
     }
-
-    if (cam->image.format == AL_COLOR_FORMAT_RGBA) {
-        cam->rgba.width = cam->image.width;
-        cam->rgba.height = cam->image.height;
-        cam->rgba.stride = cam->image.stride;
-        cam->rgba.format = cam->image.format;
-        status = al_image_alloc(&cam->rgba);
+    al_stats_add(&cam->stats.bytes, al_stats_image_bytes(&back->image));
+    t = al_stats_time(&cam->stats.repack, t);
+
+    if (back->image.format == AL_COLOR_FORMAT_RGBA) {
+        back->rgba.width = back->image.width;
+        back->rgba.height = back->image.height;
+        back->rgba.stride = back->image.stride;
+        back->rgba.format = back->image.format;
+        status = al_memory_image_alloc(&cam->memory, &back->rgba);
         if (status != AL_OK)
             goto error4;
-        status = al_image_copy(&cam->image, &cam->rgba);
+        status = al_image_copy(&back->image, &back->rgba);
         if (status != AL_OK)
             goto error4;
         switch (format) {
@@ -564,10 +622,10 @@ process_image(struct al_camera *cam, CVImageBufferRef image)
                 break;
             case kCVPixelFormatType_32ARGB:
                 {
-                uint32_t *const data = cam->rgba.data;
-                const size_t h = cam->rgba.height;
-                const size_t w = cam->rgba.width;
-                const size_t s = cam->rgba.stride / sizeof (uint32_t);
+                uint32_t *const data = back->rgba.data;
+                const size_t h = back->rgba.height;
+                const size_t w = back->rgba.width;
+                const size_t s = back->rgba.stride;
                 for (size_t i = 0; i < h; i++) {
                     for (size_t j = 0; j < w; j++) {
                         data[i * s + j] = argb_to_rgba(data[i * s + j]);
@@ -577,10 +635,10 @@ process_image(struct al_camera *cam, CVImageBufferRef image)
                 break;
             case kCVPixelFormatType_32BGRA:
                 {
-                uint32_t *const data = cam->rgba.data;
-                const size_t h = cam->rgba.height;
-                const size_t w = cam->rgba.width;
-                const size_t s = cam->rgba.stride / sizeof (uint32_t);
+                uint32_t *const data = back->rgba.data;
+                const size_t h = back->rgba.height;
+                const size_t w = back->rgba.width;
+                const size_t s = back->rgba.stride;
                 for (size_t i = 0; i < h; i++) {
                     for (size_t j = 0; j < w; j++) {
                         data[i * s + j] = bgra_to_rgba(data[i * s + j]);
@@ -595,39 +653,58 @@ process_image(struct al_camera *cam, CVImageBufferRef image)
         status = _al_darwin_yuv_to_rgba(image, cam->image_buffers);
         if (status != AL_OK)
             goto error4;
-        cam->rgba.width = cam->image_buffers[RGBA].width;
-        cam->rgba.height = cam->image_buffers[RGBA].height;
-        cam->rgba.stride = cam->image_buffers[RGBA].rowBytes;
-        cam->rgba.format = AL_COLOR_FORMAT_RGBA;
-        status = al_image_alloc(&cam->rgba);
+        back->rgba.width = cam->image_buffers[RGBA].width;
+        back->rgba.height = cam->image_buffers[RGBA].height;
+        back->rgba.stride = cam->image_buffers[RGBA].rowBytes / sizeof (uint32_t);
+        back->rgba.format = AL_COLOR_FORMAT_RGBA;
+        status = al_memory_image_alloc(&cam->memory, &back->rgba);
         if (status != AL_OK)
             goto error4;
         status = al_image_copy(
             &((const struct al_image) {
                 .width = cam->image_buffers[RGBA].width,
                 .height = cam->image_buffers[RGBA].height,
-                .stride = cam->image_buffers[RGBA].rowBytes,
+                .stride = cam->image_buffers[RGBA].rowBytes / sizeof (uint32_t),
                 .data = cam->image_buffers[RGBA].data,
                 .format = AL_COLOR_FORMAT_RGBA,
             }),
-            &cam->rgba
+            &back->rgba
         );
         if (status != AL_OK)
             goto error4;
     }
-
+    al_stats_add(&cam->stats.bytes, al_stats_image_bytes(&back->rgba));
+    al_stats_time(&cam->stats.convert, t);
+
+    const uint64_t now = _now();
+    if (timestamp == 0 || timestamp > now)
+        timestamp = now;
+
+    // Publish the frame: the buffers the application reads become the
+    // back buffers, for the next frame.
+    al_event_lock(&cam->frame);
+    _swap(&cam->image, &back->image);
+    _swap(&cam->rgba, &back->rgba);
+    al_stats_frame(&cam->stats, timestamp);
+    if (cam->read)
+        al_stats_add(&cam->stats.unread, 1);
     cam->read = true;
+    AL_TRACE_INSTANT("frame");
+    al_event_signal(&cam->frame);
+    al_event_unlock(&cam->frame);
     lock_status = CVPixelBufferUnlockBaseAddress(pixel_buffer, lock);
     if (lock_status != kCVReturnSuccess) {
         DEBUG_CV("CVPixelBufferUnlockBaseAddress", lock_status);
     }
     CVPixelBufferRelease(pixel_buffer);
+    al_stats_time(&cam->stats.process, start);
+    AL_TRACE_END("process_image");
     return;
 
 error4:
-    al_image_free(&cam->rgba);
+    al_image_free(&back->rgba);
 error3:
-    al_image_free(&cam->image);
+    al_image_free(&back->image);
 error2:
     lock_status = CVPixelBufferUnlockBaseAddress(pixel_buffer, lock);
     if (lock_status != kCVReturnSuccess) {
@@ -636,6 +713,8 @@ error2:
 error1:
     CVPixelBufferRelease(pixel_buffer);
 error0:
+    al_stats_add(&cam->stats.dropped, 1);
+    AL_TRACE_END("process_image");
     return;
 }
 
@@ -689,7 +768,10 @@ __attribute__((visibility("hidden")))
     if (image == NULL)
         return;
     CFRetain(image);
-    process_image(self.camera, image);
+    const uint64_t timestamp = _ns(
+        CMSampleBufferGetPresentationTimeStamp(self.camera->sample_buffer)
+    );
+    process_image(self.camera, image, timestamp);
     CFRelease(image);
 }
 
@@ -698,6 +780,8 @@ __attribute__((visibility("hidden")))
     fromConnection: (AVCaptureConnection *)connection
 {
     DEBUG("didDropSampleBuffer");
+    if (self.camera != NULL)
+        al_stats_add(&self.camera->stats.dropped, 1);
 }
 
 @end
@@ -723,6 +807,12 @@ al_camera_new(
         goto error0;
     }
 
+    if (al_event_init(&(*cam)->frame) != AL_OK) {
+        free(*cam);
+        *cam = NULL;
+        goto error0;
+    }
+
     (*cam)->index = index;
     if (index < N_CAMERAS)
         _al_cameras[index] = *cam;
@@ -848,6 +938,7 @@ error2:
     [(*cam)->controller release];
     (*cam)->controller = nil;
 error1:
+    al_event_destroy(&(*cam)->frame);
     free(*cam);
     *cam = NULL;
 error0:
@@ -868,6 +959,8 @@ al_camera_free(struct al_camera *cam)
     cam->sample_buffer = NULL;
     al_image_free(&cam->image);
     al_image_free(&cam->rgba);
+    al_image_free(&cam->back.image);
+    al_image_free(&cam->back.rgba);
     if (cam->output_delegate != nil)
         [cam->output_delegate release];
     cam->output_delegate = nil;
@@ -898,7 +991,9 @@ al_camera_free(struct al_camera *cam)
     cam->controller = nil;
     if (cam->index < N_CAMERAS)
         _al_cameras[cam->index] = NULL;
+    al_event_destroy(&cam->frame);
     free(cam);
+    (void) al_trace_flush(NULL);
 }
 
 void
@@ -978,6 +1073,25 @@ al_camera_get_data(struct al_camera *cam, enum al_color_format format, void **da
     return AL_NOTIMPLEMENTED;
 }
 
+enum al_status
+al_camera_get_image(
+    struct al_camera *cam,
+    enum al_color_format format,
+    struct al_image *image
+) {
+    assert(cam != NULL);
+    assert(image != NULL);
+    if (format == AL_COLOR_FORMAT_RGBA) {
+        *image = cam->rgba;
+        return AL_OK;
+    }
+    if (format == cam->image.format) {
+        *image = cam->image;
+        return AL_OK;
+    }
+    return AL_NOTIMPLEMENTED;
+}
+
 enum al_status
 al_camera_get_rgba(struct al_camera *cam, void **data)
 {
@@ -989,6 +1103,155 @@ al_camera_get_rgba(struct al_camera *cam, void **data)
     }
     cam->read = false;
     *data = cam->rgba.data;
+    al_stats_deliver(&cam->stats, _now());
+    AL_TRACE_INSTANT("al_camera_get_rgba");
+    return AL_OK;
+}
+
+enum al_status
+al_camera_read_into(
+    struct al_camera *cam,
+    enum al_color_format format,
+    struct al_image *dst,
+    int timeout
+) {
+    assert(cam != NULL);
+    assert(dst != NULL);
+    if (dst->data == NULL || dst->format != format)
+        return AL_ERROR;
+    enum al_status status;
+    AL_TRACE_BEGIN("al_camera_read_into");
+    al_event_lock(&cam->frame);
+    status = al_event_wait(&cam->frame, &cam->read, timeout);
+    if (status != AL_OK)
+        goto done;
+    if (dst->width != cam->image.width || dst->height != cam->image.height) {
+        status = AL_ERROR;
+        goto done;
+    }
+    // Convert or copy.
+    const struct al_image src =
+        format == AL_COLOR_FORMAT_RGBA ? cam->rgba : cam->image;
+    status = al_image_convert(&src, dst);
+    if (status == AL_OK) {
+        cam->read = false;
+        al_stats_deliver(&cam->stats, _now());
+        al_stats_add(&cam->stats.bytes, al_stats_image_bytes(dst));
+    }
+done:
+    al_event_unlock(&cam->frame);
+    AL_TRACE_END("al_camera_read_into");
+    return status;
+}
+
+enum al_status
+al_camera_copy_into(
+    struct al_camera *cam,
+    enum al_color_format format,
+    struct al_image *dst,
+    uint64_t *sequence
+) {
+    assert(cam != NULL);
+    assert(dst != NULL);
+    assert(sequence != NULL);
+    if (dst->data == NULL || dst->format != format)
+        return AL_ERROR;
+    enum al_status status = AL_OK;
+    AL_TRACE_BEGIN("al_camera_copy_into");
+    al_event_lock(&cam->frame);
+    const uint64_t frames = atomic_load(&cam->stats.frames);
+    if (frames == 0 || frames == *sequence)
+        goto done;
+    if (dst->width != cam->image.width || dst->height != cam->image.height) {
+        status = AL_ERROR;
+        goto done;
+    }
+    // Convert or copy.
+    const struct al_image src =
+        format == AL_COLOR_FORMAT_RGBA ? cam->rgba : cam->image;
+    status = al_image_convert(&src, dst);
+    if (status == AL_OK)
+        *sequence = frames;
+done:
+    al_event_unlock(&cam->frame);
+    AL_TRACE_END("al_camera_copy_into");
+    return status;
+}
+
+enum al_status
+al_camera_get_fd(struct al_camera *cam, int *fd)
+{
+    assert(cam != NULL);
+    assert(fd != NULL);
+    al_event_lock(&cam->frame);
+    enum al_status status = al_event_get_fd(&cam->frame, fd);
+    al_event_unlock(&cam->frame);
+    return status;
+}
+
+enum al_status
+al_camera_wait(struct al_camera *cam, int timeout)
+{
+    assert(cam != NULL);
+    AL_TRACE_BEGIN("al_camera_wait");
+    al_event_lock(&cam->frame);
+    enum al_status status = al_event_wait(&cam->frame, &cam->read, timeout);
+    al_event_unlock(&cam->frame);
+    AL_TRACE_END("al_camera_wait");
+    return status;
+}
+
+enum al_status
+al_camera_get_stats(struct al_camera *cam, struct al_camera_stats *stats)
+{
+    assert(cam != NULL);
+    assert(stats != NULL);
+    al_stats_get(&cam->stats, stats);
+    return AL_OK;
+}
+
+enum al_status
+al_camera_get_memory(struct al_camera *cam, struct al_memory_stats *stats)
+{
+    assert(cam != NULL);
+    assert(stats != NULL);
+    al_memory_get(&cam->memory, stats);
+    return AL_OK;
+}
+
+enum al_status
+al_camera_get_frame(struct al_camera *cam, struct al_camera_frame *frame)
+{
+    assert(cam != NULL);
+    assert(frame != NULL);
+    al_stats_get_frame(&cam->stats, frame);
+    return AL_OK;
+}
+
+enum al_status
+al_camera_get_latency(struct al_camera *cam, double percentile, uint64_t *ns)
+{
+    assert(cam != NULL);
+    assert(ns != NULL);
+    if (!(percentile >= 0 && percentile <= 100))
+        return AL_ERROR;
+    *ns = al_histogram_percentile(&cam->stats.latency, percentile);
+    return AL_OK;
+}
+
+enum al_status
+al_camera_get_latency_histogram(
+    struct al_camera *cam,
+    const uint64_t *bounds,
+    uint64_t *counts,
+    size_t n
+) {
+    assert(cam != NULL);
+    for (size_t i = 1; i < n; i++) {
+        if (bounds[i] < bounds[i - 1])
+            return AL_ERROR;
+    }
+    al_histogram_cumulative(&cam->stats.latency, bounds, counts, n);
     return AL_OK;
 }
 
@@ -28,6 +28,8 @@
 
 #include "al.h"
 #include "common.h"
+#include "batch.h" // al_batch_init
+#include "cpu.h" // al_kernels_init
 
 const char *const copyright = "Copyright 2023-2025, Mansour Moufid <mansourmoufid@gmail.com>";
 #if defined(TARGET_OS_IOS) && TARGET_OS_IOS
@@ -83,4 +85,6 @@ al_init(void)
     DEBUG("_al_encoding = %s", _cfstringencoding_string(_al_encoding));
     assert(CFStringIsEncodingAvailable(_al_encoding));
     catch_fatal_signals();
+    al_kernels_init();
+    al_batch_init();
 }
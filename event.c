@@ -0,0 +1,233 @@
+/* Copyright 2023-2025, Mansour Moufid <mansourmoufid@gmail.com> */
+
+/*
+ * This file is part of Aluminium Library.
+ *
+ * Aluminium Library is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Aluminium Library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with Aluminium Library. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h> // fcntl, O_NONBLOCK, FD_CLOEXEC
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h> // uint64_t
+#include <string.h> // strerror
+#include <time.h> // clock_gettime
+#include <unistd.h> // close, pipe, write
+
+#if defined(__linux__)
+#include <sys/eventfd.h>
+#endif
+
+#include "al.h"
+#include "common.h" // DEBUG
+#include "event.h"
+
+// pthread_condattr_setclock is not available on Darwin.
+#if defined(__APPLE__)
+#define AL_EVENT_CLOCK CLOCK_REALTIME
+#else
+#define AL_EVENT_CLOCK CLOCK_MONOTONIC
+#endif
+
+__attribute__((visibility("hidden")))
+enum al_status
+al_event_init(struct al_event *event)
+{
+    assert(event != NULL);
+    event->fd[0] = -1;
+    event->fd[1] = -1;
+    int err = pthread_mutex_init(&event->mutex, NULL);
+    if (err != 0) {
+        DEBUG("pthread_mutex_init: %s", strerror(err));
+        return AL_ERROR;
+    }
+    pthread_condattr_t attr;
+    err = pthread_condattr_init(&attr);
+    if (err != 0)
+        goto error1;
+#if !defined(__APPLE__)
+    err = pthread_condattr_setclock(&attr, AL_EVENT_CLOCK);
+    if (err != 0)
+        goto error2;
+#endif
+    err = pthread_cond_init(&event->cond, &attr);
+    if (err != 0)
+        goto error2;
+    pthread_condattr_destroy(&attr);
+    return AL_OK;
+error2:
+    pthread_condattr_destroy(&attr);
+error1:
+    DEBUG("pthread_cond_init: %s", strerror(err));
+    pthread_mutex_destroy(&event->mutex);
+    return AL_ERROR;
+}
+
+__attribute__((visibility("hidden")))
+void
+al_event_destroy(struct al_event *event)
+{
+    assert(event != NULL);
+    if (event->fd[0] >= 0)
+        close(event->fd[0]);
+    if (event->fd[1] >= 0 && event->fd[1] != event->fd[0])
+        close(event->fd[1]);
+    event->fd[0] = -1;
+    event->fd[1] = -1;
+    pthread_cond_destroy(&event->cond);
+    pthread_mutex_destroy(&event->mutex);
+}
+
+__attribute__((visibility("hidden")))
+void
+al_event_lock(struct al_event *event)
+{
+    assert(event != NULL);
+    int err = pthread_mutex_lock(&event->mutex);
+    assert(err == 0);
+    (void) err;
+}
+
+__attribute__((visibility("hidden")))
+void
+al_event_unlock(struct al_event *event)
+{
+    assert(event != NULL);
+    int err = pthread_mutex_unlock(&event->mutex);
+    assert(err == 0);
+    (void) err;
+}
+
+// Wake all waiters; the caller holds the lock and has set the flag.
+__attribute__((visibility("hidden")))
+void
+al_event_signal(struct al_event *event)
+{
+    assert(event != NULL);
+    pthread_cond_broadcast(&event->cond);
+    if (event->fd[1] >= 0) {
+        // A full pipe or counter is already readable: ignore EAGAIN.
+#if defined(__linux__)
+        const uint64_t one = 1;
+        ssize_t n = write(event->fd[1], &one, sizeof (one));
+#else
+        const char one = 1;
+        ssize_t n = write(event->fd[1], &one, sizeof (one));
+#endif
+        (void) n;
+    }
+}
+
+/*
+ * Wait until the flag is set, for at most timeout milliseconds,
+ * or indefinitely if timeout is negative. The caller holds the lock.
+ * Returns AL_TIMEOUT if the flag is still not set.
+ */
+__attribute__((visibility("hidden")))
+enum al_status
+al_event_wait(struct al_event *event, atomic_bool *flag, int timeout)
+{
+    assert(event != NULL);
+    assert(flag != NULL);
+    if (atomic_load(flag))
+        return AL_OK;
+    if (timeout == 0)
+        return AL_TIMEOUT;
+    struct timespec deadline = {0};
+    if (timeout > 0) {
+        clock_gettime(AL_EVENT_CLOCK, &deadline);
+        deadline.tv_sec += timeout / 1000;
+        deadline.tv_nsec += (long) (timeout % 1000) * 1000000L;
+        if (deadline.tv_nsec >= 1000000000L) {
+            deadline.tv_sec += 1;
+            deadline.tv_nsec -= 1000000000L;
+        }
+    }
+    while (!atomic_load(flag)) {
+        int err;
+        if (timeout > 0)
+            err = pthread_cond_timedwait(
+                &event->cond,
+                &event->mutex,
+                &deadline
+            );
+        else
+            err = pthread_cond_wait(&event->cond, &event->mutex);
+        if (err == ETIMEDOUT)
+            return atomic_load(flag) ? AL_OK : AL_TIMEOUT;
+        if (err != 0) {
+            DEBUG("pthread_cond_wait: %s", strerror(err));
+            return AL_ERROR;
+        }
+    }
+    return AL_OK;
+}
+
+#if !defined(__linux__)
+static
+int
+_al_nonblock(int fd)
+{
+    int flags = fcntl(fd, F_GETFL);
+    if (flags < 0 || fcntl(fd, F_SETFL, flags | O_NONBLOCK) != 0)
+        return -1;
+    flags = fcntl(fd, F_GETFD);
+    if (flags < 0 || fcntl(fd, F_SETFD, flags | FD_CLOEXEC) != 0)
+        return -1;
+    return 0;
+}
+#endif
+
+/*
+ * Return a file descriptor that becomes readable when the event is
+ * signalled, creating it on first use. The caller holds the lock.
+ * Readers drain it with non-blocking reads; the event owns it.
+ */
+__attribute__((visibility("hidden")))
+enum al_status
+al_event_get_fd(struct al_event *event, int *fd)
+{
+    assert(event != NULL);
+    assert(fd != NULL);
+    if (event->fd[0] < 0) {
+#if defined(__linux__)
+        int efd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (efd < 0) {
+            DEBUG("eventfd: errno=%i [%s]", errno, strerror(errno));
+            return AL_ERROR;
+        }
+        event->fd[0] = efd;
+        event->fd[1] = efd;
+#else
+        int fds[2];
+        if (pipe(fds) != 0) {
+            DEBUG("pipe: errno=%i [%s]", errno, strerror(errno));
+            return AL_ERROR;
+        }
+        if (_al_nonblock(fds[0]) != 0 || _al_nonblock(fds[1]) != 0) {
+            DEBUG("fcntl: errno=%i [%s]", errno, strerror(errno));
+            close(fds[0]);
+            close(fds[1]);
+            return AL_ERROR;
+        }
+        event->fd[0] = fds[0];
+        event->fd[1] = fds[1];
+#endif
+    }
+    *fd = event->fd[0];
+    return AL_OK;
+}
@@ -0,0 +1,47 @@
+/* Copyright 2023-2025, Mansour Moufid <mansourmoufid@gmail.com> */
+
+/*
+ * This file is part of Aluminium Library.
+ *
+ * Aluminium Library is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Aluminium Library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with Aluminium Library. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <pthread.h>
+#include <stdatomic.h>
+
+#include "al.h"
+
+/*
+ * A frame event: the camera callback sets a flag and signals, and
+ * consumers wait for the flag with a timeout. Camera buffers are
+ * written and read with the lock held.
+ *
+ * On request, the event also signals a non-blocking file descriptor
+ * (an eventfd on Linux, a pipe elsewhere) for use in event loops.
+ */
+struct al_event {
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    int fd[2]; // read end, write end
+};
+
+enum al_status al_event_init(struct al_event *);
+void al_event_destroy(struct al_event *);
+void al_event_lock(struct al_event *);
+void al_event_unlock(struct al_event *);
+void al_event_signal(struct al_event *);
+enum al_status al_event_wait(struct al_event *, atomic_bool *, int);
+enum al_status al_event_get_fd(struct al_event *, int *);
@@ -21,30 +21,265 @@
 #undef NDEBUG
 #endif
 
+// MAP_ANONYMOUS and MAP_HUGETLB are not in POSIX (see _map).
+#if defined(__linux__) && !defined(_DEFAULT_SOURCE)
+#define _DEFAULT_SOURCE 1
+#endif
+
 #include <assert.h>
 #include <errno.h>
+#include <stdbool.h>
 #include <stddef.h>
-#include <stdlib.h> // abort, calloc, posix_memalign
-#include <string.h> // memcpy, memmove, strerror
+#include <stdlib.h> // abort, calloc, getenv, posix_memalign
+#include <string.h> // memcpy, memmove, strcmp, strerror
 #if defined(DEBUG)
 #include <stdio.h>
 #endif
+#if defined(__linux__)
+#include <stdatomic.h>
+#include <sys/mman.h> // madvise, mmap, munmap
+#if !defined(MAP_ANONYMOUS) && defined(MAP_ANON)
+#define MAP_ANONYMOUS MAP_ANON
+#endif
+#endif
 
 #include "al.h"
-#include "arithmetic.h" // _al_calc_next_multiple, SIZE_MAX_SQRT
+#include "arithmetic.h" // _al_calc_next_multiple, SIZE_MAX_SQRT, al_u8x16
+#include "batch.h" // al_batch_rows
 #include "common.h"
+#include "cpu.h" // al_cpu_cache_size, al_kernels
+#include "memory.h"
+#include "trace.h"
+#include "yuv.h" // al_yuv_to_rgba
+
+#define AL_IMAGE_ALIGNMENT 64
+
+/*
+ * Each buffer is preceded by a header, padded to the alignment, so that
+ * al_image_free knows what to take off the accounts even if the size of
+ * the image was changed in between, and how to release it: the length of
+ * its mapping, or zero if it came from posix_memalign.
+ */
+struct header {
+    size_t size;
+    struct al_memory *owner;
+    size_t mapped;
+};
+_Static_assert(sizeof (struct header) <= AL_IMAGE_ALIGNMENT, "header");
+_Static_assert(AL_IMAGE_ALIGNMENT % AL_IMAGE_PADDING == 0, "padding");
+
+static struct al_memory total;
+
+#if defined(__linux__)
+
+/*
+ * Huge pages, for frames of 4K and such, which otherwise span thousands
+ * of 4 KB pages and miss the TLB on every pass. They are opt-in, with the
+ * environment variable AL_HUGEPAGES, read once:
+ *
+ *  - thp (or 1): transparent huge pages (madvise MADV_HUGEPAGE);
+ *  - hugetlb: pages reserved in /proc/sys/vm/nr_hugepages (MAP_HUGETLB),
+ *    or transparent huge pages when there are none left.
+ *
+ * Only buffers of at least one huge page are mapped so, and every page is
+ * touched once at allocation, so that no frame pays for the faults.
+ */
+#define AL_HUGE_PAGE_SIZE ((size_t) 2 << 20)
+
+enum huge_pages {
+    AL_HUGE_PAGES_UNKNOWN = 0,
+    AL_HUGE_PAGES_OFF,
+    AL_HUGE_PAGES_THP,
+    AL_HUGE_PAGES_HUGETLB,
+};
+
+static atomic_int huge_pages = AL_HUGE_PAGES_UNKNOWN;
+
+static
+enum huge_pages
+_huge_pages(void)
+{
+    int mode = atomic_load(&huge_pages);
+    if (mode != AL_HUGE_PAGES_UNKNOWN)
+        return mode;
+    mode = AL_HUGE_PAGES_OFF;
+    const char *x = getenv("AL_HUGEPAGES");
+    if (x == NULL || x[0] == '\0' || strcmp(x, "0") == 0)
+        mode = AL_HUGE_PAGES_OFF;
+    else if (strcmp(x, "1") == 0 || strcmp(x, "thp") == 0)
+        mode = AL_HUGE_PAGES_THP;
+    else if (strcmp(x, "hugetlb") == 0)
+        mode = AL_HUGE_PAGES_HUGETLB;
+    else {
+        DEBUG("AL_HUGEPAGES=%s: unknown mode", x);
+    }
+    atomic_store(&huge_pages, mode);
+    return mode;
+}
+
+/*
+ * Map n bytes (a multiple of the huge page size) aligned to a huge page,
+ * and prefault them; return NULL if that fails.
+ */
+static
+void *
+_map(size_t n)
+{
+    void *data = MAP_FAILED;
+#if defined(MAP_HUGETLB)
+    if (_huge_pages() == AL_HUGE_PAGES_HUGETLB) {
+        data = mmap(
+            NULL,
+            n,
+            PROT_READ | PROT_WRITE,
+            MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB,
+            -1,
+            0
+        );
+        if (data == MAP_FAILED) {
+            DEBUG("mmap MAP_HUGETLB: errno=%i [%s]", errno, strerror(errno));
+        }
+    }
+#endif
+    if (data == MAP_FAILED) {
+        // Map one more huge page, to trim to an aligned one.
+        uint8_t *base = mmap(
+            NULL,
+            n + AL_HUGE_PAGE_SIZE,
+            PROT_READ | PROT_WRITE,
+            MAP_PRIVATE | MAP_ANONYMOUS,
+            -1,
+            0
+        );
+        if (base == MAP_FAILED) {
+            DEBUG("mmap: errno=%i [%s]", errno, strerror(errno));
+            return NULL;
+        }
+        const size_t offset = (uintptr_t) base % AL_HUGE_PAGE_SIZE;
+        const size_t head = offset == 0 ? 0 : AL_HUGE_PAGE_SIZE - offset;
+        if (head > 0)
+            munmap(base, head);
+        munmap(base + head + n, AL_HUGE_PAGE_SIZE - head);
+        data = base + head;
+#if defined(MADV_HUGEPAGE)
+        if (madvise(data, n, MADV_HUGEPAGE) != 0) {
+            DEBUG("madvise: errno=%i [%s]", errno, strerror(errno));
+        }
+#endif
+    }
+    const size_t page = 4096;
+    for (size_t i = 0; i < n; i += page)
+        ((volatile uint8_t *) data)[i] = 0;
+    return data;
+}
+
+#endif
+
+/*
+ * Allocate n bytes aligned to AL_IMAGE_ALIGNMENT, after room for the
+ * header, and record how in the header.
+ */
+static
+struct header *
+_header_alloc(size_t n)
+{
+    n += AL_IMAGE_ALIGNMENT;
+#if defined(__linux__)
+    if (n >= AL_HUGE_PAGE_SIZE && _huge_pages() != AL_HUGE_PAGES_OFF) {
+        const size_t pages = (n + AL_HUGE_PAGE_SIZE - 1) / AL_HUGE_PAGE_SIZE;
+        const size_t mapped = pages * AL_HUGE_PAGE_SIZE;
+        struct header *header = _map(mapped);
+        if (header != NULL) {
+            header->mapped = mapped;
+            return header;
+        }
+    }
+#endif
+    void *data = NULL;
+    if (posix_memalign(&data, AL_IMAGE_ALIGNMENT, n) != 0) {
+        DEBUG("posix_memalign: errno=%i [%s]", errno, strerror(errno));
+        return NULL;
+    }
+    struct header *header = data;
+    header->mapped = 0;
+    return header;
+}
+
+static
+void
+_free(void *data)
+{
+    struct header *header = (void *) ((uint8_t *) data - AL_IMAGE_ALIGNMENT);
+    al_memory_sub(&total, header->size);
+    if (header->owner != NULL)
+        al_memory_sub(header->owner, header->size);
+#if defined(__linux__)
+    if (header->mapped > 0) {
+        munmap(header, header->mapped);
+        return;
+    }
+#endif
+    assert(header->mapped == 0);
+    free(header);
+}
 
+/*
+ * Return the huge page mode of the image buffers (see above): "off",
+ * "thp" or "hugetlb".
+ */
+__attribute__((visibility("hidden")))
+const char *
+al_memory_huge_pages(void)
+{
+#if defined(__linux__)
+    switch (_huge_pages()) {
+        case AL_HUGE_PAGES_THP:
+            return "thp";
+        case AL_HUGE_PAGES_HUGETLB:
+            return "hugetlb";
+        case AL_HUGE_PAGES_UNKNOWN:
+        case AL_HUGE_PAGES_OFF:
+            break;
+    }
+#endif
+    return "off";
+}
+
+/*
+ * The stride of a padded image, in pixels: at least the stride asked for,
+ * such that every row of every plane is a whole number of padding units.
+ * The I420 chroma rows are half as long as the luma rows.
+ */
+static
+size_t
+_padded_stride(const struct al_image *x)
+{
+    const size_t stride = x->stride > x->width ? x->stride : x->width;
+    size_t n = 0;
+    switch (x->format) {
+        case AL_COLOR_FORMAT_YUV420SP:
+        case AL_COLOR_FORMAT_YUV420P:
+            n = 2 * AL_IMAGE_PADDING;
+            break;
+        case AL_COLOR_FORMAT_RGBA:
+            n = AL_IMAGE_PADDING / sizeof (uint32_t);
+            break;
+        case AL_COLOR_FORMAT_UNKNOWN:
+            abort();
+    }
+    return (stride + n - 1) / n * n;
+}
+
+static
 enum al_status
-al_image_alloc(struct al_image *x)
+_alloc(struct al_memory *owner, struct al_image *x, bool padded)
 {
     assert(x != NULL);
     if (!(x->width > 0 && x->height > 0))
         return AL_ERROR;
     if (!(x->height < SIZE_MAX_SQRT && x->stride < SIZE_MAX_SQRT))
         return AL_ERROR;
-    if (x->stride == 0)
-        x->stride = _al_calc_next_multiple(x->width, 32);
-    if (!(x->stride >= x->width))
+    if (!(x->width < SIZE_MAX_SQRT))
         return AL_ERROR;
     switch (x->format) {
         case AL_COLOR_FORMAT_YUV420SP:
@@ -54,8 +289,14 @@ al_image_alloc(struct al_image *x)
         case AL_COLOR_FORMAT_UNKNOWN:
             return AL_ERROR;
     }
+    if (padded)
+        x->stride = _padded_stride(x);
+    if (x->stride == 0)
+        x->stride = _al_calc_next_multiple(x->width, 32);
+    if (!(x->stride >= x->width))
+        return AL_ERROR;
     if (x->data != NULL) {
-        free(x->data);
+        _free(x->data);
         x->data = NULL;
     }
     size_t size = 0;
@@ -71,15 +312,61 @@ al_image_alloc(struct al_image *x)
             abort();
     }
     assert(size > 0);
-    void *data = NULL;
-    if (posix_memalign(&data, 32, size) != 0) {
-        DEBUG("posix_memalign: errno=%i [%s]", errno, strerror(errno));
+    const size_t image_size = size;
+    if (padded)
+        size += AL_IMAGE_PADDING;
+    struct header *header = _header_alloc(size);
+    if (header == NULL)
         return AL_NOMEMORY;
-    }
+    uint8_t *data = (uint8_t *) header + AL_IMAGE_ALIGNMENT;
+    // The padding is read by whole-vector loops, so it must be defined.
+    if (padded)
+        memset(data + image_size, 0, AL_IMAGE_PADDING);
+    header->size = size;
+    header->owner = owner;
+    al_memory_add(&total, size);
+    if (owner != NULL)
+        al_memory_add(owner, size);
     x->data = data;
     return AL_OK;
 }
 
+__attribute__((visibility("hidden")))
+enum al_status
+al_memory_image_alloc(struct al_memory *owner, struct al_image *x)
+{
+    return _alloc(owner, x, false);
+}
+
+/*
+ * Allocate the data of x, for its width, height, stride and format, and
+ * free any data it had. That data must be NULL or from al_image_alloc*,
+ * as it is freed through the header before it.
+ */
+enum al_status
+al_image_alloc(struct al_image *x)
+{
+    return _alloc(NULL, x, false);
+}
+
+/*
+ * Like al_image_alloc, but round the stride up so that every row of every
+ * plane is a multiple of AL_IMAGE_PADDING bytes, and follow the last row
+ * with AL_IMAGE_PADDING more bytes (of zeros). The data are aligned to
+ * AL_IMAGE_PADDING bytes. A kernel can then load and store whole vectors
+ * of up to that size to the end of each row, and load one past the end
+ * of the image, without a scalar tail.
+ */
+enum al_status
+al_image_alloc_padded(struct al_image *x)
+{
+    return _alloc(NULL, x, true);
+}
+
+/*
+ * Free the data of x, which must be NULL or from al_image_alloc*, and
+ * reset it.
+ */
 void
 al_image_free(struct al_image *x)
 {
@@ -88,26 +375,23 @@ al_image_free(struct al_image *x)
     x->height = 0;
     x->stride = 0;
     if (x->data != NULL)
-        free(x->data);
+        _free(x->data);
     x->data = NULL;
     x->format = AL_COLOR_FORMAT_UNKNOWN;
 }
 
+/*
+ * Return the bytes and number of image buffers allocated by libal now,
+ * the most bytes at any time, and the number of allocations so far.
+ */
 enum al_status
-al_image_convert(const struct al_image *src, struct al_image *dst)
+al_memory_get_stats(struct al_memory_stats *stats)
 {
-    return AL_NOTIMPLEMENTED;
+    assert(stats != NULL);
+    al_memory_get(&total, stats);
+    return AL_OK;
 }
 
-struct yuv {
-    size_t width;
-    size_t height;
-    size_t stride;
-    uint8_t *restrict y;
-    uint8_t *u;
-    uint8_t *v;
-};
-
 #if defined(DEBUG)
 static inline
 void
@@ -123,201 +407,1388 @@ _al_dump(struct al_image *x)
 }
 #endif
 
-static
+/*
+ * Rotate one plane of bytes by 90 degrees clockwise; the destination is
+ * height bytes wide and width rows high.
+ */
+static inline
 void
-_rotate_yuv420sp(
-    uint8_t *restrict src_y,
-    uint8_t *restrict src_uv,
-    size_t src_width,
-    size_t src_height,
+__attribute__((always_inline))
+_rotate_plane(
+    uint8_t *restrict dst,
+    size_t dst_stride,
+    const uint8_t *restrict src,
     size_t src_stride,
-    uint8_t *restrict dst_y,
-    uint8_t *restrict dst_uv,
-    size_t dst_width,
-    size_t dst_height,
+    size_t width,
+    size_t height
+) {
+    for (size_t i = 0; i < height; i++) {
+        for (size_t j = 0; j < width; j++) {
+            const size_t i_ = j;
+            const size_t j_ = (height - 1) - i;
+            dst[i_ * dst_stride + j_] = src[i * src_stride + j];
+        }
+    }
+}
+
+/*
+ * Rotate one plane of pixels of n bytes clockwise by 90, 180 or 270
+ * degrees. The width and height are those of the source, in pixels, and
+ * the strides are in bytes.
+ */
+static
+void
+_rotate_pixels(
+    uint8_t *restrict dst,
     size_t dst_stride,
+    const uint8_t *restrict src,
+    size_t src_stride,
+    size_t width,
+    size_t height,
+    size_t n,
     int degrees
 ) {
-    const struct yuv x = {
-        .width = src_width,
-        .height = src_height,
-        .stride = src_stride,
-        .y = src_y,
-        .u = src_uv,
-    };
-    const struct yuv y = {
-        .width = dst_width,
-        .height = dst_height,
-        .stride = dst_stride,
-        .y = dst_y,
-        .u = dst_uv,
-    };
     switch (degrees) {
-        case 0:
-            memmove(y.y, x.y, x.height * x.stride);
-            memmove(y.u, x.u, (x.height / 2) * x.width);
-            break;
         case 90:
-            for (size_t i = 0; i < x.height; i++) {
-                for (size_t j = 0; j < x.width; j++) {
-                    const size_t i_ = j;
-                    const size_t j_ = (x.height - 1) - i;
-                    y.y[i_ * y.stride + j_] = x.y[i * x.stride + j];
+            if (n == 1) {
+                al_kernels.rotate_plane(
+                    dst,
+                    dst_stride,
+                    src,
+                    src_stride,
+                    width,
+                    height
+                );
+                break;
+            }
+            for (size_t i = 0; i < height; i++) {
+                for (size_t j = 0; j < width; j++) {
+                    memcpy(
+                        &(dst[j * dst_stride + ((height - 1) - i) * n]),
+                        &(src[i * src_stride + j * n]),
+                        n
+                    );
                 }
             }
             break;
-        default:
-            break;
-    }
-}
-
-enum al_status
-al_image_rotate(struct al_image *src, struct al_image *dst, int degrees)
-{
-    assert(src != NULL);
-    assert(dst != NULL);
-    if (src == dst) {
-        assert(src->width == src->height);
-        assert(dst->width == dst->height);
-    }
-    degrees = degrees % 360;
-    assert(degrees % 90 == 0);
-    switch (degrees) {
-        case 0:
         case 180:
-            assert(src->width == dst->width);
-            assert(src->height == dst->height);
+            for (size_t i = 0; i < height; i++) {
+                for (size_t j = 0; j < width; j++) {
+                    memcpy(
+                        &(dst[((height - 1) - i) * dst_stride + ((width - 1) - j) * n]),
+                        &(src[i * src_stride + j * n]),
+                        n
+                    );
+                }
+            }
             break;
-        case 90:
         case 270:
-            assert(src->width == dst->height);
-            assert(src->height == dst->width);
+            for (size_t i = 0; i < height; i++) {
+                for (size_t j = 0; j < width; j++) {
+                    memcpy(
+                        &(dst[((width - 1) - j) * dst_stride + i * n]),
+                        &(src[i * src_stride + j * n]),
+                        n
+                    );
+                }
+            }
             break;
         default:
             break;
     }
-    assert(src->data != NULL);
-    assert(dst->data != NULL);
-    assert(src->format == dst->format);
+}
 
+static
+void
+_rotate(const struct al_image *src, struct al_image *dst, int degrees)
+{
+    const uint8_t *x = src->data;
+    uint8_t *y = dst->data;
     switch (src->format) {
+        case AL_COLOR_FORMAT_RGBA:
+            _rotate_pixels(
+                y,
+                dst->stride * sizeof (uint32_t),
+                x,
+                src->stride * sizeof (uint32_t),
+                src->width,
+                src->height,
+                sizeof (uint32_t),
+                degrees
+            );
+            break;
         case AL_COLOR_FORMAT_YUV420SP:
-            _rotate_yuv420sp(
-                src->data,
-                (uint8_t *) src->data + src->height * src->stride,
+            // Y
+            _rotate_pixels(
+                y,
+                dst->stride,
+                x,
+                src->stride,
                 src->width,
                 src->height,
+                1,
+                degrees
+            );
+            // UV, in pairs
+            _rotate_pixels(
+                &(y[dst->height * dst->stride]),
+                dst->stride,
+                &(x[src->height * src->stride]),
                 src->stride,
-                dst->data,
-                (uint8_t *) dst->data + dst->height * dst->stride,
-                dst->width,
-                dst->height,
+                src->width / 2,
+                src->height / 2,
+                2,
+                degrees
+            );
+            break;
+        case AL_COLOR_FORMAT_YUV420P:
+            {
+            // Y
+            _rotate_pixels(
+                y,
                 dst->stride,
+                x,
+                src->stride,
+                src->width,
+                src->height,
+                1,
+                degrees
+            );
+            // U, V
+            const uint8_t *src_u = &(x[src->height * src->stride]);
+            const uint8_t *src_v = src_u + (src->height / 2) * (src->stride / 2);
+            uint8_t *dst_u = &(y[dst->height * dst->stride]);
+            uint8_t *dst_v = dst_u + (dst->height / 2) * (dst->stride / 2);
+            _rotate_pixels(
+                dst_u,
+                dst->stride / 2,
+                src_u,
+                src->stride / 2,
+                src->width / 2,
+                src->height / 2,
+                1,
+                degrees
+            );
+            _rotate_pixels(
+                dst_v,
+                dst->stride / 2,
+                src_v,
+                src->stride / 2,
+                src->width / 2,
+                src->height / 2,
+                1,
                 degrees
             );
+            }
+            break;
+        case AL_COLOR_FORMAT_UNKNOWN:
             break;
+    }
+}
+
+/*
+ * Rotate src into dst clockwise by a multiple of 90 degrees, which may be
+ * negative. Only a rotation by 0 degrees can be done in place.
+ */
+enum al_status
+al_image_rotate(struct al_image *src, struct al_image *dst, int degrees)
+{
+    assert(src != NULL);
+    assert(dst != NULL);
+    degrees = degrees % 360;
+    if (degrees < 0)
+        degrees += 360;
+    if (degrees % 90 != 0)
+        return AL_ERROR;
+    if (src->data == NULL || dst->data == NULL)
+        return AL_ERROR;
+    if (src->format != dst->format)
+        return AL_ERROR;
+    if (degrees == 90 || degrees == 270) {
+        if (!(src->width == dst->height && src->height == dst->width))
+            return AL_ERROR;
+    } else {
+        if (!(src->width == dst->width && src->height == dst->height))
+            return AL_ERROR;
+    }
+    if (!(src->stride >= src->width && dst->stride >= dst->width))
+        return AL_ERROR;
+    if (src->format == AL_COLOR_FORMAT_UNKNOWN)
+        return AL_NOTIMPLEMENTED;
+    if (degrees == 0)
+        return src == dst ? AL_OK : al_image_copy(src, dst);
+    if (src == dst || src->data == dst->data)
+        return AL_NOTIMPLEMENTED;
+
+    AL_TRACE_BEGIN("al_image_rotate");
+    _rotate(src, dst, degrees);
+    AL_TRACE_END("al_image_rotate");
+    return AL_OK;
+}
+
+static inline
+void
+__attribute__((always_inline))
+_copy_plane(
+    uint8_t *restrict dst,
+    size_t dst_stride,
+    const uint8_t *restrict src,
+    size_t src_stride,
+    size_t width,
+    size_t height
+) {
+    for (size_t i = 0; i < height; i++) {
+        memcpy(&(dst[i * dst_stride]), &(src[i * src_stride]), width);
+    }
+}
+
+/*
+ * Copy a plane with non-temporal stores, for outputs larger than the
+ * cache that this core does not read again: they neither evict the data
+ * of the next stage nor read the destination in first.
+ */
+static
+void
+_stream_plane(
+    uint8_t *restrict dst,
+    size_t dst_stride,
+    const uint8_t *restrict src,
+    size_t src_stride,
+    size_t width,
+    size_t height
+) {
+#if defined(AL_SIMD)
+    for (size_t i = 0; i < height; i++) {
+        uint8_t *d = &(dst[i * dst_stride]);
+        const uint8_t *s = &(src[i * src_stride]);
+        size_t n = width;
+        const size_t head = (16 - (uintptr_t) d % 16) % 16;
+        if (head >= n) {
+            memcpy(d, s, n);
+            continue;
+        }
+        memcpy(d, s, head);
+        d += head;
+        s += head;
+        n -= head;
+        for (; n >= 16; n -= 16, d += 16, s += 16)
+            al_u8x16_stream(d, al_u8x16_load(s));
+        memcpy(d, s, n);
+    }
+    al_stream_fence();
+#else
+    _copy_plane(dst, dst_stride, src, src_stride, width, height);
+#endif
+}
+
+/*
+ * Copy a plane for a consumer that reads it next on this core: plain
+ * stores, which leave it in the cache, and the next row of the source
+ * prefetched while this one is copied.
+ */
+static
+void
+_prefetch_plane(
+    uint8_t *restrict dst,
+    size_t dst_stride,
+    const uint8_t *restrict src,
+    size_t src_stride,
+    size_t width,
+    size_t height
+) {
+    for (size_t i = 0; i < height; i++) {
+        if (i + 1 < height) {
+            const uint8_t *next = &(src[(i + 1) * src_stride]);
+            for (size_t j = 0; j < width; j += 64)
+                __builtin_prefetch(&(next[j]), 0, 3);
+        }
+        memcpy(&(dst[i * dst_stride]), &(src[i * src_stride]), width);
+    }
+}
+
+/*
+ * Resolve AL_IMAGE_OUTPUT_AUTO for the destination of a copy: stream it
+ * if it is larger than half the last level cache (the other half for the
+ * source).
+ */
+static
+enum al_image_output
+_output(enum al_image_output output, const struct al_image *dst)
+{
+    if (output != AL_IMAGE_OUTPUT_AUTO)
+        return output;
+    size_t size = dst->stride * dst->height;
+    switch (dst->format) {
+        case AL_COLOR_FORMAT_YUV420SP:
         case AL_COLOR_FORMAT_YUV420P:
+            size = size * 3 / 2;
+            break;
         case AL_COLOR_FORMAT_RGBA:
+            size *= sizeof (uint32_t);
+            break;
         case AL_COLOR_FORMAT_UNKNOWN:
-            return AL_NOTIMPLEMENTED;
+            break;
     }
+    if (size > al_cpu_cache_size() / 2)
+        return AL_IMAGE_OUTPUT_STREAM;
+    return AL_IMAGE_OUTPUT_AUTO;
+}
 
-    return AL_OK;
+static inline
+void
+_output_rows(
+    enum al_image_output output,
+    uint8_t *restrict dst,
+    size_t dst_stride,
+    const uint8_t *restrict src,
+    size_t src_stride,
+    size_t width,
+    size_t height
+) {
+    // Packed rows are one block, and one memcpy.
+    if (src_stride == width && dst_stride == width) {
+        width *= height;
+        height = 1;
+    }
+    switch (output) {
+        case AL_IMAGE_OUTPUT_STREAM:
+            _stream_plane(dst, dst_stride, src, src_stride, width, height);
+            break;
+        case AL_IMAGE_OUTPUT_CACHE:
+            _prefetch_plane(dst, dst_stride, src, src_stride, width, height);
+            break;
+        case AL_IMAGE_OUTPUT_AUTO:
+            al_kernels.copy_plane(dst, dst_stride, src, src_stride, width, height);
+            break;
+    }
+}
+
+/*
+ * Planes of more than two bands are copied by bands of rows in parallel,
+ * as one thread does not have the memory bandwidth of the CPU.
+ */
+#define AL_IMAGE_BAND_SIZE ((size_t) 4 << 20)
+
+struct plane {
+    enum al_image_output output;
+    uint8_t *dst;
+    size_t dst_stride;
+    const uint8_t *src;
+    size_t src_stride;
+    size_t width;
+};
+
+static
+void
+_output_band(void *arg, size_t begin, size_t end)
+{
+    const struct plane *x = arg;
+    _output_rows(
+        x->output,
+        &(x->dst[begin * x->dst_stride]),
+        x->dst_stride,
+        &(x->src[begin * x->src_stride]),
+        x->src_stride,
+        x->width,
+        end - begin
+    );
+}
+
+static
+void
+_output_plane(
+    enum al_image_output output,
+    uint8_t *restrict dst,
+    size_t dst_stride,
+    const uint8_t *restrict src,
+    size_t src_stride,
+    size_t width,
+    size_t height
+) {
+    if (width == 0 || width * height < 2 * AL_IMAGE_BAND_SIZE) {
+        _output_rows(output, dst, dst_stride, src, src_stride, width, height);
+        return;
+    }
+    struct plane x = {
+        .output = output,
+        .dst = dst,
+        .dst_stride = dst_stride,
+        .src = src,
+        .src_stride = src_stride,
+        .width = width,
+    };
+    al_batch_rows(_output_band, &x, height, (AL_IMAGE_BAND_SIZE + width - 1) / width);
 }
 
 static inline
 enum al_status
-_copy_yuv420sp(const struct al_image *src, struct al_image *dst)
-{
+_copy_yuv420sp(
+    const struct al_image *src,
+    struct al_image *dst,
+    enum al_image_output output
+) {
     assert(src != NULL);
     assert(dst != NULL);
     if (src->data == NULL || dst->data == NULL)
         return AL_ERROR;
-    uint8_t *src_data = src->data;
+    const uint8_t *src_data = src->data;
     uint8_t *dst_data = dst->data;
-    memcpy(
-        dst->data,
-        src->data,
-        src->height * src->stride
+    // Y
+    _output_plane(
+        output,
+        dst_data,
+        dst->stride,
+        src_data,
+        src->stride,
+        src->width,
+        src->height
     );
-    memcpy(
+    // UV
+    _output_plane(
+        output,
         &(dst_data[dst->height * dst->stride]),
+        dst->stride,
         &(src_data[src->height * src->stride]),
-        (src->height / 2) * src->stride * sizeof (uint8_t)
+        src->stride,
+        src->width,
+        src->height / 2
     );
     return AL_OK;
 }
 
 static inline
 enum al_status
-_copy_rgba(const struct al_image *src, struct al_image *dst)
-{
+_copy_yuv420p(
+    const struct al_image *src,
+    struct al_image *dst,
+    enum al_image_output output
+) {
     assert(src != NULL);
     assert(dst != NULL);
     if (src->data == NULL || dst->data == NULL)
         return AL_ERROR;
-    uint8_t *src_data = src->data;
+    const uint8_t *src_data = src->data;
     uint8_t *dst_data = dst->data;
+    // Y
+    _output_plane(
+        output,
+        dst_data,
+        dst->stride,
+        src_data,
+        src->stride,
+        src->width,
+        src->height
+    );
+    // U, V
+    const uint8_t *src_u = &(src_data[src->height * src->stride]);
+    const uint8_t *src_v = src_u + (src->height / 2) * (src->stride / 2);
+    uint8_t *dst_u = &(dst_data[dst->height * dst->stride]);
+    uint8_t *dst_v = dst_u + (dst->height / 2) * (dst->stride / 2);
+    _output_plane(
+        output,
+        dst_u,
+        dst->stride / 2,
+        src_u,
+        src->stride / 2,
+        src->width / 2,
+        src->height / 2
+    );
+    _output_plane(
+        output,
+        dst_v,
+        dst->stride / 2,
+        src_v,
+        src->stride / 2,
+        src->width / 2,
+        src->height / 2
+    );
+    return AL_OK;
+}
+
+// The stride of an RGBA image is in pixels, like in al_image_alloc.
+static inline
+enum al_status
+_copy_rgba(
+    const struct al_image *src,
+    struct al_image *dst,
+    enum al_image_output output
+) {
+    assert(src != NULL);
+    assert(dst != NULL);
+    if (src->data == NULL || dst->data == NULL)
+        return AL_ERROR;
+    _output_plane(
+        output,
+        dst->data,
+        dst->stride * sizeof (uint32_t),
+        src->data,
+        src->stride * sizeof (uint32_t),
+        src->width * sizeof (uint32_t),
+        src->height
+    );
+    return AL_OK;
+}
+
+/*
+ * Copy src into dst, with the stores chosen by output (see al.h):
+ * AL_IMAGE_OUTPUT_AUTO streams destinations larger than half the cache.
+ */
+enum al_status
+al_image_copy_output(
+    const struct al_image *src,
+    struct al_image *dst,
+    enum al_image_output output
+) {
+    assert(src != NULL);
+    assert(dst != NULL);
+    if (src->data == NULL || dst->data == NULL)
+        return AL_ERROR;
+    if (src->format != dst->format)
+        return AL_ERROR;
+    if (!(src->width <= dst->width && src->height <= dst->height))
+        return AL_ERROR;
+    if (!(src->stride >= src->width && dst->stride >= dst->width))
+        return AL_ERROR;
+    enum al_status status = AL_NOTIMPLEMENTED;
+    AL_TRACE_BEGIN("al_image_copy");
+    output = _output(output, dst);
+    switch (src->format) {
+        case AL_COLOR_FORMAT_RGBA:
+            status = _copy_rgba(src, dst, output);
+            break;
+        case AL_COLOR_FORMAT_YUV420SP:
+            status = _copy_yuv420sp(src, dst, output);
+            break;
+        case AL_COLOR_FORMAT_YUV420P:
+            status = _copy_yuv420p(src, dst, output);
+            break;
+        case AL_COLOR_FORMAT_UNKNOWN:
+            break;
+    }
+    AL_TRACE_END("al_image_copy");
+    return status;
+}
+
+enum al_status
+al_image_copy(const struct al_image *src, struct al_image *dst)
+{
+    return al_image_copy_output(src, dst, AL_IMAGE_OUTPUT_AUTO);
+}
+
+/*
+ *  YUV420SP or YUV420P → RGBA
+ *
+ *  al_yuv_to_rgba writes packed rows, so convert one row at a time
+ *  when the destination is padded, or streamed: then each row is
+ *  converted into a buffer that stays in the cache, and streamed out.
+ */
+static
+enum al_status
+_convert_yuv420_to_rgba(
+    const struct al_image *src,
+    struct al_image *dst,
+    enum al_image_output output
+) {
+    const uint8_t *src_data = src->data;
+    const uint8_t *y = src_data;
+    const uint8_t *u = &(src_data[src->height * src->stride]);
+    const uint8_t *v = NULL;
+    size_t uv_stride = 0;
+    size_t uv_pixel_stride = 0;
+    switch (src->format) {
+        case AL_COLOR_FORMAT_YUV420SP:
+            v = u + 1;
+            uv_stride = src->stride;
+            uv_pixel_stride = 2;
+            break;
+        case AL_COLOR_FORMAT_YUV420P:
+            v = u + (src->height / 2) * (src->stride / 2);
+            uv_stride = src->stride / 2;
+            uv_pixel_stride = 1;
+            break;
+        case AL_COLOR_FORMAT_RGBA:
+        case AL_COLOR_FORMAT_UNKNOWN:
+            return AL_ERROR;
+    }
+    uint32_t *out = dst->data;
+    if (output == AL_IMAGE_OUTPUT_STREAM) {
+        // An even number of rows, of about 64 KB.
+        const size_t row_size = src->width * sizeof (uint32_t);
+        size_t rows = (((size_t) 64 << 10) / row_size) & ~(size_t) 1;
+        rows = rows > 2 ? rows : 2;
+        uint32_t *buffer = malloc(rows * row_size);
+        if (buffer == NULL)
+            return AL_NOMEMORY;
+        for (size_t i = 0; i < src->height; i += rows) {
+            const size_t n = src->height - i < rows ? src->height - i : rows;
+            const size_t j = (i / 2) * uv_stride;
+            al_yuv_to_rgba(
+                &(y[i * src->stride]), &(u[j]), &(v[j]),
+                buffer,
+                src->width, n,
+                src->stride, uv_stride,
+                1, uv_pixel_stride
+            );
+            _stream_plane(
+                (uint8_t *) &(out[i * dst->stride]),
+                dst->stride * sizeof (uint32_t),
+                (const uint8_t *) buffer,
+                row_size,
+                row_size,
+                n
+            );
+        }
+        free(buffer);
+        return AL_OK;
+    }
+    if (dst->stride == dst->width) {
+        al_yuv_to_rgba(
+            y, u, v, out,
+            src->width, src->height,
+            src->stride, uv_stride,
+            1, uv_pixel_stride
+        );
+        return AL_OK;
+    }
     for (size_t i = 0; i < src->height; i++) {
-        memcpy(
-            &(dst_data[i * dst->stride]),
-            &(src_data[i * src->stride]),
-            dst->width * sizeof (uint32_t)
+        const size_t j = (i / 2) * uv_stride;
+        al_yuv_to_rgba(
+            &(y[i * src->stride]), &(u[j]), &(v[j]),
+            &(out[i * dst->stride]),
+            src->width, 1,
+            src->stride, uv_stride,
+            1, uv_pixel_stride
         );
     }
     return AL_OK;
 }
 
+/*
+ *  YUV420SP ↔ YUV420P
+ */
+static
 enum al_status
-al_image_copy(const struct al_image *src, struct al_image *dst)
-{
+_convert_yuv420_chroma(
+    const struct al_image *src,
+    struct al_image *dst,
+    enum al_image_output output
+) {
+    const uint8_t *src_data = src->data;
+    uint8_t *dst_data = dst->data;
+    _output_plane(
+        output,
+        dst_data,
+        dst->stride,
+        src_data,
+        src->stride,
+        src->width,
+        src->height
+    );
+    const uint8_t *src_uv = &(src_data[src->height * src->stride]);
+    uint8_t *dst_uv = &(dst_data[dst->height * dst->stride]);
+    const size_t width = src->width / 2;
+    const size_t height = src->height / 2;
+    if (src->format == AL_COLOR_FORMAT_YUV420SP) {
+        uint8_t *dst_u = dst_uv;
+        uint8_t *dst_v = dst_uv + height * (dst->stride / 2);
+        for (size_t i = 0; i < height; i++) {
+            const uint8_t *uv = &(src_uv[i * src->stride]);
+            uint8_t *u = &(dst_u[i * (dst->stride / 2)]);
+            uint8_t *v = &(dst_v[i * (dst->stride / 2)]);
+            for (size_t j = 0; j < width; j++) {
+                u[j] = uv[2 * j];
+                v[j] = uv[2 * j + 1];
+            }
+        }
+    } else {
+        const uint8_t *src_u = src_uv;
+        const uint8_t *src_v = src_uv + height * (src->stride / 2);
+        for (size_t i = 0; i < height; i++) {
+            const uint8_t *u = &(src_u[i * (src->stride / 2)]);
+            const uint8_t *v = &(src_v[i * (src->stride / 2)]);
+            uint8_t *uv = &(dst_uv[i * dst->stride]);
+            for (size_t j = 0; j < width; j++) {
+                uv[2 * j] = u[j];
+                uv[2 * j + 1] = v[j];
+            }
+        }
+    }
+    return AL_OK;
+}
+
+/*
+ * Convert src into dst, with the stores chosen by output, as in
+ * al_image_copy_output. Only the luma plane and RGBA rows are streamed,
+ * and only on request: the conversion to RGBA is then done a few rows at
+ * a time into a buffer, and streamed out from there. That costs another
+ * pass over the output, from the cache, which only pays where the output
+ * would evict what the next stage reads, or memory bandwidth is short.
+ */
+enum al_status
+al_image_convert_output(
+    const struct al_image *src,
+    struct al_image *dst,
+    enum al_image_output output
+) {
     assert(src != NULL);
     assert(dst != NULL);
-    assert(src->format == dst->format);
+    if (src->data == NULL || dst->data == NULL)
+        return AL_ERROR;
+    if (!(src->width == dst->width && src->height == dst->height))
+        return AL_ERROR;
+    if (!(src->stride >= src->width && dst->stride >= dst->width))
+        return AL_ERROR;
+    if (src->format == dst->format)
+        return al_image_copy_output(src, dst, output);
+    switch (src->format) {
+        case AL_COLOR_FORMAT_YUV420SP:
+        case AL_COLOR_FORMAT_YUV420P:
+            switch (dst->format) {
+                case AL_COLOR_FORMAT_RGBA:
+                    return _convert_yuv420_to_rgba(src, dst, output);
+                case AL_COLOR_FORMAT_YUV420SP:
+                case AL_COLOR_FORMAT_YUV420P:
+                    return _convert_yuv420_chroma(src, dst, output);
+                case AL_COLOR_FORMAT_UNKNOWN:
+                    break;
+            }
+            break;
+        case AL_COLOR_FORMAT_RGBA:
+        case AL_COLOR_FORMAT_UNKNOWN:
+            break;
+    }
+    return AL_NOTIMPLEMENTED;
+}
+
+enum al_status
+al_image_convert(const struct al_image *src, struct al_image *dst)
+{
+    return al_image_convert_output(src, dst, AL_IMAGE_OUTPUT_AUTO);
+}
+
+/*
+ * Nearest-neighbour scaling of one plane of elements of the given size
+ * (1 for Y, U and V, 2 for interleaved UV, 4 for RGBA), in 16.16 fixed
+ * point. Strides are in bytes.
+ */
+static inline
+void
+__attribute__((always_inline))
+_resize_plane(
+    uint8_t *restrict dst,
+    size_t dst_stride,
+    size_t dst_width,
+    size_t dst_height,
+    const uint8_t *restrict src,
+    size_t src_stride,
+    size_t src_width,
+    size_t src_height,
+    const size_t size
+) {
+    const uint64_t dx = ((uint64_t) src_width << 16) / dst_width;
+    const uint64_t dy = ((uint64_t) src_height << 16) / dst_height;
+    uint64_t y = dy / 2;
+    for (size_t i = 0; i < dst_height; i++, y += dy) {
+        const uint8_t *s = &(src[(y >> 16) * src_stride]);
+        uint8_t *d = &(dst[i * dst_stride]);
+        uint64_t x = dx / 2;
+        for (size_t j = 0; j < dst_width; j++, x += dx) {
+            memcpy(&(d[j * size]), &(s[(x >> 16) * size]), size);
+        }
+    }
+}
+
+static
+enum al_status
+_resize(const struct al_image *src, struct al_image *dst)
+{
+    const uint8_t *src_data = src->data;
+    uint8_t *dst_data = dst->data;
     switch (src->format) {
         case AL_COLOR_FORMAT_RGBA:
-            return _copy_rgba(src, dst);
+            al_kernels.resize_plane(
+                dst_data, dst->stride * sizeof (uint32_t),
+                dst->width, dst->height,
+                src_data, src->stride * sizeof (uint32_t),
+                src->width, src->height,
+                sizeof (uint32_t)
+            );
+            return AL_OK;
         case AL_COLOR_FORMAT_YUV420SP:
-            return _copy_yuv420sp(src, dst);
         case AL_COLOR_FORMAT_YUV420P:
+            break;
         case AL_COLOR_FORMAT_UNKNOWN:
             return AL_NOTIMPLEMENTED;
     }
+    if (src->width < 2 || src->height < 2)
+        return AL_ERROR;
+    if (dst->width < 2 || dst->height < 2)
+        return AL_ERROR;
+    // Y
+    al_kernels.resize_plane(
+        dst_data, dst->stride, dst->width, dst->height,
+        src_data, src->stride, src->width, src->height,
+        1
+    );
+    const uint8_t *src_uv = &(src_data[src->height * src->stride]);
+    uint8_t *dst_uv = &(dst_data[dst->height * dst->stride]);
+    if (src->format == AL_COLOR_FORMAT_YUV420SP) {
+        // UV, as pairs
+        al_kernels.resize_plane(
+            dst_uv, dst->stride, dst->width / 2, dst->height / 2,
+            src_uv, src->stride, src->width / 2, src->height / 2,
+            2
+        );
+        return AL_OK;
+    }
+    // U, V
+    for (size_t k = 0; k < 2; k++) {
+        al_kernels.resize_plane(
+            &(dst_uv[k * (dst->height / 2) * (dst->stride / 2)]),
+            dst->stride / 2, dst->width / 2, dst->height / 2,
+            &(src_uv[k * (src->height / 2) * (src->stride / 2)]),
+            src->stride / 2, src->width / 2, src->height / 2,
+            1
+        );
+    }
+    return AL_OK;
 }
 
+enum al_status
+al_image_resize(const struct al_image *src, struct al_image *dst)
+{
+    assert(src != NULL);
+    assert(dst != NULL);
+    if (src->data == NULL || dst->data == NULL)
+        return AL_ERROR;
+    if (src->format != dst->format)
+        return AL_ERROR;
+    if (!(src->width > 0 && src->height > 0))
+        return AL_ERROR;
+    if (!(dst->width > 0 && dst->height > 0))
+        return AL_ERROR;
+    if (!(src->stride >= src->width && dst->stride >= dst->width))
+        return AL_ERROR;
+    AL_TRACE_BEGIN("al_image_resize");
+    enum al_status status = _resize(src, dst);
+    AL_TRACE_END("al_image_resize");
+    return status;
+}
+
+// Copying is left to memcpy, which does its own dispatch.
+__attribute__((visibility("hidden")))
+void
+_al_copy_plane_scalar(
+    uint8_t *restrict dst,
+    size_t dst_stride,
+    const uint8_t *restrict src,
+    size_t src_stride,
+    size_t width,
+    size_t height
+) {
+    _copy_plane(dst, dst_stride, src, src_stride, width, height);
+}
+
+/*
+ * The other plane kernels above, compiled for each target (see yuv.c).
+ * Resizing is specialized for the element sizes in use.
+ */
+#define AL_IMAGE_VARIANT(suffix, ...) \
+    __VA_ARGS__ void _al_resize_plane_##suffix( \
+        uint8_t *restrict dst, \
+        size_t dst_stride, \
+        size_t dst_width, \
+        size_t dst_height, \
+        const uint8_t *restrict src, \
+        size_t src_stride, \
+        size_t src_width, \
+        size_t src_height, \
+        size_t size \
+    ) { \
+        switch (size) { \
+            case 1: \
+                _resize_plane( \
+                    dst, dst_stride, dst_width, dst_height, \
+                    src, src_stride, src_width, src_height, 1 \
+                ); \
+                break; \
+            case 2: \
+                _resize_plane( \
+                    dst, dst_stride, dst_width, dst_height, \
+                    src, src_stride, src_width, src_height, 2 \
+                ); \
+                break; \
+            case 4: \
+                _resize_plane( \
+                    dst, dst_stride, dst_width, dst_height, \
+                    src, src_stride, src_width, src_height, 4 \
+                ); \
+                break; \
+            default: \
+                _resize_plane( \
+                    dst, dst_stride, dst_width, dst_height, \
+                    src, src_stride, src_width, src_height, size \
+                ); \
+                break; \
+        } \
+    } \
+    __VA_ARGS__ void _al_rotate_plane_##suffix( \
+        uint8_t *restrict dst, \
+        size_t dst_stride, \
+        const uint8_t *restrict src, \
+        size_t src_stride, \
+        size_t width, \
+        size_t height \
+    ) { \
+        _rotate_plane(dst, dst_stride, src, src_stride, width, height); \
+    }
+
+AL_IMAGE_VARIANT(scalar, __attribute__((visibility("hidden"))))
+
+#if defined(__x86_64__) || defined(__i386__)
+AL_IMAGE_VARIANT(avx2, static __attribute__((target("avx2"))))
+#endif
+
+__attribute__((visibility("hidden")))
+const struct al_image_variant al_image_variants[] = {
+    {
+        .name = "scalar",
+        .supported = NULL,
+        .copy_plane = _al_copy_plane_scalar,
+        .resize_plane = _al_resize_plane_scalar,
+        .rotate_plane = _al_rotate_plane_scalar,
+    },
+#if defined(__x86_64__) || defined(__i386__)
+    {
+        .name = "avx2",
+        .supported = al_cpu_avx2,
+        .copy_plane = NULL,
+        .resize_plane = _al_resize_plane_avx2,
+        .rotate_plane = _al_rotate_plane_avx2,
+    },
+#endif
+};
+
+__attribute__((visibility("hidden")))
+const size_t al_image_variants_count =
+    sizeof (al_image_variants) / sizeof (al_image_variants[0]);
+
 #if defined(TEST)
 
 #include <stdint.h> // uint8_t
 #include <stdlib.h> // calloc
+#include <string.h> // memcmp, memset
 
 #include "test.h"
 
+struct test_plane {
+    uint8_t *data;
+    size_t width;
+    size_t height;
+    size_t stride;
+    size_t n;
+};
+
+static
+size_t
+_planes(const struct al_image *x, struct test_plane planes[3])
+{
+    uint8_t *data = x->data;
+    switch (x->format) {
+        case AL_COLOR_FORMAT_RGBA:
+            planes[0] = (struct test_plane) {
+                data, x->width, x->height, x->stride * 4, 4,
+            };
+            return 1;
+        case AL_COLOR_FORMAT_YUV420SP:
+            planes[0] = (struct test_plane) {
+                data, x->width, x->height, x->stride, 1,
+            };
+            planes[1] = (struct test_plane) {
+                data + x->height * x->stride,
+                x->width / 2, x->height / 2, x->stride, 2,
+            };
+            return 2;
+        case AL_COLOR_FORMAT_YUV420P:
+            planes[0] = (struct test_plane) {
+                data, x->width, x->height, x->stride, 1,
+            };
+            planes[1] = (struct test_plane) {
+                data + x->height * x->stride,
+                x->width / 2, x->height / 2, x->stride / 2, 1,
+            };
+            planes[2] = (struct test_plane) {
+                planes[1].data + (x->height / 2) * (x->stride / 2),
+                x->width / 2, x->height / 2, x->stride / 2, 1,
+            };
+            return 3;
+        case AL_COLOR_FORMAT_UNKNOWN:
+            break;
+    }
+    return 0;
+}
+
 int
 main(void)
 {
-    const uint8_t data[][3] = {
-        { 1,  2,  3},
-        { 4,  5,  6},
-        { 7,  8,  9},
-        {10, 11, 12},
+    const uint8_t data[][4] = {
+        { 1,  2,  3,  4},
+        { 5,  6,  7,  8},
+        { 9, 10, 11, 12},
     };
     struct al_image x = {
-        .width = 3,
-        .height = 4,
-        .stride = 3,
+        .width = 4,
+        .height = 2,
+        .stride = 4,
         .data = data,
+        .format = AL_COLOR_FORMAT_YUV420SP,
     };
     struct al_image y = {
         .width = x.height,
         .height = x.width,
         .stride = x.height,
-        .data = calloc(x.height, x.stride * sizeof (uint8_t)),
+        .data = calloc(sizeof (data), sizeof (uint8_t)),
+        .format = AL_COLOR_FORMAT_YUV420SP,
     };
     _al_dump(&x);
     enum al_status status = al_image_rotate(&x, &y, 90);
     _al_dump(&y);
     dump_status(status);
     assert(status == AL_OK);
+    const uint8_t rotated[] = {5, 1, 6, 2, 7, 3, 8, 4, 9, 10, 11, 12};
+    assert(memcmp(y.data, rotated, sizeof (rotated)) == 0);
+    free(y.data);
+
+    // rotate padded images by every angle and check each pixel
+    const int angles[] = {0, 90, 180, 270, -90, 450};
+    for (size_t k = 0; k < 3; k++) {
+        const enum al_color_format format = (enum al_color_format []) {
+            AL_COLOR_FORMAT_YUV420SP,
+            AL_COLOR_FORMAT_YUV420P,
+            AL_COLOR_FORMAT_RGBA,
+        }[k];
+        for (size_t l = 0; l < sizeof (angles) / sizeof (angles[0]); l++) {
+            const int degrees = ((angles[l] % 360) + 360) % 360;
+            const bool swap = degrees == 90 || degrees == 270;
+            struct al_image a = {.width = 6, .height = 4, .stride = 8};
+            struct al_image b = {
+                .width = swap ? a.height : a.width,
+                .height = swap ? a.width : a.height,
+                .stride = 10,
+            };
+            a.format = b.format = format;
+            status = al_image_alloc(&a);
+            assert(status == AL_OK);
+            status = al_image_alloc(&b);
+            assert(status == AL_OK);
+            struct test_plane p[3], q[3];
+            const size_t m = _planes(&a, p);
+            const size_t mq = _planes(&b, q);
+            assert(mq == m);
+            for (size_t c = 0; c < m; c++)
+                for (size_t i = 0; i < p[c].height; i++)
+                    for (size_t j = 0; j < p[c].width * p[c].n; j++)
+                        p[c].data[i * p[c].stride + j] =
+                            (uint8_t) (c * 64 + i * 16 + j);
+            status = al_image_rotate(&a, &b, angles[l]);
+            dump_status(status);
+            assert(status == AL_OK);
+            for (size_t c = 0; c < m; c++) {
+                const size_t w = p[c].width, h = p[c].height, n = p[c].n;
+                for (size_t i = 0; i < h; i++) {
+                    for (size_t j = 0; j < w; j++) {
+                        size_t u = i, v = j;
+                        switch (degrees) {
+                            case 90: u = j; v = (h - 1) - i; break;
+                            case 180: u = (h - 1) - i; v = (w - 1) - j; break;
+                            case 270: u = (w - 1) - j; v = i; break;
+                            default: break;
+                        }
+                        assert(memcmp(
+                            &(q[c].data[u * q[c].stride + v * n]),
+                            &(p[c].data[i * p[c].stride + j * n]),
+                            n
+                        ) == 0);
+                    }
+                }
+            }
+            al_image_free(&a);
+            al_image_free(&b);
+        }
+    }
+
+    // copy into a padded image and back
+    const enum al_color_format formats[] = {
+        AL_COLOR_FORMAT_YUV420SP,
+        AL_COLOR_FORMAT_YUV420P,
+        AL_COLOR_FORMAT_RGBA,
+    };
+    for (size_t k = 0; k < sizeof (formats) / sizeof (formats[0]); k++) {
+        struct al_image a = {.width = 6, .height = 4, .stride = 6};
+        struct al_image b = {.width = 6, .height = 4, .stride = 10};
+        struct al_image c = {.width = 6, .height = 4, .stride = 6};
+        a.format = b.format = c.format = formats[k];
+        status = al_image_alloc(&a);
+        assert(status == AL_OK);
+        status = al_image_alloc(&b);
+        assert(status == AL_OK);
+        status = al_image_alloc(&c);
+        assert(status == AL_OK);
+        size_t size = formats[k] == AL_COLOR_FORMAT_RGBA ? 6 * 4 * 4 : 6 * 6;
+        for (size_t i = 0; i < size; i++)
+            ((uint8_t *) a.data)[i] = (uint8_t) i;
+        memset(c.data, 0, size);
+        status = al_image_copy(&a, &b);
+        dump_status(status);
+        assert(status == AL_OK);
+        status = al_image_copy(&b, &c);
+        assert(status == AL_OK);
+        assert(memcmp(a.data, c.data, size) == 0);
+        al_image_free(&a);
+        al_image_free(&b);
+        al_image_free(&c);
+    }
+
+    // resize down and back up, which is exact for 2×2 blocks
+    for (size_t k = 0; k < sizeof (formats) / sizeof (formats[0]); k++) {
+        struct al_image a = {.width = 8, .height = 4, .stride = 8};
+        struct al_image b = {.width = 4, .height = 2, .stride = 6};
+        struct al_image c = {.width = 8, .height = 4, .stride = 8};
+        a.format = b.format = c.format = formats[k];
+        status = al_image_alloc(&a);
+        assert(status == AL_OK);
+        status = al_image_alloc(&b);
+        assert(status == AL_OK);
+        status = al_image_alloc(&c);
+        assert(status == AL_OK);
+        const size_t n = formats[k] == AL_COLOR_FORMAT_RGBA ? 4 : 1;
+        const size_t size = formats[k] == AL_COLOR_FORMAT_RGBA ? 8 * 4 * 4 : 8 * 6;
+        uint8_t *x = a.data;
+        memset(x, 0x80, size);
+        for (size_t i = 0; i < 4; i++)
+            for (size_t j = 0; j < 8 * n; j++)
+                x[i * 8 * n + j] = (uint8_t) (i / 2 * 64 + j / (2 * n) * 8 + j % n);
+        status = al_image_resize(&a, &b);
+        dump_status(status);
+        assert(status == AL_OK);
+        status = al_image_resize(&b, &c);
+        assert(status == AL_OK);
+        assert(memcmp(a.data, c.data, size) == 0);
+        al_image_free(&a);
+        al_image_free(&b);
+        al_image_free(&c);
+    }
+
+    // convert NV12 → padded I420 → NV12, and to packed and padded RGBA
+    {
+        struct al_image a = {.width = 6, .height = 4, .stride = 6};
+        struct al_image b = {.width = 6, .height = 4, .stride = 10};
+        struct al_image c = {.width = 6, .height = 4, .stride = 6};
+        struct al_image d = {.width = 6, .height = 4, .stride = 6};
+        struct al_image e = {.width = 6, .height = 4, .stride = 8};
+        a.format = c.format = AL_COLOR_FORMAT_YUV420SP;
+        b.format = AL_COLOR_FORMAT_YUV420P;
+        d.format = e.format = AL_COLOR_FORMAT_RGBA;
+        status = al_image_alloc(&a);
+        assert(status == AL_OK);
+        status = al_image_alloc(&b);
+        assert(status == AL_OK);
+        status = al_image_alloc(&c);
+        assert(status == AL_OK);
+        status = al_image_alloc(&d);
+        assert(status == AL_OK);
+        status = al_image_alloc(&e);
+        assert(status == AL_OK);
+        for (size_t i = 0; i < 6 * 6; i++)
+            ((uint8_t *) a.data)[i] = (uint8_t) (16 + 6 * i);
+        status = al_image_convert(&a, &b);
+        dump_status(status);
+        assert(status == AL_OK);
+        const uint8_t *u = (uint8_t *) b.data + b.height * b.stride;
+        assert(u[0] == ((uint8_t *) a.data)[24]);
+        assert(u[(b.height / 2) * (b.stride / 2)] == ((uint8_t *) a.data)[25]);
+        status = al_image_convert(&b, &c);
+        assert(status == AL_OK);
+        assert(memcmp(a.data, c.data, 6 * 6) == 0);
+        status = al_image_convert(&a, &d);
+        assert(status == AL_OK);
+        status = al_image_convert(&b, &e);
+        assert(status == AL_OK);
+        for (size_t i = 0; i < 4; i++) {
+            const uint32_t *x = (uint32_t *) d.data + i * d.stride;
+            const uint32_t *y = (uint32_t *) e.data + i * e.stride;
+            assert(memcmp(x, y, 6 * sizeof (uint32_t)) == 0);
+        }
+        status = al_image_convert(&d, &a);
+        assert(status == AL_NOTIMPLEMENTED);
+        al_image_free(&a);
+        al_image_free(&b);
+        al_image_free(&c);
+        al_image_free(&d);
+        al_image_free(&e);
+    }
+
+    // account for buffers, also when reallocated at another size
+    {
+        struct al_memory owner = {0};
+        struct al_memory_stats before, stats;
+        al_memory_get_stats(&before);
+        struct al_image a = {.width = 8, .height = 4, .stride = 8};
+        a.format = AL_COLOR_FORMAT_RGBA;
+        status = al_memory_image_alloc(&owner, &a);
+        assert(status == AL_OK);
+        al_memory_get(&owner, &stats);
+        assert(stats.bytes == 8 * 4 * 4 && stats.buffers == 1);
+        a.height = 2;
+        status = al_memory_image_alloc(&owner, &a);
+        assert(status == AL_OK);
+        al_memory_get(&owner, &stats);
+        assert(stats.bytes == 8 * 2 * 4 && stats.buffers == 1);
+        assert(stats.peak_bytes == 8 * 4 * 4 && stats.allocations == 2);
+        al_memory_get_stats(&stats);
+        assert(stats.bytes == before.bytes + 8 * 2 * 4);
+        assert(stats.buffers == before.buffers + 1);
+        a.width = 2;
+        al_image_free(&a);
+        al_memory_get(&owner, &stats);
+        assert(stats.bytes == 0 && stats.buffers == 0);
+        al_memory_get_stats(&stats);
+        assert(stats.bytes == before.bytes);
+        assert(stats.buffers == before.buffers);
+    }
+
+    // padded images: whole rows of padding units, and zeros after
+    {
+        const struct {
+            enum al_color_format format;
+            size_t width;
+            size_t stride;
+            size_t expected;
+        } cases[] = {
+            {AL_COLOR_FORMAT_RGBA, 1, 0, 16},
+            {AL_COLOR_FORMAT_RGBA, 16, 0, 16},
+            {AL_COLOR_FORMAT_RGBA, 320, 0, 320},
+            {AL_COLOR_FORMAT_RGBA, 321, 0, 336},
+            {AL_COLOR_FORMAT_RGBA, 20, 40, 48},
+            {AL_COLOR_FORMAT_YUV420SP, 320, 0, 384},
+            {AL_COLOR_FORMAT_YUV420P, 128, 0, 128},
+        };
+        for (size_t i = 0; i < sizeof (cases) / sizeof (cases[0]); i++) {
+            struct al_image a = {
+                .width = cases[i].width,
+                .height = 3,
+                .stride = cases[i].stride,
+                .format = cases[i].format,
+            };
+            struct al_memory_stats before, stats;
+            al_memory_get_stats(&before);
+            status = al_image_alloc_padded(&a);
+            assert(status == AL_OK);
+            assert(a.stride == cases[i].expected);
+            assert((uintptr_t) a.data % AL_IMAGE_PADDING == 0);
+            size_t size = a.stride * a.height;
+            size = a.format == AL_COLOR_FORMAT_RGBA ? size * 4 : size * 3 / 2;
+            al_memory_get_stats(&stats);
+            assert(stats.bytes == before.bytes + size + AL_IMAGE_PADDING);
+            const uint8_t *end = (uint8_t *) a.data + size;
+            for (size_t j = 0; j < AL_IMAGE_PADDING; j++)
+                assert(end[j] == 0);
+            memset(a.data, 0xff, size + AL_IMAGE_PADDING);
+            al_image_free(&a);
+        }
+    }
+
+    // packed rows, and planes large enough to be copied by bands, on the
+    // worker pool
+    al_batch_init();
+    {
+        const size_t sizes[][3] = {
+            {6, 4, 6},
+            {3840, 2160, 3840},
+            {3840, 2160, 3872},
+        };
+        for (size_t i = 0; i < sizeof (sizes) / sizeof (sizes[0]); i++) {
+            const enum al_color_format formats[] = {
+                AL_COLOR_FORMAT_RGBA,
+                AL_COLOR_FORMAT_YUV420SP,
+            };
+            for (size_t k = 0; k < 2; k++) {
+                struct al_image a = {
+                    .width = sizes[i][0],
+                    .height = sizes[i][1],
+                    .stride = sizes[i][2],
+                    .format = formats[k],
+                };
+                struct al_image b = a;
+                b.stride = sizes[i][0];
+                status = al_image_alloc(&a);
+                assert(status == AL_OK);
+                status = al_image_alloc(&b);
+                assert(status == AL_OK);
+                const size_t bpp = k == 0 ? 4 : 1;
+                const size_t rows = k == 0 ? a.height : a.height * 3 / 2;
+                uint8_t *x = a.data;
+                for (size_t j = 0; j < a.stride * rows * bpp; j++)
+                    x[j] = (uint8_t) (j * 13 + 1);
+                status = al_image_copy(&a, &b);
+                assert(status == AL_OK);
+                for (size_t r = 0; r < rows; r++) {
+                    const uint8_t *y = (uint8_t *) b.data + r * b.stride * bpp;
+                    assert(memcmp(y, x + r * a.stride * bpp, a.width * bpp) == 0);
+                }
+                al_image_free(&a);
+                al_image_free(&b);
+            }
+        }
+    }
+
+    // mismatched formats and sizes are errors, not overflows
+    {
+        struct al_image a = {.width = 6, .height = 4};
+        struct al_image b = {.width = 6, .height = 4};
+        struct al_image c = {.width = 4, .height = 6};
+        a.format = AL_COLOR_FORMAT_RGBA;
+        b.format = c.format = AL_COLOR_FORMAT_YUV420SP;
+        status = al_image_alloc(&a);
+        assert(status == AL_OK);
+        status = al_image_alloc(&b);
+        assert(status == AL_OK);
+        status = al_image_alloc(&c);
+        assert(status == AL_OK);
+        const struct al_image_op copy = {.operation = AL_IMAGE_COPY};
+        status = al_image_batch(&copy, &a, &b, 1);
+        assert(status == AL_ERROR);
+        const struct al_image_op rotate = {
+            .operation = AL_IMAGE_ROTATE,
+            .degrees = 180,
+        };
+        status = al_image_batch(&rotate, &b, &c, 1);
+        assert(status == AL_ERROR);
+        status = al_image_rotate(&b, &c, 45);
+        assert(status == AL_ERROR);
+        const struct al_image_op rotate270 = {
+            .operation = AL_IMAGE_ROTATE,
+            .degrees = 270,
+        };
+        status = al_image_batch(&rotate270, &b, &c, 1);
+        assert(status == AL_OK);
+        al_image_free(&a);
+        al_image_free(&b);
+        al_image_free(&c);
+    }
+
+    // large buffers, mapped on huge pages if AL_HUGEPAGES is set
+    {
+        struct al_image a = {.width = 3840, .height = 2160};
+        a.format = AL_COLOR_FORMAT_RGBA;
+        status = al_image_alloc(&a);
+        assert(status == AL_OK);
+        assert((uintptr_t) a.data % AL_IMAGE_PADDING == 0);
+        const size_t size = a.stride * a.height * 4;
+        ((uint8_t *) a.data)[0] = 1;
+        ((uint8_t *) a.data)[size - 1] = 1;
+        al_image_free(&a);
+    }
 
     return 0;
 }
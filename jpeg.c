@@ -0,0 +1,683 @@
+/* Copyright 2023-2025, Mansour Moufid <mansourmoufid@gmail.com> */
+
+/*
+ * This file is part of Aluminium Library.
+ *
+ * Aluminium Library is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Aluminium Library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with Aluminium Library. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*
+ * A small baseline JPEG encoder, used by the stream module to serve MJPEG.
+ *
+ * It takes 4:2:0 YUV as captured (planar or semi-planar) and so needs no
+ * colour conversion: the Y, U and V planes map directly to the JFIF
+ * components, with chroma subsampled 2x2.
+ */
+
+#if defined(DEBUG)
+#undef NDEBUG
+#endif
+
+#include <assert.h>
+#include <errno.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h> // calloc, free
+#include <string.h> // strerror
+
+#include "jpeg.h"
+
+// natural index of each coefficient in zigzag order
+static const uint8_t zigzag[64] = {
+     0,  1,  8, 16,  9,  2,  3, 10,
+    17, 24, 32, 25, 18, 11,  4,  5,
+    12, 19, 26, 33, 40, 48, 41, 34,
+    27, 20, 13,  6,  7, 14, 21, 28,
+    35, 42, 49, 56, 57, 50, 43, 36,
+    29, 22, 15, 23, 30, 37, 44, 51,
+    58, 59, 52, 45, 38, 31, 39, 46,
+    53, 60, 61, 54, 47, 55, 62, 63,
+};
+
+// ITU T.81 Annex K, tables K.1 and K.2
+static const uint8_t quant_luminance[64] = {
+    16,  11,  10,  16,  24,  40,  51,  61,
+    12,  12,  14,  19,  26,  58,  60,  55,
+    14,  13,  16,  24,  40,  57,  69,  56,
+    14,  17,  22,  29,  51,  87,  80,  62,
+    18,  22,  37,  56,  68, 109, 103,  77,
+    24,  35,  55,  64,  81, 104, 113,  92,
+    49,  64,  78,  87, 103, 121, 120, 101,
+    72,  92,  95,  98, 112, 100, 103,  99,
+};
+
+static const uint8_t quant_chrominance[64] = {
+    17,  18,  24,  47,  99,  99,  99,  99,
+    18,  21,  26,  66,  99,  99,  99,  99,
+    24,  26,  56,  99,  99,  99,  99,  99,
+    47,  66,  99,  99,  99,  99,  99,  99,
+    99,  99,  99,  99,  99,  99,  99,  99,
+    99,  99,  99,  99,  99,  99,  99,  99,
+    99,  99,  99,  99,  99,  99,  99,  99,
+    99,  99,  99,  99,  99,  99,  99,  99,
+};
+
+// ITU T.81 Annex K, tables K.3 to K.6
+static const uint8_t dc_luminance_bits[16] = {
+    0, 1, 5, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0, 0, 0,
+};
+
+static const uint8_t dc_chrominance_bits[16] = {
+    0, 3, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0,
+};
+
+static const uint8_t dc_values[12] = {
+    0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11,
+};
+
+static const uint8_t ac_luminance_bits[16] = {
+    0, 2, 1, 3, 3, 2, 4, 3, 5, 5, 4, 4, 0, 0, 1, 0x7d,
+};
+
+static const uint8_t ac_luminance_values[162] = {
+    0x01, 0x02, 0x03, 0x00, 0x04, 0x11, 0x05, 0x12,
+    0x21, 0x31, 0x41, 0x06, 0x13, 0x51, 0x61, 0x07,
+    0x22, 0x71, 0x14, 0x32, 0x81, 0x91, 0xa1, 0x08,
+    0x23, 0x42, 0xb1, 0xc1, 0x15, 0x52, 0xd1, 0xf0,
+    0x24, 0x33, 0x62, 0x72, 0x82, 0x09, 0x0a, 0x16,
+    0x17, 0x18, 0x19, 0x1a, 0x25, 0x26, 0x27, 0x28,
+    0x29, 0x2a, 0x34, 0x35, 0x36, 0x37, 0x38, 0x39,
+    0x3a, 0x43, 0x44, 0x45, 0x46, 0x47, 0x48, 0x49,
+    0x4a, 0x53, 0x54, 0x55, 0x56, 0x57, 0x58, 0x59,
+    0x5a, 0x63, 0x64, 0x65, 0x66, 0x67, 0x68, 0x69,
+    0x6a, 0x73, 0x74, 0x75, 0x76, 0x77, 0x78, 0x79,
+    0x7a, 0x83, 0x84, 0x85, 0x86, 0x87, 0x88, 0x89,
+    0x8a, 0x92, 0x93, 0x94, 0x95, 0x96, 0x97, 0x98,
+    0x99, 0x9a, 0xa2, 0xa3, 0xa4, 0xa5, 0xa6, 0xa7,
+    0xa8, 0xa9, 0xaa, 0xb2, 0xb3, 0xb4, 0xb5, 0xb6,
+    0xb7, 0xb8, 0xb9, 0xba, 0xc2, 0xc3, 0xc4, 0xc5,
+    0xc6, 0xc7, 0xc8, 0xc9, 0xca, 0xd2, 0xd3, 0xd4,
+    0xd5, 0xd6, 0xd7, 0xd8, 0xd9, 0xda, 0xe1, 0xe2,
+    0xe3, 0xe4, 0xe5, 0xe6, 0xe7, 0xe8, 0xe9, 0xea,
+    0xf1, 0xf2, 0xf3, 0xf4, 0xf5, 0xf6, 0xf7, 0xf8,
+    0xf9, 0xfa,
+};
+
+static const uint8_t ac_chrominance_bits[16] = {
+    0, 2, 1, 2, 4, 4, 3, 4, 7, 5, 4, 4, 0, 1, 2, 0x77,
+};
+
+static const uint8_t ac_chrominance_values[162] = {
+    0x00, 0x01, 0x02, 0x03, 0x11, 0x04, 0x05, 0x21,
+    0x31, 0x06, 0x12, 0x41, 0x51, 0x07, 0x61, 0x71,
+    0x13, 0x22, 0x32, 0x81, 0x08, 0x14, 0x42, 0x91,
+    0xa1, 0xb1, 0xc1, 0x09, 0x23, 0x33, 0x52, 0xf0,
+    0x15, 0x62, 0x72, 0xd1, 0x0a, 0x16, 0x24, 0x34,
+    0xe1, 0x25, 0xf1, 0x17, 0x18, 0x19, 0x1a, 0x26,
+    0x27, 0x28, 0x29, 0x2a, 0x35, 0x36, 0x37, 0x38,
+    0x39, 0x3a, 0x43, 0x44, 0x45, 0x46, 0x47, 0x48,
+    0x49, 0x4a, 0x53, 0x54, 0x55, 0x56, 0x57, 0x58,
+    0x59, 0x5a, 0x63, 0x64, 0x65, 0x66, 0x67, 0x68,
+    0x69, 0x6a, 0x73, 0x74, 0x75, 0x76, 0x77, 0x78,
+    0x79, 0x7a, 0x82, 0x83, 0x84, 0x85, 0x86, 0x87,
+    0x88, 0x89, 0x8a, 0x92, 0x93, 0x94, 0x95, 0x96,
+    0x97, 0x98, 0x99, 0x9a, 0xa2, 0xa3, 0xa4, 0xa5,
+    0xa6, 0xa7, 0xa8, 0xa9, 0xaa, 0xb2, 0xb3, 0xb4,
+    0xb5, 0xb6, 0xb7, 0xb8, 0xb9, 0xba, 0xc2, 0xc3,
+    0xc4, 0xc5, 0xc6, 0xc7, 0xc8, 0xc9, 0xca, 0xd2,
+    0xd3, 0xd4, 0xd5, 0xd6, 0xd7, 0xd8, 0xd9, 0xda,
+    0xe2, 0xe3, 0xe4, 0xe5, 0xe6, 0xe7, 0xe8, 0xe9,
+    0xea, 0xf2, 0xf3, 0xf4, 0xf5, 0xf6, 0xf7, 0xf8,
+    0xf9, 0xfa,
+};
+
+// Arai, Agui and Nakajima DCT output scale factors
+static const float aan[8] = {
+    1.0f,
+    1.387039845f,
+    1.306562965f,
+    1.175875602f,
+    1.0f,
+    0.785694958f,
+    0.541196100f,
+    0.275899379f,
+};
+
+struct huffman {
+    uint16_t code[256];
+    uint8_t size[256];
+};
+
+enum {
+    LUMINANCE = 0,
+    CHROMINANCE = 1,
+};
+
+struct al_jpeg {
+    uint8_t quant[2][64]; // zigzag order
+    float scale[2][64]; // natural order
+    struct huffman dc[2];
+    struct huffman ac[2];
+};
+
+struct writer {
+    uint8_t *restrict data;
+    size_t size;
+    size_t capacity;
+    uint32_t buffer;
+    int bits;
+    bool overflow;
+};
+
+static
+void
+build_huffman(struct huffman *h, const uint8_t bits[16], const uint8_t *values)
+{
+    uint16_t code = 0;
+    size_t k = 0;
+    for (size_t length = 1; length <= 16; length++) {
+        for (size_t i = 0; i < bits[length - 1]; i++) {
+            h->code[values[k]] = code;
+            h->size[values[k]] = (uint8_t) length;
+            code++;
+            k++;
+        }
+        code = (uint16_t) (code << 1);
+    }
+}
+
+static
+void
+build_quant(struct al_jpeg *jpeg, size_t table, const uint8_t *base, int quality)
+{
+    // IJG quality scaling
+    const int scale = quality < 50 ? 5000 / quality : 200 - 2 * quality;
+    for (size_t k = 0; k < 64; k++) {
+        const size_t n = zigzag[k];
+        int q = (base[n] * scale + 50) / 100;
+        if (q < 1)
+            q = 1;
+        if (q > 255)
+            q = 255;
+        jpeg->quant[table][k] = (uint8_t) q;
+        jpeg->scale[table][n] = 1.0f / (
+            (float) q * aan[n / 8] * aan[n % 8] * 8.0f
+        );
+    }
+}
+
+__attribute__((visibility("hidden")))
+struct al_jpeg *
+al_jpeg_new(int quality)
+{
+    if (quality < 1)
+        quality = 1;
+    if (quality > 100)
+        quality = 100;
+    struct al_jpeg *jpeg = calloc(1, sizeof (struct al_jpeg));
+    if (jpeg == NULL)
+        return NULL;
+    build_quant(jpeg, LUMINANCE, quant_luminance, quality);
+    build_quant(jpeg, CHROMINANCE, quant_chrominance, quality);
+    build_huffman(&jpeg->dc[LUMINANCE], dc_luminance_bits, dc_values);
+    build_huffman(&jpeg->dc[CHROMINANCE], dc_chrominance_bits, dc_values);
+    build_huffman(
+        &jpeg->ac[LUMINANCE],
+        ac_luminance_bits,
+        ac_luminance_values
+    );
+    build_huffman(
+        &jpeg->ac[CHROMINANCE],
+        ac_chrominance_bits,
+        ac_chrominance_values
+    );
+    return jpeg;
+}
+
+void
+__attribute__((visibility("hidden")))
+al_jpeg_free(struct al_jpeg *jpeg)
+{
+    free(jpeg);
+}
+
+/*
+ * An upper bound on the size of an encoded image: at most 64 coefficients
+ * of 26 bits each per block, doubled for byte stuffing, six blocks per
+ * 16x16 macroblock, plus the headers.
+ */
+size_t
+__attribute__((visibility("hidden")))
+al_jpeg_max_size(size_t width, size_t height)
+{
+    const size_t mcus = ((width + 15) / 16) * ((height + 15) / 16);
+    return mcus * 6 * (64 * 26 / 8) * 2 + 1024;
+}
+
+static inline
+void
+put_byte(struct writer *w, uint8_t x)
+{
+    if (w->size < w->capacity)
+        w->data[w->size++] = x;
+    else
+        w->overflow = true;
+}
+
+static inline
+void
+put_u16(struct writer *w, size_t x)
+{
+    put_byte(w, (uint8_t) ((x >> 8) & 0xff));
+    put_byte(w, (uint8_t) ((x >> 0) & 0xff));
+}
+
+static inline
+void
+put_bits(struct writer *w, uint32_t code, int size)
+{
+    assert(size >= 0 && size <= 16);
+    w->buffer = (w->buffer << size) | (code & ((1u << size) - 1));
+    w->bits += size;
+    while (w->bits >= 8) {
+        const uint8_t x = (uint8_t) (w->buffer >> (w->bits - 8));
+        put_byte(w, x);
+        if (x == 0xff)
+            put_byte(w, 0);
+        w->bits -= 8;
+    }
+}
+
+static inline
+void
+put_symbol(struct writer *w, const struct huffman *h, uint8_t symbol)
+{
+    put_bits(w, h->code[symbol], h->size[symbol]);
+}
+
+static inline
+int
+__attribute__((const))
+category(int32_t x)
+{
+    uint32_t y = (uint32_t) (x < 0 ? -x : x);
+    int n = 0;
+    while (y != 0) {
+        y >>= 1;
+        n++;
+    }
+    return n;
+}
+
+static inline
+void
+put_value(struct writer *w, int32_t x, int n)
+{
+    // negative values are sent as the one's complement of their magnitude
+    if (x < 0)
+        x -= 1;
+    put_bits(w, (uint32_t) x, n);
+}
+
+static inline
+void
+fdct(float *d, const size_t s)
+{
+    const float t0 = d[0 * s] + d[7 * s];
+    const float t7 = d[0 * s] - d[7 * s];
+    const float t1 = d[1 * s] + d[6 * s];
+    const float t6 = d[1 * s] - d[6 * s];
+    const float t2 = d[2 * s] + d[5 * s];
+    const float t5 = d[2 * s] - d[5 * s];
+    const float t3 = d[3 * s] + d[4 * s];
+    const float t4 = d[3 * s] - d[4 * s];
+
+    // even part
+    const float t10 = t0 + t3;
+    const float t13 = t0 - t3;
+    const float t11 = t1 + t2;
+    const float t12 = t1 - t2;
+    d[0 * s] = t10 + t11;
+    d[4 * s] = t10 - t11;
+    const float z1 = (t12 + t13) * 0.707106781f;
+    d[2 * s] = t13 + z1;
+    d[6 * s] = t13 - z1;
+
+    // odd part
+    const float u10 = t4 + t5;
+    const float u11 = t5 + t6;
+    const float u12 = t6 + t7;
+    const float z5 = (u10 - u12) * 0.382683433f;
+    const float z2 = 0.541196100f * u10 + z5;
+    const float z4 = 1.306562965f * u12 + z5;
+    const float z3 = u11 * 0.707106781f;
+    const float z11 = t7 + z3;
+    const float z13 = t7 - z3;
+    d[5 * s] = z13 + z2;
+    d[3 * s] = z13 - z2;
+    d[1 * s] = z11 + z4;
+    d[7 * s] = z11 - z4;
+}
+
+static inline
+void
+load_block(
+    float block[64],
+    const uint8_t *plane,
+    const size_t stride,
+    const size_t pixel_stride,
+    const size_t width,
+    const size_t height,
+    const size_t x0,
+    const size_t y0
+) {
+    for (size_t i = 0; i < 8; i++) {
+        const size_t y = (y0 + i < height) ? y0 + i : height - 1;
+        const uint8_t *row = plane + y * stride;
+        if (x0 + 8 <= width) {
+            for (size_t j = 0; j < 8; j++)
+                block[i * 8 + j] = (float) row[(x0 + j) * pixel_stride] - 128;
+        } else {
+            for (size_t j = 0; j < 8; j++) {
+                const size_t x = (x0 + j < width) ? x0 + j : width - 1;
+                block[i * 8 + j] = (float) row[x * pixel_stride] - 128;
+            }
+        }
+    }
+}
+
+static
+int32_t
+encode_block(
+    struct writer *w,
+    float block[64],
+    const float scale[64],
+    const int32_t dc,
+    const struct huffman *hdc,
+    const struct huffman *hac
+) {
+    for (size_t i = 0; i < 8; i++)
+        fdct(&block[i * 8], 1);
+    for (size_t j = 0; j < 8; j++)
+        fdct(&block[j], 8);
+
+    int32_t coefficients[64];
+    for (size_t k = 0; k < 64; k++) {
+        const size_t n = zigzag[k];
+        const float x = block[n] * scale[n];
+        coefficients[k] = (int32_t) (x < 0 ? x - 0.5f : x + 0.5f);
+    }
+
+    const int32_t diff = coefficients[0] - dc;
+    const int n = category(diff);
+    put_symbol(w, hdc, (uint8_t) n);
+    put_value(w, diff, n);
+
+    int run = 0;
+    for (size_t k = 1; k < 64; k++) {
+        const int32_t x = coefficients[k];
+        if (x == 0) {
+            run++;
+            continue;
+        }
+        while (run >= 16) {
+            put_symbol(w, hac, 0xf0); // ZRL
+            run -= 16;
+        }
+        const int m = category(x);
+        put_symbol(w, hac, (uint8_t) ((run << 4) | m));
+        put_value(w, x, m);
+        run = 0;
+    }
+    if (run > 0)
+        put_symbol(w, hac, 0x00); // EOB
+
+    return coefficients[0];
+}
+
+static
+void
+put_headers(struct writer *w, const struct al_jpeg *jpeg, size_t width, size_t height)
+{
+    // SOI
+    put_u16(w, 0xffd8);
+
+    // APP0 (JFIF 1.01, no density, no thumbnail)
+    static const uint8_t jfif[] = {'J', 'F', 'I', 'F', 0, 1, 1, 0, 0, 1, 0, 1, 0, 0};
+    put_u16(w, 0xffe0);
+    put_u16(w, 2 + sizeof jfif);
+    for (size_t i = 0; i < sizeof jfif; i++)
+        put_byte(w, jfif[i]);
+
+    // DQT
+    put_u16(w, 0xffdb);
+    put_u16(w, 2 + 2 * 65);
+    for (size_t t = 0; t < 2; t++) {
+        put_byte(w, (uint8_t) t);
+        for (size_t k = 0; k < 64; k++)
+            put_byte(w, jpeg->quant[t][k]);
+    }
+
+    // SOF0
+    put_u16(w, 0xffc0);
+    put_u16(w, 17);
+    put_byte(w, 8);
+    put_u16(w, height);
+    put_u16(w, width);
+    put_byte(w, 3);
+    put_byte(w, 1); put_byte(w, 0x22); put_byte(w, LUMINANCE);
+    put_byte(w, 2); put_byte(w, 0x11); put_byte(w, CHROMINANCE);
+    put_byte(w, 3); put_byte(w, 0x11); put_byte(w, CHROMINANCE);
+
+    // DHT
+    const struct {
+        uint8_t class;
+        const uint8_t *bits;
+        const uint8_t *values;
+        size_t n;
+    } tables[] = {
+        {0x00, dc_luminance_bits, dc_values, sizeof dc_values},
+        {0x10, ac_luminance_bits, ac_luminance_values, sizeof ac_luminance_values},
+        {0x01, dc_chrominance_bits, dc_values, sizeof dc_values},
+        {0x11, ac_chrominance_bits, ac_chrominance_values, sizeof ac_chrominance_values},
+    };
+    size_t length = 2;
+    for (size_t t = 0; t < sizeof tables / sizeof (tables[0]); t++)
+        length += 1 + 16 + tables[t].n;
+    put_u16(w, 0xffc4);
+    put_u16(w, length);
+    for (size_t t = 0; t < sizeof tables / sizeof (tables[0]); t++) {
+        put_byte(w, tables[t].class);
+        for (size_t i = 0; i < 16; i++)
+            put_byte(w, tables[t].bits[i]);
+        for (size_t i = 0; i < tables[t].n; i++)
+            put_byte(w, tables[t].values[i]);
+    }
+
+    // SOS
+    put_u16(w, 0xffda);
+    put_u16(w, 12);
+    put_byte(w, 3);
+    put_byte(w, 1); put_byte(w, 0x00);
+    put_byte(w, 2); put_byte(w, 0x11);
+    put_byte(w, 3); put_byte(w, 0x11);
+    put_byte(w, 0);
+    put_byte(w, 63);
+    put_byte(w, 0);
+}
+
+/*
+ * Encode a 4:2:0 image. The chroma planes are addressed with a pixel
+ * stride, so NV12 is encoded with u = uv, v = uv + 1 and a pixel stride
+ * of 2, and I420 with a pixel stride of 1.
+ *
+ * Returns the size of the encoded image, or zero if it does not fit in
+ * the output buffer.
+ */
+size_t
+__attribute__((visibility("hidden")))
+al_jpeg_encode_yuv420(
+    struct al_jpeg *jpeg,
+    const uint8_t *y_data,
+    const uint8_t *u_data,
+    const uint8_t *v_data,
+    const size_t width,
+    const size_t height,
+    const size_t y_stride,
+    const size_t uv_stride,
+    const size_t uv_pixel_stride,
+    uint8_t *restrict output,
+    const size_t capacity
+) {
+    assert(jpeg != NULL);
+    assert(y_data != NULL);
+    assert(u_data != NULL);
+    assert(v_data != NULL);
+    assert(output != NULL);
+    if (width == 0 || height == 0 || width > 0xffff || height > 0xffff)
+        return 0;
+
+    struct writer w = {
+        .data = output,
+        .size = 0,
+        .capacity = capacity,
+        .buffer = 0,
+        .bits = 0,
+        .overflow = false,
+    };
+    put_headers(&w, jpeg, width, height);
+
+    const size_t chroma_width = (width + 1) / 2;
+    const size_t chroma_height = (height + 1) / 2;
+    int32_t dc[3] = {0, 0, 0};
+    float block[64];
+    for (size_t my = 0; my < height && !w.overflow; my += 16) {
+        for (size_t mx = 0; mx < width; mx += 16) {
+            for (size_t b = 0; b < 4; b++) {
+                load_block(
+                    block,
+                    y_data, y_stride, 1,
+                    width, height,
+                    mx + (b % 2) * 8, my + (b / 2) * 8
+                );
+                dc[0] = encode_block(
+                    &w,
+                    block,
+                    jpeg->scale[LUMINANCE],
+                    dc[0],
+                    &jpeg->dc[LUMINANCE],
+                    &jpeg->ac[LUMINANCE]
+                );
+            }
+            load_block(
+                block,
+                u_data, uv_stride, uv_pixel_stride,
+                chroma_width, chroma_height,
+                mx / 2, my / 2
+            );
+            dc[1] = encode_block(
+                &w,
+                block,
+                jpeg->scale[CHROMINANCE],
+                dc[1],
+                &jpeg->dc[CHROMINANCE],
+                &jpeg->ac[CHROMINANCE]
+            );
+            load_block(
+                block,
+                v_data, uv_stride, uv_pixel_stride,
+                chroma_width, chroma_height,
+                mx / 2, my / 2
+            );
+            dc[2] = encode_block(
+                &w,
+                block,
+                jpeg->scale[CHROMINANCE],
+                dc[2],
+                &jpeg->dc[CHROMINANCE],
+                &jpeg->ac[CHROMINANCE]
+            );
+        }
+    }
+
+    // pad the last byte with ones
+    put_bits(&w, 0x7f, 7);
+    // EOI
+    put_u16(&w, 0xffd9);
+
+    if (w.overflow)
+        return 0;
+    return w.size;
+}
+
+#if defined(TEST)
+
+#include <stdint.h> // uint8_t
+#include <stdlib.h> // calloc
+
+int
+main(void)
+{
+    const size_t width = 37;
+    const size_t height = 21;
+    uint8_t *nv12 = calloc(width * height + 2 * ((width + 1) / 2) * ((height + 1) / 2), 1);
+    assert(nv12 != NULL);
+    for (size_t i = 0; i < height; i++)
+        for (size_t j = 0; j < width; j++)
+            nv12[i * width + j] = (uint8_t) (i * 8 + j * 4);
+    uint8_t *uv = nv12 + width * height;
+    for (size_t i = 0; i < (height + 1) / 2; i++) {
+        for (size_t j = 0; j < (width + 1) / 2; j++) {
+            uv[i * 2 * ((width + 1) / 2) + 2 * j + 0] = (uint8_t) (64 + i * 4);
+            uv[i * 2 * ((width + 1) / 2) + 2 * j + 1] = (uint8_t) (192 - j * 4);
+        }
+    }
+
+    struct al_jpeg *jpeg = al_jpeg_new(75);
+    assert(jpeg != NULL);
+    const size_t capacity = al_jpeg_max_size(width, height);
+    uint8_t *output = calloc(capacity, 1);
+    assert(output != NULL);
+    size_t size = al_jpeg_encode_yuv420(
+        jpeg,
+        nv12,
+        uv,
+        uv + 1,
+        width,
+        height,
+        width,
+        2 * ((width + 1) / 2),
+        2,
+        output,
+        capacity
+    );
+    assert(size > 4);
+    assert(output[0] == 0xff && output[1] == 0xd8);
+    assert(output[size - 2] == 0xff && output[size - 1] == 0xd9);
+
+    // a short output buffer is reported as zero
+    assert(al_jpeg_encode_yuv420(
+        jpeg, nv12, uv, uv + 1, width, height, width,
+        2 * ((width + 1) / 2), 2, output, size / 2
+    ) == 0);
+
+    al_jpeg_free(jpeg);
+    free(output);
+    free(nv12);
+
+    return 0;
+}
+
+#endif
@@ -0,0 +1,27 @@
+/* Copyright 2023-2025, Mansour Moufid <mansourmoufid@gmail.com> */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+struct al_jpeg;
+
+struct al_jpeg *al_jpeg_new(int);
+void al_jpeg_free(struct al_jpeg *);
+
+size_t al_jpeg_max_size(size_t, size_t);
+
+size_t al_jpeg_encode_yuv420(
+    struct al_jpeg *,
+    const uint8_t *,
+    const uint8_t *,
+    const uint8_t *,
+    const size_t,
+    const size_t,
+    const size_t,
+    const size_t,
+    const size_t,
+    uint8_t *restrict,
+    const size_t
+);
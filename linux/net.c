@@ -0,0 +1,195 @@
+/* Copyright 2023-2025, Mansour Moufid <mansourmoufid@gmail.com> */
+
+/*
+ * This file is part of Aluminium Library.
+ *
+ * Aluminium Library is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Aluminium Library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with Aluminium Library. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <arpa/inet.h> // inet_ntop
+#include <ifaddrs.h> // getifaddrs
+#include <linux/netlink.h> // struct sockaddr_nl
+#include <linux/rtnetlink.h> // RTMGRP_*
+#include <netinet/in.h> // in_addr_t, struct sockaddr_in, INET_ADDRSTRLEN
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/socket.h> // struct sockaddr
+#include <sys/types.h>
+#include <unistd.h> // close
+
+#include "al.h"
+
+#include "common.h"
+
+/*
+ * The result of the last lookup is cached together with the generation
+ * it was computed in. A background thread listens for address and link
+ * changes on a NETLINK_ROUTE socket and bumps the generation, which
+ * invalidates the cache. If the listener could not be started, every
+ * call does a fresh lookup.
+ */
+
+static pthread_once_t _al_net_once = PTHREAD_ONCE_INIT;
+static atomic_bool _al_net_listening = false;
+static atomic_uint _al_net_generation = 1;
+// generation << 32 | address, or 0
+static atomic_uint_least64_t _al_net_cache = 0;
+
+static inline
+bool
+private_ip(in_addr_t addr)
+{
+    // in_addr_t addr = inet_addr(ip);
+    int a = (addr >> 0) & 0xff;
+    int b = (addr >> 8) & 0xff;
+    // RFC 1918
+    return (a == 10)
+        || (a == 172 && (b >= 16 && b <= 31))
+        || (a == 192 && b == 168);
+}
+
+static
+void *
+_al_net_listen(void *arg)
+{
+    int fd = (int) (intptr_t) arg;
+    char buffer[4096];
+    while (true) {
+        ssize_t n = recv(fd, buffer, sizeof(buffer), 0);
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            // ENOBUFS: we missed some messages
+            if (errno != ENOBUFS) {
+                DEBUG_ERRNO("recv");
+                break;
+            }
+        }
+        atomic_fetch_add_explicit(
+            &_al_net_generation,
+            1,
+            memory_order_release
+        );
+    }
+    atomic_store(&_al_net_listening, false);
+    close(fd);
+    return NULL;
+}
+
+static
+void
+_al_net_start(void)
+{
+    int fd = socket(AF_NETLINK, SOCK_RAW | SOCK_CLOEXEC, NETLINK_ROUTE);
+    if (fd < 0) {
+        DEBUG_ERRNO("socket");
+        return;
+    }
+    struct sockaddr_nl addr = {
+        .nl_family = AF_NETLINK,
+        .nl_groups = RTMGRP_LINK | RTMGRP_IPV4_IFADDR,
+    };
+    if (bind(fd, (void *) &addr, sizeof(addr)) != 0) {
+        DEBUG_ERRNO("bind");
+        goto error;
+    }
+    // Subscribed: from here on, no change can go unnoticed.
+    atomic_store(&_al_net_listening, true);
+    pthread_attr_t attr;
+    if (pthread_attr_init(&attr) != 0)
+        goto error;
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+    pthread_t thread;
+    int err = pthread_create(
+        &thread,
+        &attr,
+        _al_net_listen,
+        (void *) (intptr_t) fd
+    );
+    pthread_attr_destroy(&attr);
+    if (err != 0) {
+        DEBUG("pthread_create: %s", strerror(err));
+        atomic_store(&_al_net_listening, false);
+        goto error;
+    }
+    return;
+error:
+    close(fd);
+}
+
+static
+in_addr_t
+_al_net_lookup(void)
+{
+    in_addr_t ip = 0;
+    struct ifaddrs *addresses = NULL;
+    if (getifaddrs(&addresses) != 0)
+        return 0;
+    struct ifaddrs *address = addresses;
+    while (address != NULL) {
+        struct sockaddr *addr = address->ifa_addr;
+        if (addr != NULL && addr->sa_family == AF_INET) {
+            struct sockaddr_in *in = (void *) addr;
+            if (private_ip(in->sin_addr.s_addr)) {
+                ip = in->sin_addr.s_addr;
+                break;
+            }
+        }
+        address = address->ifa_next;
+    }
+    if (addresses != NULL)
+        freeifaddrs(addresses);
+    return ip;
+}
+
+char *
+al_net_get_local_ip_address(void)
+{
+    pthread_once(&_al_net_once, _al_net_start);
+
+    in_addr_t ip;
+    uint_least64_t generation = atomic_load_explicit(
+        &_al_net_generation,
+        memory_order_acquire
+    );
+    uint_least64_t cache = atomic_load_explicit(
+        &_al_net_cache,
+        memory_order_relaxed
+    );
+    if (atomic_load_explicit(&_al_net_listening, memory_order_relaxed)
+        && (cache >> 32) == (generation & 0xffffffff)) {
+        ip = (in_addr_t) (cache & 0xffffffff);
+    } else {
+        ip = _al_net_lookup();
+        // A change during the lookup bumps the generation, so a stale
+        // result is never served twice.
+        atomic_store_explicit(
+            &_al_net_cache,
+            ((generation & 0xffffffff) << 32) | ip,
+            memory_order_relaxed
+        );
+    }
+    if (ip == 0)
+        return NULL;
+
+    char buffer[INET_ADDRSTRLEN];
+    struct in_addr in = {.s_addr = ip};
+    if (inet_ntop(AF_INET, &in, buffer, sizeof(buffer)) == NULL)
+        return NULL;
+    return strdup(buffer);
+}
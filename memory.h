@@ -0,0 +1,104 @@
+/* Copyright 2023-2025, Mansour Moufid <mansourmoufid@gmail.com> */
+
+/*
+ * This file is part of Aluminium Library.
+ *
+ * Aluminium Library is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Aluminium Library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with Aluminium Library. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <stdatomic.h>
+#include <stdint.h>
+
+#include "al.h"
+
+/*
+ * Accounting of the image buffers allocated by libal (see
+ * al_memory_get_stats and al_camera_get_memory).
+ *
+ * Every buffer is counted in the total, and also in the accounts of its
+ * owner, if any, such as the camera that keeps it. The counters are
+ * updated with relaxed atomics on allocation and release only, never
+ * per frame.
+ */
+struct al_memory {
+    atomic_uint_least64_t bytes;
+    atomic_uint_least64_t buffers;
+    atomic_uint_least64_t peak_bytes;
+    atomic_uint_least64_t allocations;
+};
+
+static inline
+void
+al_memory_add(struct al_memory *memory, uint64_t size)
+{
+    atomic_fetch_add_explicit(&memory->buffers, 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&memory->allocations, 1, memory_order_relaxed);
+    const uint64_t bytes = size + atomic_fetch_add_explicit(
+        &memory->bytes,
+        size,
+        memory_order_relaxed
+    );
+    uint_least64_t peak = atomic_load_explicit(
+        &memory->peak_bytes,
+        memory_order_relaxed
+    );
+    while (bytes > peak) {
+        if (atomic_compare_exchange_weak_explicit(
+            &memory->peak_bytes,
+            &peak,
+            bytes,
+            memory_order_relaxed,
+            memory_order_relaxed
+        ))
+            break;
+    }
+}
+
+static inline
+void
+al_memory_sub(struct al_memory *memory, uint64_t size)
+{
+    atomic_fetch_sub_explicit(&memory->buffers, 1, memory_order_relaxed);
+    atomic_fetch_sub_explicit(&memory->bytes, size, memory_order_relaxed);
+}
+
+// Take a snapshot of the counters; they may be updated in between.
+static inline
+void
+al_memory_get(struct al_memory *memory, struct al_memory_stats *x)
+{
+    *x = (struct al_memory_stats) {
+        .bytes = atomic_load_explicit(&memory->bytes, memory_order_relaxed),
+        .buffers = atomic_load_explicit(&memory->buffers, memory_order_relaxed),
+        .peak_bytes = atomic_load_explicit(
+            &memory->peak_bytes,
+            memory_order_relaxed
+        ),
+        .allocations = atomic_load_explicit(
+            &memory->allocations,
+            memory_order_relaxed
+        ),
+    };
+}
+
+/*
+ * Like al_image_alloc, but also count the buffer in the accounts of owner
+ * (or only in the total if NULL), until it is freed by al_image_free.
+ */
+enum al_status al_memory_image_alloc(struct al_memory *, struct al_image *);
+
+// The huge page mode of the image buffers, from AL_HUGEPAGES (see image.c).
+const char *al_memory_huge_pages(void);
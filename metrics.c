@@ -0,0 +1,652 @@
+/* Copyright 2023-2025, Mansour Moufid <mansourmoufid@gmail.com> */
+
+/*
+ * This file is part of Aluminium Library.
+ *
+ * Aluminium Library is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Aluminium Library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with Aluminium Library. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*
+ * A metrics exporter, in the Prometheus text exposition format.
+ *
+ * al_metrics_new starts a thread that serves GET /metrics over HTTP, on
+ * localhost by default. Every scrape takes a snapshot of the memory
+ * accounting and of the statistics, latency histogram and memory of each
+ * camera added with al_metrics_add_camera, through the same functions as
+ * the application would call. The cameras only update their counters, so
+ * the exporter never holds up the capture path; the lock below is only
+ * taken to add or remove a camera and to scrape.
+ *
+ * A camera must be removed before it is freed.
+ */
+
+#if defined(DEBUG)
+#undef NDEBUG
+#endif
+
+#include <arpa/inet.h> // htonl, htons, inet_pton
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h> // fcntl, FD_CLOEXEC
+#include <netinet/in.h> // struct sockaddr_in, INADDR_LOOPBACK
+#include <poll.h>
+#include <pthread.h>
+#include <stdarg.h> // va_list
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h> // vsnprintf
+#include <stdlib.h> // calloc, free, realloc
+#include <string.h> // memcpy, strerror, strncmp, strstr
+#include <sys/socket.h>
+#include <sys/time.h> // struct timeval
+#include <sys/types.h>
+#include <unistd.h> // close, pipe, read, write
+
+#include "al.h"
+#include "common.h" // DEBUG
+
+#if !defined(MSG_NOSIGNAL)
+#define MSG_NOSIGNAL 0
+#endif
+
+#define N_CAMERAS 64
+#define N_BUCKETS 12
+#define NAME_SIZE 64
+#define REQUEST_SIZE 4096
+#define TIMEOUT_MS 1000
+
+// The upper bounds of the latency buckets, in nanoseconds.
+static const uint64_t buckets[N_BUCKETS] = {
+    1000000,
+    2000000,
+    5000000,
+    10000000,
+    20000000,
+    50000000,
+    100000000,
+    200000000,
+    500000000,
+    1000000000,
+    2000000000,
+    5000000000,
+};
+
+struct camera {
+    struct al_camera *cam;
+    char name[NAME_SIZE];
+};
+
+struct snapshot {
+    char name[NAME_SIZE];
+    struct al_camera_stats stats;
+    struct al_memory_stats memory;
+    uint64_t latency[N_BUCKETS];
+};
+
+struct buffer {
+    char *data;
+    size_t size;
+    size_t capacity;
+    bool overflow;
+};
+
+struct al_metrics {
+    int listener;
+    int port;
+    int wake[2]; // a pipe to stop the thread
+    pthread_t thread;
+    pthread_mutex_t lock;
+    struct camera cameras[N_CAMERAS];
+    struct snapshot snapshots[N_CAMERAS];
+    struct buffer buffer;
+};
+
+static
+void
+put(struct buffer *buffer, const char *format, ...)
+{
+    if (buffer->overflow)
+        return;
+    for (;;) {
+        va_list args;
+        va_start(args, format);
+        const size_t available = buffer->capacity - buffer->size;
+        const int n = vsnprintf(
+            buffer->data + buffer->size,
+            available,
+            format,
+            args
+        );
+        va_end(args);
+        if (n < 0) {
+            buffer->overflow = true;
+            return;
+        }
+        if ((size_t) n < available) {
+            buffer->size += (size_t) n;
+            return;
+        }
+        const size_t capacity = 2 * buffer->capacity + (size_t) n + 1;
+        char *data = realloc(buffer->data, capacity);
+        if (data == NULL) {
+            DEBUG("realloc: errno=%i [%s]", errno, strerror(errno));
+            buffer->overflow = true;
+            return;
+        }
+        buffer->data = data;
+        buffer->capacity = capacity;
+    }
+}
+
+static
+void
+put_family(struct buffer *buffer, const char *name, const char *type, const char *help)
+{
+    put(buffer, "# HELP %s %s\n# TYPE %s %s\n", name, help, name, type);
+}
+
+static
+void
+put_seconds(struct buffer *buffer, uint64_t ns)
+{
+    put(buffer, "%llu.%09llu",
+        (unsigned long long) (ns / 1000000000),
+        (unsigned long long) (ns % 1000000000));
+}
+
+// Copy a camera name into a label value, escaped.
+static
+void
+copy_name(char *dst, const char *src)
+{
+    size_t j = 0;
+    for (size_t i = 0; src[i] != '\0' && j + 2 < NAME_SIZE; i++) {
+        switch (src[i]) {
+            case '\\':
+            case '"':
+                dst[j++] = '\\';
+                dst[j++] = src[i];
+                break;
+            case '\n':
+                dst[j++] = '\\';
+                dst[j++] = 'n';
+                break;
+            default:
+                dst[j++] = src[i];
+                break;
+        }
+    }
+    dst[j] = '\0';
+}
+
+static
+size_t
+take_snapshots(struct al_metrics *metrics)
+{
+    size_t n = 0;
+    for (size_t i = 0; i < N_CAMERAS; i++) {
+        struct camera *camera = &metrics->cameras[i];
+        if (camera->cam == NULL)
+            continue;
+        struct snapshot *x = &metrics->snapshots[n];
+        memcpy(x->name, camera->name, NAME_SIZE);
+        if (al_camera_get_stats(camera->cam, &x->stats) != AL_OK)
+            continue;
+        if (al_camera_get_memory(camera->cam, &x->memory) != AL_OK)
+            continue;
+        if (al_camera_get_latency_histogram(
+            camera->cam,
+            buckets,
+            x->latency,
+            N_BUCKETS
+        ) != AL_OK)
+            continue;
+        n++;
+    }
+    return n;
+}
+
+static
+void
+render(struct al_metrics *metrics)
+{
+    struct buffer *buffer = &metrics->buffer;
+    buffer->size = 0;
+    buffer->overflow = false;
+
+    struct al_memory_stats memory;
+    (void) al_memory_get_stats(&memory);
+    put_family(buffer, "al_memory_bytes", "gauge",
+        "Bytes in image buffers allocated by libal.");
+    put(buffer, "al_memory_bytes %llu\n", (unsigned long long) memory.bytes);
+    put_family(buffer, "al_memory_buffers", "gauge",
+        "Image buffers allocated by libal.");
+    put(buffer, "al_memory_buffers %llu\n", (unsigned long long) memory.buffers);
+    put_family(buffer, "al_memory_peak_bytes", "gauge",
+        "The most bytes in image buffers at any time.");
+    put(buffer, "al_memory_peak_bytes %llu\n",
+        (unsigned long long) memory.peak_bytes);
+    put_family(buffer, "al_memory_allocations_total", "counter",
+        "Image buffers allocated.");
+    put(buffer, "al_memory_allocations_total %llu\n",
+        (unsigned long long) memory.allocations);
+
+    pthread_mutex_lock(&metrics->lock);
+    const struct snapshot *x = metrics->snapshots;
+    const size_t n = take_snapshots(metrics);
+    pthread_mutex_unlock(&metrics->lock);
+
+    static const struct {
+        const char *name;
+        const char *type;
+        const char *help;
+        size_t offset;
+    } counters[] = {
+#define COUNTER(name, type, help, field) \
+        {name, type, help, offsetof(struct snapshot, field)}
+        COUNTER("al_camera_frames_total", "counter",
+            "Frames made available by the camera.", stats.frames),
+        COUNTER("al_camera_delivered_frames_total", "counter",
+            "Frames read by the application.", stats.delivered),
+        COUNTER("al_camera_dropped_frames_total", "counter",
+            "Frames lost before they could be made available.", stats.dropped),
+        COUNTER("al_camera_unread_frames_total", "counter",
+            "Frames replaced by the next before being read.", stats.unread),
+        COUNTER("al_camera_copied_bytes_total", "counter",
+            "Bytes copied by the frame pipeline.", stats.bytes_copied),
+        COUNTER("al_camera_memory_bytes", "gauge",
+            "Bytes in the image buffers of the camera.", memory.bytes),
+        COUNTER("al_camera_memory_buffers", "gauge",
+            "Image buffers of the camera.", memory.buffers),
+        COUNTER("al_camera_memory_peak_bytes", "gauge",
+            "The most bytes in the image buffers of the camera.",
+            memory.peak_bytes),
+#undef COUNTER
+    };
+    for (size_t k = 0; k < sizeof (counters) / sizeof (counters[0]); k++) {
+        put_family(buffer, counters[k].name, counters[k].type, counters[k].help);
+        for (size_t i = 0; i < n; i++) {
+            uint64_t value;
+            memcpy(
+                &value,
+                (const uint8_t *) &x[i] + counters[k].offset,
+                sizeof value
+            );
+            put(buffer, "%s{camera=\"%s\"} %llu\n",
+                counters[k].name,
+                x[i].name,
+                (unsigned long long) value);
+        }
+    }
+
+    static const char *stages[] = {"process", "repack", "convert"};
+    put_family(buffer, "al_camera_stage_seconds_total", "counter",
+        "Time spent in each stage of the frame pipeline.");
+    for (size_t i = 0; i < n; i++) {
+        const uint64_t ns[] = {
+            x[i].stats.process_ns,
+            x[i].stats.repack_ns,
+            x[i].stats.convert_ns,
+        };
+        for (size_t j = 0; j < 3; j++) {
+            put(buffer, "al_camera_stage_seconds_total"
+                "{camera=\"%s\",stage=\"%s\"} ", x[i].name, stages[j]);
+            put_seconds(buffer, ns[j]);
+            put(buffer, "\n");
+        }
+    }
+    put_family(buffer, "al_camera_stage_max_seconds", "gauge",
+        "The longest time spent in each stage for one frame.");
+    for (size_t i = 0; i < n; i++) {
+        const uint64_t ns[] = {
+            x[i].stats.process_max_ns,
+            x[i].stats.repack_max_ns,
+            x[i].stats.convert_max_ns,
+        };
+        for (size_t j = 0; j < 3; j++) {
+            put(buffer, "al_camera_stage_max_seconds"
+                "{camera=\"%s\",stage=\"%s\"} ", x[i].name, stages[j]);
+            put_seconds(buffer, ns[j]);
+            put(buffer, "\n");
+        }
+    }
+
+    put_family(buffer, "al_camera_latency_seconds", "histogram",
+        "Latency from capture to delivery of the frames read.");
+    for (size_t i = 0; i < n; i++) {
+        for (size_t j = 0; j < N_BUCKETS; j++) {
+            put(buffer, "al_camera_latency_seconds_bucket"
+                "{camera=\"%s\",le=\"%g\"} %llu\n",
+                x[i].name,
+                (double) buckets[j] / 1e9,
+                (unsigned long long) x[i].latency[j]);
+        }
+        // The histogram and the count are read apart, so keep +Inf last.
+        uint64_t count = x[i].stats.delivered;
+        if (count < x[i].latency[N_BUCKETS - 1])
+            count = x[i].latency[N_BUCKETS - 1];
+        put(buffer, "al_camera_latency_seconds_bucket"
+            "{camera=\"%s\",le=\"+Inf\"} %llu\n",
+            x[i].name,
+            (unsigned long long) count);
+        put(buffer, "al_camera_latency_seconds_sum{camera=\"%s\"} ", x[i].name);
+        put_seconds(buffer, x[i].stats.latency_ns);
+        put(buffer, "\n");
+        put(buffer, "al_camera_latency_seconds_count{camera=\"%s\"} %llu\n",
+            x[i].name,
+            (unsigned long long) count);
+    }
+}
+
+static
+void
+send_all(int fd, const char *data, size_t size)
+{
+    while (size > 0) {
+        ssize_t n = send(fd, data, size, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return;
+        data += n;
+        size -= (size_t) n;
+    }
+}
+
+static
+void
+respond(int fd, const char *status, const char *type, const char *body, size_t size)
+{
+    char header[256];
+    int n = snprintf(
+        header,
+        sizeof header,
+        "HTTP/1.0 %s\r\n"
+        "Content-Type: %s\r\n"
+        "Content-Length: %zu\r\n"
+        "Connection: close\r\n"
+        "\r\n",
+        status,
+        type,
+        size
+    );
+    assert(n > 0 && (size_t) n < sizeof header);
+    send_all(fd, header, (size_t) n);
+    send_all(fd, body, size);
+}
+
+// Serve one request, with timeouts so a stuck client cannot hold us up.
+static
+void
+serve(struct al_metrics *metrics, int fd)
+{
+    struct timeval timeout = {
+        .tv_sec = TIMEOUT_MS / 1000,
+        .tv_usec = (TIMEOUT_MS % 1000) * 1000,
+    };
+    (void) setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof timeout);
+    (void) setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof timeout);
+#if defined(SO_NOSIGPIPE)
+    int yes = 1;
+    (void) setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &yes, sizeof yes);
+#endif
+
+    char request[REQUEST_SIZE];
+    size_t size = 0;
+    while (size < sizeof request - 1) {
+        ssize_t n = recv(fd, request + size, sizeof request - 1 - size, 0);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            break;
+        size += (size_t) n;
+        request[size] = '\0';
+        if (strstr(request, "\r\n\r\n") != NULL || strstr(request, "\n\n") != NULL)
+            break;
+    }
+    request[size] = '\0';
+
+    static const char text[] = "text/plain; charset=utf-8";
+    static const char get[] = "GET ";
+    if (strncmp(request, get, strlen(get)) != 0) {
+        respond(fd, "405 Method Not Allowed", text, "", 0);
+        return;
+    }
+    const char *path = request + strlen(get);
+    const size_t length = strcspn(path, " ?\r\n");
+    if (!(
+        (length == 1 && path[0] == '/')
+        || (length == 8 && strncmp(path, "/metrics", 8) == 0)
+    )) {
+        respond(fd, "404 Not Found", text, "", 0);
+        return;
+    }
+    render(metrics);
+    if (metrics->buffer.overflow) {
+        respond(fd, "500 Internal Server Error", text, "", 0);
+        return;
+    }
+    respond(
+        fd,
+        "200 OK",
+        "text/plain; version=0.0.4; charset=utf-8",
+        metrics->buffer.data,
+        metrics->buffer.size
+    );
+}
+
+static
+void *
+run(void *arg)
+{
+    struct al_metrics *metrics = arg;
+    for (;;) {
+        struct pollfd fds[2] = {
+            {.fd = metrics->listener, .events = POLLIN},
+            {.fd = metrics->wake[0], .events = POLLIN},
+        };
+        int n = poll(fds, 2, -1);
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            DEBUG("poll: errno=%i [%s]", errno, strerror(errno));
+            break;
+        }
+        if (fds[1].revents != 0)
+            break;
+        if (fds[0].revents & POLLIN) {
+            int fd = accept(metrics->listener, NULL, NULL);
+            if (fd < 0) {
+                if (errno != EINTR && errno != EAGAIN && errno != EWOULDBLOCK) {
+                    DEBUG("accept: errno=%i [%s]", errno, strerror(errno));
+                }
+                continue;
+            }
+            serve(metrics, fd);
+            close(fd);
+        }
+    }
+    return NULL;
+}
+
+/*
+ * Start serving metrics on the given address (localhost if NULL) and port
+ * (any free one if 0, see al_metrics_get_port).
+ */
+enum al_status
+al_metrics_new(struct al_metrics **metrics, const char *address, int port)
+{
+    assert(metrics != NULL);
+    enum al_status ret = AL_ERROR;
+
+    if (port < 0 || port > 0xffff)
+        return AL_ERROR;
+
+    struct sockaddr_in addr = {
+        .sin_family = AF_INET,
+        .sin_port = htons((uint16_t) port),
+        .sin_addr.s_addr = htonl(INADDR_LOOPBACK),
+    };
+    if (address != NULL) {
+        if (inet_pton(AF_INET, address, &addr.sin_addr) != 1)
+            return AL_ERROR;
+    }
+
+    errno = 0;
+    *metrics = calloc(1, sizeof (struct al_metrics));
+    if (*metrics == NULL) {
+        DEBUG("calloc: errno=%i [%s]", errno, strerror(errno));
+        ret = AL_NOMEMORY;
+        goto error0;
+    }
+
+    (*metrics)->listener = socket(AF_INET, SOCK_STREAM, 0);
+    if ((*metrics)->listener < 0) {
+        DEBUG("socket: errno=%i [%s]", errno, strerror(errno));
+        goto error1;
+    }
+    (void) fcntl((*metrics)->listener, F_SETFD, FD_CLOEXEC);
+    int yes = 1;
+    (void) setsockopt(
+        (*metrics)->listener,
+        SOL_SOCKET,
+        SO_REUSEADDR,
+        &yes,
+        sizeof yes
+    );
+    if (bind((*metrics)->listener, (struct sockaddr *) &addr, sizeof addr) < 0) {
+        DEBUG("bind: errno=%i [%s]", errno, strerror(errno));
+        goto error2;
+    }
+    if (listen((*metrics)->listener, 16) < 0) {
+        DEBUG("listen: errno=%i [%s]", errno, strerror(errno));
+        goto error2;
+    }
+    socklen_t length = sizeof addr;
+    if (getsockname((*metrics)->listener, (struct sockaddr *) &addr, &length) < 0) {
+        DEBUG("getsockname: errno=%i [%s]", errno, strerror(errno));
+        goto error2;
+    }
+    (*metrics)->port = ntohs(addr.sin_port);
+
+    if (pipe((*metrics)->wake) < 0) {
+        DEBUG("pipe: errno=%i [%s]", errno, strerror(errno));
+        goto error2;
+    }
+    int err = pthread_mutex_init(&(*metrics)->lock, NULL);
+    if (err != 0) {
+        DEBUG("pthread_mutex_init: %s", strerror(err));
+        goto error3;
+    }
+    err = pthread_create(&(*metrics)->thread, NULL, run, *metrics);
+    if (err != 0) {
+        DEBUG("pthread_create: %s", strerror(err));
+        goto error4;
+    }
+
+    ret = AL_OK;
+    return ret;
+
+error4:
+    pthread_mutex_destroy(&(*metrics)->lock);
+error3:
+    close((*metrics)->wake[0]);
+    close((*metrics)->wake[1]);
+error2:
+    close((*metrics)->listener);
+error1:
+    free(*metrics);
+    *metrics = NULL;
+error0:
+    return ret;
+}
+
+void
+al_metrics_free(struct al_metrics *metrics)
+{
+    if (metrics == NULL)
+        return;
+    const char stop = 0;
+    while (write(metrics->wake[1], &stop, 1) < 0 && errno == EINTR)
+        continue;
+    pthread_join(metrics->thread, NULL);
+    pthread_mutex_destroy(&metrics->lock);
+    close(metrics->wake[0]);
+    close(metrics->wake[1]);
+    close(metrics->listener);
+    free(metrics->buffer.data);
+    free(metrics);
+}
+
+enum al_status
+al_metrics_get_port(struct al_metrics *metrics, int *port)
+{
+    assert(metrics != NULL);
+    assert(port != NULL);
+    *port = metrics->port;
+    return AL_OK;
+}
+
+/*
+ * Export the statistics of a camera, labelled with the given name (or a
+ * number if NULL), until it is removed.
+ */
+enum al_status
+al_metrics_add_camera(struct al_metrics *metrics, struct al_camera *cam, const char *name)
+{
+    assert(metrics != NULL);
+    assert(cam != NULL);
+    enum al_status status = AL_ERROR;
+    pthread_mutex_lock(&metrics->lock);
+    size_t k = N_CAMERAS;
+    for (size_t i = 0; i < N_CAMERAS; i++) {
+        if (metrics->cameras[i].cam == cam)
+            goto done;
+        if (k == N_CAMERAS && metrics->cameras[i].cam == NULL)
+            k = i;
+    }
+    if (k == N_CAMERAS)
+        goto done;
+    char number[24];
+    if (name == NULL) {
+        snprintf(number, sizeof number, "%zu", k);
+        name = number;
+    }
+    struct camera *camera = &metrics->cameras[k];
+    camera->cam = cam;
+    copy_name(camera->name, name);
+    status = AL_OK;
+done:
+    pthread_mutex_unlock(&metrics->lock);
+    return status;
+}
+
+enum al_status
+al_metrics_remove_camera(struct al_metrics *metrics, struct al_camera *cam)
+{
+    assert(metrics != NULL);
+    assert(cam != NULL);
+    enum al_status status = AL_ERROR;
+    pthread_mutex_lock(&metrics->lock);
+    for (size_t i = 0; i < N_CAMERAS; i++) {
+        if (metrics->cameras[i].cam == cam) {
+            metrics->cameras[i] = (struct camera) {0};
+            status = AL_OK;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&metrics->lock);
+    return status;
+}
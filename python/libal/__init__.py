@@ -28,11 +28,17 @@ __status__ = 'Alpha'
 __all__ = [
     'AlException',
     'ColorFormat',
+    'Frame',
     'platform',
     'tobytes',
     'tobytearray',
+    'trace_flush',
+    'memory_stats',
     'net',
     'camera',
+    'image',
+    'stream',
+    'metrics',
 ]
 
 
@@ -41,6 +47,7 @@ import enum
 import os
 import sys
 import sysconfig
+import typing
 # import traceback
 
 if sys.platform == 'darwin':
@@ -67,11 +74,19 @@ if libal is None:
         libal = ctypes.cdll.LoadLibrary(str(lib_path))
 
 
+# Optional native fast path, see _libal.c.
+try:
+    from . import _libal
+except ImportError:
+    _libal = None
+
+
 class Status(enum.IntEnum):
     OK = 0
     ERROR = 1
     NOTIMPLEMENTED = 2
     NOMEMORY = 3
+    TIMEOUT = 4
 
 
 class AlException(Exception):
@@ -85,9 +100,46 @@ class ColorFormat(enum.IntEnum):
     RGBA = 3
 
 
+# struct al_image;
+class _AlImage(ctypes.Structure):
+    _fields_ = [
+        ('width', ctypes.c_size_t),
+        ('height', ctypes.c_size_t),
+        ('stride', ctypes.c_size_t),
+        ('data', ctypes.c_void_p),
+        ('format', ctypes.c_int),
+    ]
+
+
 platform = ctypes.c_char_p.in_dll(libal, 'platform').value.decode('utf-8')
 
 
+# enum al_status al_trace_flush(const char *);
+_al_trace_flush = libal.al_trace_flush
+_al_trace_flush.restype = ctypes.c_int
+_al_trace_flush.argtypes = [
+    ctypes.c_char_p,
+]
+
+
+# struct al_memory_stats;
+class _AlMemoryStats(ctypes.Structure):
+    _fields_ = [
+        ('bytes', ctypes.c_uint64),
+        ('buffers', ctypes.c_uint64),
+        ('peak_bytes', ctypes.c_uint64),
+        ('allocations', ctypes.c_uint64),
+    ]
+
+
+# enum al_status al_memory_get_stats(struct al_memory_stats *);
+_al_memory_get_stats = libal.al_memory_get_stats
+_al_memory_get_stats.restype = ctypes.c_int
+_al_memory_get_stats.argtypes = [
+    ctypes.POINTER(_AlMemoryStats),
+]
+
+
 def tobytes(p: ctypes.c_void_p, size: int) -> bytes:
     '''Convert a void pointer to an object of the built-in type 'bytes'.'''
     if not p:
@@ -102,3 +154,240 @@ def tobytearray(p: ctypes.c_void_p, size: int) -> bytearray:
     type = ctypes.c_char * size
     buffer = ctypes.cast(p, ctypes.POINTER(type)).contents
     return bytearray(buffer)
+
+
+def trace_flush(path: typing.Optional[str] = None) -> None:
+    '''Write the trace of the frame pipeline recorded so far to a file
+    for chrome://tracing or Perfetto, by default at $AL_TRACE_FILE.
+
+    Raises AlException unless libal was built with TRACE=1.
+    '''
+    status = _al_trace_flush(
+        None if path is None else os.fsencode(path)
+    )
+    if not status == Status.OK:
+        raise AlException(str(status))
+
+
+def memory_stats() -> typing.Dict[str, int]:
+    '''Return the memory held by all the image buffers allocated by
+    libal: bytes and buffers now, the most bytes at any time, and the
+    number of allocations so far (see struct al_memory_stats in al.h).
+    '''
+    stats = _AlMemoryStats()
+    status = _al_memory_get_stats(ctypes.byref(stats))
+    if not status == Status.OK:
+        raise AlException(str(status))
+    return {
+        name: getattr(stats, name)
+        for name, _ in _AlMemoryStats._fields_
+    }
+
+
+# DLPack (dlpack.h, version 0.8)
+
+class _DLDevice(ctypes.Structure):
+    _fields_ = [
+        ('device_type', ctypes.c_int32),
+        ('device_id', ctypes.c_int32),
+    ]
+
+
+class _DLDataType(ctypes.Structure):
+    _fields_ = [
+        ('code', ctypes.c_uint8),
+        ('bits', ctypes.c_uint8),
+        ('lanes', ctypes.c_uint16),
+    ]
+
+
+class _DLTensor(ctypes.Structure):
+    _fields_ = [
+        ('data', ctypes.c_void_p),
+        ('device', _DLDevice),
+        ('ndim', ctypes.c_int32),
+        ('dtype', _DLDataType),
+        ('shape', ctypes.POINTER(ctypes.c_int64)),
+        ('strides', ctypes.POINTER(ctypes.c_int64)),
+        ('byte_offset', ctypes.c_uint64),
+    ]
+
+
+class _DLManagedTensor(ctypes.Structure):
+    _fields_ = [
+        ('dl_tensor', _DLTensor),
+        ('manager_ctx', ctypes.c_void_p),
+        ('deleter', ctypes.c_void_p),
+    ]
+
+
+_kDLCPU = 1
+_kDLUInt = 1
+
+_PyCapsule_New = ctypes.pythonapi.PyCapsule_New
+_PyCapsule_New.restype = ctypes.py_object
+_PyCapsule_New.argtypes = [ctypes.c_void_p, ctypes.c_char_p, ctypes.c_void_p]
+
+_PyCapsule_IsValid = ctypes.pythonapi.PyCapsule_IsValid
+_PyCapsule_IsValid.restype = ctypes.c_int
+_PyCapsule_IsValid.argtypes = [ctypes.c_void_p, ctypes.c_char_p]
+
+_PyCapsule_GetPointer = ctypes.pythonapi.PyCapsule_GetPointer
+_PyCapsule_GetPointer.restype = ctypes.c_void_p
+_PyCapsule_GetPointer.argtypes = [ctypes.c_void_p, ctypes.c_char_p]
+
+# The capsule name must outlive every capsule.
+_DLTENSOR = b'dltensor'
+
+# Managed tensors handed out and not yet deleted, by address,
+# with everything they point to (shape, strides, and the Frame itself).
+_dlpack_tensors: typing.Dict[int, typing.Any] = {}
+
+
+@ctypes.CFUNCTYPE(None, ctypes.c_void_p)
+def _dlpack_deleter(p: int) -> None:
+    _dlpack_tensors.pop(p, None)
+
+
+@ctypes.CFUNCTYPE(None, ctypes.c_void_p)
+def _dlpack_capsule_destructor(capsule: int) -> None:
+    # A consumer renames the capsule to 'used_dltensor' and becomes
+    # responsible for calling the deleter.
+    if _PyCapsule_IsValid(capsule, _DLTENSOR):
+        p = _PyCapsule_GetPointer(capsule, _DLTENSOR)
+        _dlpack_deleter(p)
+
+
+class Frame:
+    '''A view of a frame in libal memory, without a copy.
+
+    A Frame exports the NumPy array interface and DLPack,
+    so numpy.asarray(frame) and numpy.from_dlpack(frame)
+    (or torch.from_dlpack(frame), etc.) give an array that
+    points straight at the frame buffer.
+
+    The Frame (and any array made from it) keeps its owner alive,
+    so the memory is never freed under it. However, the owner
+    reuses the buffer: a camera frame is only valid until the
+    camera delivers the next frame. Copy the array to keep it longer.
+
+    The strides, in bytes, give the distance between the rows of a
+    buffer whose rows are padded; None means the rows are packed.
+    '''
+
+    def __init__(
+        self,
+        owner: typing.Any,
+        p: ctypes.c_void_p,
+        shape: typing.Tuple[int, ...],
+        strides: typing.Optional[typing.Tuple[int, ...]] = None,
+    ) -> None:
+        assert p
+        assert strides is None or len(strides) == len(shape)
+        self._owner = owner
+        self._p: int = p.value if isinstance(p, ctypes.c_void_p) else p
+        self.shape = shape
+        self.strides = strides
+
+    @property
+    def nbytes(self) -> int:
+        n = 1
+        for x in self.shape:
+            n *= x
+        return n
+
+    @property
+    def _row_size(self) -> int:
+        n = 1
+        for x in self.shape[1:]:
+            n *= x
+        return n
+
+    @property
+    def _packed(self) -> bool:
+        return self.strides is None or self.strides[0] == self._row_size
+
+    @property
+    def __array_interface__(self) -> typing.Dict[str, typing.Any]:
+        return {
+            'version': 3,
+            'shape': self.shape,
+            'typestr': '|u1',
+            'data': (self._p, False),
+            'strides': None if self._packed else self.strides,
+        }
+
+    def __dlpack_device__(self) -> typing.Tuple[int, int]:
+        return (_kDLCPU, 0)
+
+    def __dlpack__(
+        self,
+        stream: typing.Any = None,
+        max_version: typing.Any = None,
+        dl_device: typing.Any = None,
+        copy: typing.Optional[bool] = None,
+    ) -> typing.Any:
+        if stream is not None:
+            raise BufferError('stream must be None on the CPU')
+        if copy:
+            raise BufferError('copy is not supported')
+        ndim = len(self.shape)
+        shape = (ctypes.c_int64 * ndim)(*self.shape)
+        # DLPack strides are in elements, which are bytes here.
+        strides = None
+        if not self._packed:
+            assert self.strides is not None
+            strides = (ctypes.c_int64 * ndim)(*self.strides)
+        tensor = _DLManagedTensor()
+        tensor.dl_tensor.data = self._p
+        tensor.dl_tensor.device = _DLDevice(_kDLCPU, 0)
+        tensor.dl_tensor.ndim = ndim
+        tensor.dl_tensor.dtype = _DLDataType(_kDLUInt, 8, 1)
+        tensor.dl_tensor.shape = shape
+        tensor.dl_tensor.strides = strides
+        tensor.dl_tensor.byte_offset = 0
+        tensor.deleter = ctypes.cast(_dlpack_deleter, ctypes.c_void_p)
+        address = ctypes.addressof(tensor)
+        _dlpack_tensors[address] = (tensor, shape, strides, self)
+        return _PyCapsule_New(
+            address,
+            _DLTENSOR,
+            ctypes.cast(_dlpack_capsule_destructor, ctypes.c_void_p),
+        )
+
+    def memoryview(self) -> memoryview:
+        '''Return a writable memoryview of the frame, without a copy.
+
+        A frame with padded rows needs the native module.
+        '''
+        if _libal is not None:
+            return memoryview(_libal.Buffer(
+                self,
+                self._p,
+                self.shape,
+                None if self._packed else self.strides,
+            ))
+        if not self._packed:
+            raise BufferError('padded rows need the native module')
+        array = (ctypes.c_uint8 * self.nbytes).from_address(self._p)
+        array._frame = self  # type: ignore
+        return memoryview(array).cast('B').cast('B', self.shape)
+
+    def __buffer__(self, flags: int) -> memoryview:
+        return self.memoryview()
+
+    def tobytes(self) -> bytes:
+        '''Return a copy of the frame, with its rows packed.'''
+        if self._packed:
+            return ctypes.string_at(self._p, self.nbytes)
+        assert self.strides is not None
+        return b''.join(
+            ctypes.string_at(self._p + i * self.strides[0], self._row_size)
+            for i in range(self.shape[0])
+        )
+
+    def __len__(self) -> int:
+        return self.nbytes
+
+    def __repr__(self) -> str:
+        return '<Frame {} shape={}>'.format(hex(self._p), self.shape)
@@ -0,0 +1,779 @@
+/* Copyright 2023-2025, Mansour Moufid <mansourmoufid@gmail.com> */
+
+/*
+ * This file is part of Aluminium Library.
+ *
+ * Aluminium Library is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Aluminium Library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with Aluminium Library. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Optional native fast path for the libal Python package.
+ *
+ * This module does not link against libal: the package loads libal with
+ * ctypes as usual, then hands the addresses of the functions below to
+ * _init(). That way both paths always use the same library.
+ */
+
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h> // memcpy
+
+#include "al.h"
+
+static struct {
+    enum al_status (*camera_new)(struct al_camera **, size_t, size_t, size_t);
+    void (*camera_free)(struct al_camera *);
+    void (*camera_start)(struct al_camera *);
+    void (*camera_stop)(struct al_camera *);
+    enum al_status (*camera_get_id)(struct al_camera *, const char **);
+    enum al_status (*camera_get_color_format)(
+        struct al_camera *,
+        enum al_color_format *
+    );
+    enum al_status (*camera_get_width)(struct al_camera *, size_t *);
+    enum al_status (*camera_get_height)(struct al_camera *, size_t *);
+    enum al_status (*camera_get_rgba)(struct al_camera *, void **);
+    enum al_status (*camera_read_into)(
+        struct al_camera *,
+        enum al_color_format,
+        struct al_image *,
+        int
+    );
+} al = {0};
+
+static const char *const functions[] = {
+    "al_camera_new",
+    "al_camera_free",
+    "al_camera_start",
+    "al_camera_stop",
+    "al_camera_get_id",
+    "al_camera_get_color_format",
+    "al_camera_get_width",
+    "al_camera_get_height",
+    "al_camera_get_rgba",
+    "al_camera_read_into",
+};
+
+// libal.AlException, libal.camera.AlExceptionUnsupportedColorFormat,
+// libal.ColorFormat, ctypes.c_void_p
+static PyObject *AlException = NULL;
+static PyObject *AlExceptionUnsupportedColorFormat = NULL;
+static PyObject *ColorFormat = NULL;
+static PyObject *c_void_p = NULL;
+
+static
+PyObject *
+al_error(enum al_status status)
+{
+    PyObject *message = PyUnicode_FromFormat("%i", (int) status);
+    if (message == NULL)
+        return NULL;
+    PyErr_SetObject(AlException, message);
+    Py_DECREF(message);
+    return NULL;
+}
+
+static
+size_t
+format_size(enum al_color_format format, size_t stride, size_t height)
+{
+    switch (format) {
+        case AL_COLOR_FORMAT_YUV420SP:
+        case AL_COLOR_FORMAT_YUV420P:
+            return stride * height * 3 / 2;
+        case AL_COLOR_FORMAT_RGBA:
+            return stride * height * 4;
+        case AL_COLOR_FORMAT_UNKNOWN:
+            break;
+    }
+    return 0;
+}
+
+/*
+ * Buffer: a view of libal memory that exports the buffer protocol
+ * and keeps its owner alive.
+ */
+
+#define BUFFER_MAX_NDIM 3
+
+typedef struct {
+    PyObject_HEAD
+    PyObject *owner;
+    void *data;
+    int ndim;
+    bool contiguous;
+    Py_ssize_t shape[BUFFER_MAX_NDIM];
+    Py_ssize_t strides[BUFFER_MAX_NDIM];
+} BufferObject;
+
+static
+int
+Buffer_init(BufferObject *self, PyObject *args, PyObject *kwargs)
+{
+    static char *keywords[] = {"owner", "address", "shape", "strides", NULL};
+    PyObject *owner = NULL;
+    PyObject *address = NULL;
+    PyObject *shape = NULL;
+    PyObject *strides = Py_None;
+    if (!PyArg_ParseTupleAndKeywords(
+        args,
+        kwargs,
+        "OOO!|O",
+        keywords,
+        &owner,
+        &address,
+        &PyTuple_Type,
+        &shape,
+        &strides
+    ))
+        return -1;
+    void *data = PyLong_AsVoidPtr(address);
+    if (data == NULL) {
+        if (!PyErr_Occurred())
+            PyErr_SetString(PyExc_ValueError, "NULL address");
+        return -1;
+    }
+    Py_ssize_t ndim = PyTuple_GET_SIZE(shape);
+    if (ndim < 1 || ndim > BUFFER_MAX_NDIM) {
+        PyErr_SetString(PyExc_ValueError, "invalid shape");
+        return -1;
+    }
+    for (Py_ssize_t i = 0; i < ndim; i++) {
+        Py_ssize_t n = PyLong_AsSsize_t(PyTuple_GET_ITEM(shape, i));
+        if (n < 0) {
+            if (!PyErr_Occurred())
+                PyErr_SetString(PyExc_ValueError, "invalid shape");
+            return -1;
+        }
+        self->shape[i] = n;
+    }
+    Py_ssize_t stride = 1;
+    for (Py_ssize_t i = ndim - 1; i >= 0; i--) {
+        self->strides[i] = stride;
+        stride *= self->shape[i];
+    }
+    self->contiguous = true;
+    if (strides != Py_None) {
+        if (!PyTuple_Check(strides) || PyTuple_GET_SIZE(strides) != ndim) {
+            PyErr_SetString(PyExc_ValueError, "invalid strides");
+            return -1;
+        }
+        for (Py_ssize_t i = 0; i < ndim; i++) {
+            Py_ssize_t n = PyLong_AsSsize_t(PyTuple_GET_ITEM(strides, i));
+            if (n < 1) {
+                if (!PyErr_Occurred())
+                    PyErr_SetString(PyExc_ValueError, "invalid strides");
+                return -1;
+            }
+            if (n != self->strides[i])
+                self->contiguous = false;
+            self->strides[i] = n;
+        }
+    }
+    Py_INCREF(owner);
+    Py_XSETREF(self->owner, owner);
+    self->data = data;
+    self->ndim = (int) ndim;
+    return 0;
+}
+
+static
+int
+Buffer_traverse(BufferObject *self, visitproc visit, void *arg)
+{
+    Py_VISIT(self->owner);
+    return 0;
+}
+
+static
+int
+Buffer_clear(BufferObject *self)
+{
+    Py_CLEAR(self->owner);
+    return 0;
+}
+
+static
+void
+Buffer_dealloc(BufferObject *self)
+{
+    PyObject_GC_UnTrack(self);
+    Buffer_clear(self);
+    Py_TYPE(self)->tp_free((PyObject *) self);
+}
+
+static
+int
+Buffer_getbuffer(BufferObject *self, Py_buffer *view, int flags)
+{
+    if (self->data == NULL) {
+        PyErr_SetString(PyExc_BufferError, "uninitialized buffer");
+        return -1;
+    }
+    if (!self->contiguous && (flags & PyBUF_STRIDES) != PyBUF_STRIDES) {
+        PyErr_SetString(PyExc_BufferError, "buffer is not contiguous");
+        return -1;
+    }
+    Py_ssize_t len = 1;
+    for (int i = 0; i < self->ndim; i++)
+        len *= self->shape[i];
+    view->buf = self->data;
+    view->obj = (PyObject *) self;
+    Py_INCREF(self);
+    view->len = len;
+    view->readonly = 0;
+    view->itemsize = 1;
+    view->format = (flags & PyBUF_FORMAT) ? "B" : NULL;
+    view->ndim = self->ndim;
+    view->shape = (flags & PyBUF_ND) ? self->shape : NULL;
+    view->strides = (flags & PyBUF_STRIDES) ? self->strides : NULL;
+    view->suboffsets = NULL;
+    view->internal = NULL;
+    return 0;
+}
+
+static PyBufferProcs Buffer_as_buffer = {
+    .bf_getbuffer = (getbufferproc) Buffer_getbuffer,
+};
+
+static PyTypeObject BufferType = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    .tp_name = "libal._libal.Buffer",
+    .tp_doc = "Buffer(owner, address, shape, strides=None)\n\n"
+        "A uint8 view of libal memory that keeps its owner alive.\n"
+        "The strides are in bytes; None means C-contiguous.",
+    .tp_basicsize = sizeof (BufferObject),
+    .tp_flags = Py_TPFLAGS_DEFAULT | Py_TPFLAGS_HAVE_GC,
+    .tp_new = PyType_GenericNew,
+    .tp_init = (initproc) Buffer_init,
+    .tp_traverse = (traverseproc) Buffer_traverse,
+    .tp_clear = (inquiry) Buffer_clear,
+    .tp_dealloc = (destructor) Buffer_dealloc,
+    .tp_as_buffer = &Buffer_as_buffer,
+};
+
+/*
+ * Camera: the immutable properties (id, color format, and the frame
+ * size once known) are cached after the first successful query.
+ * Calls that can block or copy a frame release the GIL.
+ */
+
+typedef struct {
+    PyObject_HEAD
+    struct al_camera *cam;
+    PyObject *id;
+    PyObject *color_format;
+    size_t width;
+    size_t height;
+} CameraObject;
+
+#define CAMERA_CHECK(self, ret) \
+    if ((self)->cam == NULL) { \
+        PyErr_SetString(PyExc_ValueError, "uninitialized camera"); \
+        return ret; \
+    }
+
+static
+int
+Camera_init(CameraObject *self, PyObject *args, PyObject *kwargs)
+{
+    static char *keywords[] = {"index", "width", "height", NULL};
+    Py_ssize_t index = 0;
+    Py_ssize_t width = 0;
+    Py_ssize_t height = 0;
+    if (!PyArg_ParseTupleAndKeywords(
+        args,
+        kwargs,
+        "nnn",
+        keywords,
+        &index,
+        &width,
+        &height
+    ))
+        return -1;
+    if (index < 0 || width < 0 || height < 0) {
+        PyErr_SetString(PyExc_ValueError, "negative argument");
+        return -1;
+    }
+    if (self->cam != NULL) {
+        PyErr_SetString(PyExc_RuntimeError, "camera already initialized");
+        return -1;
+    }
+    if (al.camera_new == NULL) {
+        PyErr_SetString(PyExc_RuntimeError, "libal._libal not initialized");
+        return -1;
+    }
+    enum al_status status;
+    struct al_camera *cam = NULL;
+    Py_BEGIN_ALLOW_THREADS
+    status = al.camera_new(
+        &cam,
+        (size_t) index,
+        (size_t) width,
+        (size_t) height
+    );
+    Py_END_ALLOW_THREADS
+    if (status != AL_OK) {
+        al_error(status);
+        return -1;
+    }
+    self->cam = cam;
+    return 0;
+}
+
+static
+void
+Camera_dealloc(CameraObject *self)
+{
+    struct al_camera *cam = self->cam;
+    self->cam = NULL;
+    if (cam != NULL) {
+        Py_BEGIN_ALLOW_THREADS
+        al.camera_stop(cam);
+        al.camera_free(cam);
+        Py_END_ALLOW_THREADS
+    }
+    Py_CLEAR(self->id);
+    Py_CLEAR(self->color_format);
+    Py_TYPE(self)->tp_free((PyObject *) self);
+}
+
+static
+PyObject *
+Camera_start(CameraObject *self, PyObject *Py_UNUSED(ignored))
+{
+    CAMERA_CHECK(self, NULL);
+    Py_BEGIN_ALLOW_THREADS
+    al.camera_start(self->cam);
+    Py_END_ALLOW_THREADS
+    Py_RETURN_NONE;
+}
+
+static
+PyObject *
+Camera_stop(CameraObject *self, PyObject *Py_UNUSED(ignored))
+{
+    CAMERA_CHECK(self, NULL);
+    Py_BEGIN_ALLOW_THREADS
+    al.camera_stop(self->cam);
+    Py_END_ALLOW_THREADS
+    Py_RETURN_NONE;
+}
+
+static
+int
+_camera_size(CameraObject *self)
+{
+    if (self->width > 0 && self->height > 0)
+        return 0;
+    size_t w = 0;
+    size_t h = 0;
+    enum al_status status = al.camera_get_width(self->cam, &w);
+    if (status == AL_OK)
+        status = al.camera_get_height(self->cam, &h);
+    if (status != AL_OK) {
+        al_error(status);
+        return -1;
+    }
+    // zero until the first frame
+    if (w > 0 && h > 0) {
+        self->width = w;
+        self->height = h;
+    }
+    return 0;
+}
+
+static
+PyObject *
+Camera_get_width(CameraObject *self, void *closure)
+{
+    CAMERA_CHECK(self, NULL);
+    if (_camera_size(self) != 0)
+        return NULL;
+    return PyLong_FromSize_t(self->width);
+}
+
+static
+PyObject *
+Camera_get_height(CameraObject *self, void *closure)
+{
+    CAMERA_CHECK(self, NULL);
+    if (_camera_size(self) != 0)
+        return NULL;
+    return PyLong_FromSize_t(self->height);
+}
+
+static
+PyObject *
+Camera_get_id(CameraObject *self, void *closure)
+{
+    CAMERA_CHECK(self, NULL);
+    if (self->id == NULL) {
+        const char *id = NULL;
+        enum al_status status = al.camera_get_id(self->cam, &id);
+        if (status != AL_OK)
+            return al_error(status);
+        if (id == NULL)
+            Py_RETURN_NONE;
+        self->id = PyUnicode_FromString(id);
+        if (self->id == NULL)
+            return NULL;
+    }
+    Py_INCREF(self->id);
+    return self->id;
+}
+
+static
+PyObject *
+Camera_get_color_format(CameraObject *self, void *closure)
+{
+    CAMERA_CHECK(self, NULL);
+    if (self->color_format == NULL) {
+        enum al_color_format format = AL_COLOR_FORMAT_UNKNOWN;
+        enum al_status status = al.camera_get_color_format(
+            self->cam,
+            &format
+        );
+        if (status != AL_OK)
+            return al_error(status);
+        PyObject *value = PyObject_CallFunction(
+            ColorFormat,
+            "i",
+            (int) format
+        );
+        // unknown until the first frame
+        if (value == NULL || format == AL_COLOR_FORMAT_UNKNOWN)
+            return value;
+        self->color_format = value;
+    }
+    Py_INCREF(self->color_format);
+    return self->color_format;
+}
+
+static
+void *
+_camera_rgba(CameraObject *self)
+{
+    void *data = NULL;
+    enum al_status status = al.camera_get_rgba(self->cam, &data);
+    if (status != AL_OK) {
+        al_error(status);
+        return NULL;
+    }
+    return data;
+}
+
+static
+PyObject *
+Camera_get_rgba(CameraObject *self, void *closure)
+{
+    CAMERA_CHECK(self, NULL);
+    void *data = _camera_rgba(self);
+    if (data == NULL && PyErr_Occurred())
+        return NULL;
+    if (data == NULL)
+        return PyObject_CallNoArgs(c_void_p);
+    PyObject *address = PyLong_FromVoidPtr(data);
+    if (address == NULL)
+        return NULL;
+    PyObject *p = PyObject_CallOneArg(c_void_p, address);
+    Py_DECREF(address);
+    return p;
+}
+
+static
+PyObject *
+_camera_rgba_copy(CameraObject *self, bool bytearray)
+{
+    CAMERA_CHECK(self, NULL);
+    void *data = _camera_rgba(self);
+    size_t size = 0;
+    if (data == NULL && PyErr_Occurred())
+        return NULL;
+    if (data != NULL) {
+        if (_camera_size(self) != 0)
+            return NULL;
+        size = self->width * self->height * 4;
+    }
+    PyObject *copy = bytearray
+        ? PyByteArray_FromStringAndSize(NULL, (Py_ssize_t) size)
+        : PyBytes_FromStringAndSize(NULL, (Py_ssize_t) size);
+    if (copy == NULL || size == 0)
+        return copy;
+    char *buffer = bytearray
+        ? PyByteArray_AS_STRING(copy)
+        : PyBytes_AS_STRING(copy);
+    Py_BEGIN_ALLOW_THREADS
+    memcpy(buffer, data, size);
+    Py_END_ALLOW_THREADS
+    return copy;
+}
+
+static
+PyObject *
+Camera_get_rgba_bytes(CameraObject *self, void *closure)
+{
+    return _camera_rgba_copy(self, false);
+}
+
+static
+PyObject *
+Camera_get_rgba_bytearray(CameraObject *self, void *closure)
+{
+    return _camera_rgba_copy(self, true);
+}
+
+static
+PyObject *
+Camera_readinto(CameraObject *self, PyObject *args, PyObject *kwargs)
+{
+    static char *keywords[] = {"buffer", "format", "timeout", "stride", NULL};
+    Py_buffer buffer = {0};
+    int format = AL_COLOR_FORMAT_RGBA;
+    int timeout = 0;
+    PyObject *stride_arg = Py_None;
+    CAMERA_CHECK(self, NULL);
+    if (!PyArg_ParseTupleAndKeywords(
+        args,
+        kwargs,
+        "w*|iiO",
+        keywords,
+        &buffer,
+        &format,
+        &timeout,
+        &stride_arg
+    ))
+        return NULL;
+    PyObject *ret = NULL;
+    if (_camera_size(self) != 0)
+        goto done;
+    size_t stride = self->width;
+    if (stride_arg != Py_None) {
+        stride = PyLong_AsSize_t(stride_arg);
+        if (stride == (size_t) -1 && PyErr_Occurred())
+            goto done;
+    }
+    switch (format) {
+        case AL_COLOR_FORMAT_YUV420SP:
+        case AL_COLOR_FORMAT_YUV420P:
+        case AL_COLOR_FORMAT_RGBA:
+            break;
+        default:
+            PyErr_SetNone(AlExceptionUnsupportedColorFormat);
+            goto done;
+    }
+    size_t size = format_size(format, stride, self->height);
+    if ((size_t) buffer.len < size) {
+        PyErr_Format(
+            PyExc_ValueError,
+            "buffer is too small: %zd < %zu",
+            buffer.len,
+            size
+        );
+        goto done;
+    }
+    struct al_image image = {
+        .width = self->width,
+        .height = self->height,
+        .stride = stride,
+        .data = buffer.buf,
+        .format = format,
+    };
+    enum al_status status;
+    Py_BEGIN_ALLOW_THREADS
+    status = al.camera_read_into(self->cam, format, &image, timeout);
+    Py_END_ALLOW_THREADS
+    if (status == AL_TIMEOUT)
+        ret = PyLong_FromLong(0);
+    else if (status != AL_OK)
+        al_error(status);
+    else
+        ret = PyLong_FromSize_t(size);
+done:
+    PyBuffer_Release(&buffer);
+    return ret;
+}
+
+static
+PyObject *
+Camera_get_address(CameraObject *self, void *closure)
+{
+    CAMERA_CHECK(self, NULL);
+    return PyLong_FromVoidPtr(self->cam);
+}
+
+static PyMethodDef Camera_methods[] = {
+    {
+        "start",
+        (PyCFunction) Camera_start,
+        METH_NOARGS,
+        "Start reading frames.",
+    },
+    {
+        "stop",
+        (PyCFunction) Camera_stop,
+        METH_NOARGS,
+        "Stop reading frames.",
+    },
+    {
+        "readinto",
+        (PyCFunction) (void (*)(void)) Camera_readinto,
+        METH_VARARGS | METH_KEYWORDS,
+        "readinto(buffer, format=RGBA, timeout=0, stride=None)\n\n"
+        "Read the next frame into a preallocated, writable buffer.",
+    },
+    {NULL},
+};
+
+static PyGetSetDef Camera_getset[] = {
+    {"id", (getter) Camera_get_id, NULL, NULL, NULL},
+    {"color_format", (getter) Camera_get_color_format, NULL, NULL, NULL},
+    {"width", (getter) Camera_get_width, NULL, NULL, NULL},
+    {"height", (getter) Camera_get_height, NULL, NULL, NULL},
+    {"rgba", (getter) Camera_get_rgba, NULL, NULL, NULL},
+    {"rgba_bytes", (getter) Camera_get_rgba_bytes, NULL, NULL, NULL},
+    {"rgba_bytearray", (getter) Camera_get_rgba_bytearray, NULL, NULL, NULL},
+    {"_address", (getter) Camera_get_address, NULL, NULL, NULL},
+    {NULL},
+};
+
+static PyTypeObject CameraType = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    .tp_name = "libal._libal.Camera",
+    .tp_doc = "Camera(index, width, height)",
+    .tp_basicsize = sizeof (CameraObject),
+    .tp_flags = Py_TPFLAGS_DEFAULT | Py_TPFLAGS_BASETYPE,
+    .tp_new = PyType_GenericNew,
+    .tp_init = (initproc) Camera_init,
+    .tp_dealloc = (destructor) Camera_dealloc,
+    .tp_methods = Camera_methods,
+    .tp_getset = Camera_getset,
+};
+
+/*
+ * _init(
+ *     {name: address},
+ *     AlException,
+ *     AlExceptionUnsupportedColorFormat,
+ *     ColorFormat,
+ *     c_void_p
+ * )
+ */
+static
+PyObject *
+libal_init(PyObject *module, PyObject *args)
+{
+    PyObject *addresses = NULL;
+    PyObject *exception = NULL;
+    PyObject *unsupported = NULL;
+    PyObject *color_format = NULL;
+    PyObject *void_p = NULL;
+    if (!PyArg_ParseTuple(
+        args,
+        "O!OOOO",
+        &PyDict_Type,
+        &addresses,
+        &exception,
+        &unsupported,
+        &color_format,
+        &void_p
+    ))
+        return NULL;
+    void *pointers[sizeof (functions) / sizeof (functions[0])];
+    for (size_t i = 0; i < sizeof (functions) / sizeof (functions[0]); i++) {
+        PyObject *address = PyDict_GetItemString(addresses, functions[i]);
+        if (address == NULL) {
+            PyErr_Format(PyExc_KeyError, "%s", functions[i]);
+            return NULL;
+        }
+        pointers[i] = PyLong_AsVoidPtr(address);
+        if (pointers[i] == NULL) {
+            if (!PyErr_Occurred())
+                PyErr_Format(PyExc_ValueError, "%s: NULL", functions[i]);
+            return NULL;
+        }
+    }
+    _Static_assert(
+        sizeof (al) == sizeof (pointers),
+        "functions and al must match"
+    );
+    memcpy(&al, pointers, sizeof (al));
+    Py_INCREF(exception);
+    Py_XSETREF(AlException, exception);
+    Py_INCREF(unsupported);
+    Py_XSETREF(AlExceptionUnsupportedColorFormat, unsupported);
+    Py_INCREF(color_format);
+    Py_XSETREF(ColorFormat, color_format);
+    Py_INCREF(void_p);
+    Py_XSETREF(c_void_p, void_p);
+    Py_RETURN_NONE;
+}
+
+static PyMethodDef libal_methods[] = {
+    {"_init", libal_init, METH_VARARGS, NULL},
+    {NULL},
+};
+
+static struct PyModuleDef libal_module = {
+    PyModuleDef_HEAD_INIT,
+    .m_name = "libal._libal",
+    .m_doc = "Native fast path for the libal package.",
+    .m_size = -1,
+    .m_methods = libal_methods,
+};
+
+PyMODINIT_FUNC
+PyInit__libal(void)
+{
+    if (PyType_Ready(&BufferType) < 0)
+        return NULL;
+    if (PyType_Ready(&CameraType) < 0)
+        return NULL;
+    PyObject *module = PyModule_Create(&libal_module);
+    if (module == NULL)
+        return NULL;
+    PyObject *names = PyTuple_New(sizeof (functions) / sizeof (functions[0]));
+    if (names == NULL)
+        goto error;
+    for (size_t i = 0; i < sizeof (functions) / sizeof (functions[0]); i++) {
+        PyObject *name = PyUnicode_FromString(functions[i]);
+        if (name == NULL) {
+            Py_DECREF(names);
+            goto error;
+        }
+        PyTuple_SET_ITEM(names, (Py_ssize_t) i, name);
+    }
+    if (PyModule_AddObject(module, "functions", names) < 0) {
+        Py_DECREF(names);
+        goto error;
+    }
+    Py_INCREF(&BufferType);
+    if (PyModule_AddObject(module, "Buffer", (PyObject *) &BufferType) < 0) {
+        Py_DECREF(&BufferType);
+        goto error;
+    }
+    Py_INCREF(&CameraType);
+    if (PyModule_AddObject(module, "Camera", (PyObject *) &CameraType) < 0) {
+        Py_DECREF(&CameraType);
+        goto error;
+    }
+    return module;
+error:
+    Py_DECREF(module);
+    return NULL;
+}
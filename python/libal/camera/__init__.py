@@ -24,9 +24,12 @@ __all__ = [
 ]
 
 
+import asyncio
 import ctypes
 import enum
+import os
 import sys
+import typing
 # import traceback
 
 if sys.platform == 'darwin':
@@ -34,8 +37,12 @@ if sys.platform == 'darwin':
     pass
 
 from .. import (
+    _AlImage,
+    _AlMemoryStats,
+    _libal,
     AlException,
     ColorFormat,
+    Frame,
     libal,
     Status,
     tobytes,
@@ -136,6 +143,19 @@ _al_camera_get_data.argtypes = [
     ctypes.POINTER(ctypes.c_void_p),
 ]
 
+# enum al_status al_camera_get_image(
+#   struct al_camera *,
+#   enum al_color_format,
+#   struct al_image *
+# );
+_al_camera_get_image = libal.al_camera_get_image
+_al_camera_get_image.restype = ctypes.c_int
+_al_camera_get_image.argtypes = [
+    ctypes.POINTER(_AlCamera),
+    ctypes.c_int,
+    ctypes.POINTER(_AlImage),
+]
+
 # enum al_status al_camera_get_rgba(struct al_camera *, void **);
 _al_camera_get_rgba = libal.al_camera_get_rgba
 _al_camera_get_rgba.restype = ctypes.c_int
@@ -144,6 +164,104 @@ _al_camera_get_rgba.argtypes = [
     ctypes.POINTER(ctypes.c_void_p),
 ]
 
+# enum al_status al_camera_read_into(
+#   struct al_camera *,
+#   enum al_color_format,
+#   struct al_image *,
+#   int
+# );
+_al_camera_read_into = libal.al_camera_read_into
+_al_camera_read_into.restype = ctypes.c_int
+_al_camera_read_into.argtypes = [
+    ctypes.POINTER(_AlCamera),
+    ctypes.c_int,
+    ctypes.POINTER(_AlImage),
+    ctypes.c_int,
+]
+
+# enum al_status al_camera_get_fd(struct al_camera *, int *);
+_al_camera_get_fd = libal.al_camera_get_fd
+_al_camera_get_fd.restype = ctypes.c_int
+_al_camera_get_fd.argtypes = [
+    ctypes.POINTER(_AlCamera),
+    ctypes.POINTER(ctypes.c_int),
+]
+
+
+# struct al_camera_stats;
+class _AlCameraStats(ctypes.Structure):
+    _fields_ = [
+        ('frames', ctypes.c_uint64),
+        ('delivered', ctypes.c_uint64),
+        ('dropped', ctypes.c_uint64),
+        ('unread', ctypes.c_uint64),
+        ('bytes_copied', ctypes.c_uint64),
+        ('process_ns', ctypes.c_uint64),
+        ('process_max_ns', ctypes.c_uint64),
+        ('repack_ns', ctypes.c_uint64),
+        ('repack_max_ns', ctypes.c_uint64),
+        ('convert_ns', ctypes.c_uint64),
+        ('convert_max_ns', ctypes.c_uint64),
+        ('latency_ns', ctypes.c_uint64),
+    ]
+
+
+# enum al_status al_camera_get_stats(
+#   struct al_camera *,
+#   struct al_camera_stats *
+# );
+_al_camera_get_stats = libal.al_camera_get_stats
+_al_camera_get_stats.restype = ctypes.c_int
+_al_camera_get_stats.argtypes = [
+    ctypes.POINTER(_AlCamera),
+    ctypes.POINTER(_AlCameraStats),
+]
+
+
+# enum al_status al_camera_get_memory(
+#   struct al_camera *,
+#   struct al_memory_stats *
+# );
+_al_camera_get_memory = libal.al_camera_get_memory
+_al_camera_get_memory.restype = ctypes.c_int
+_al_camera_get_memory.argtypes = [
+    ctypes.POINTER(_AlCamera),
+    ctypes.POINTER(_AlMemoryStats),
+]
+
+
+# struct al_camera_frame;
+class _AlCameraFrame(ctypes.Structure):
+    _fields_ = [
+        ('sequence', ctypes.c_uint64),
+        ('timestamp', ctypes.c_uint64),
+    ]
+
+
+# enum al_status al_camera_get_frame(
+#   struct al_camera *,
+#   struct al_camera_frame *
+# );
+_al_camera_get_frame = libal.al_camera_get_frame
+_al_camera_get_frame.restype = ctypes.c_int
+_al_camera_get_frame.argtypes = [
+    ctypes.POINTER(_AlCamera),
+    ctypes.POINTER(_AlCameraFrame),
+]
+
+# enum al_status al_camera_get_latency(
+#   struct al_camera *,
+#   double,
+#   uint64_t *
+# );
+_al_camera_get_latency = libal.al_camera_get_latency
+_al_camera_get_latency.restype = ctypes.c_int
+_al_camera_get_latency.argtypes = [
+    ctypes.POINTER(_AlCamera),
+    ctypes.c_double,
+    ctypes.POINTER(ctypes.c_uint64),
+]
+
 # enum al_status al_camera_get_facing(
 #   struct al_camera *,
 #   enum al_camera_facing *
@@ -315,6 +433,255 @@ class Camera:
             size = self.width * self.height * 4
         return tobytearray(p, size)
 
+    @property
+    def rgba_frame(self) -> typing.Optional[Frame]:
+        '''Similar to Camera.rgba but returns a Frame of shape (h, w, 4).
+
+        The Frame is a view of the camera's buffer, without a copy;
+        see libal.Frame for how long it remains valid.
+        Returns None if there is no new frame.
+        '''
+        p = self.rgba
+        if not p:
+            return None
+        return Frame(self, p, (self.height, self.width, 4))
+
+    @property
+    def rgba_array(self) -> typing.Any:
+        '''Similar to Camera.rgba_frame but returns a NumPy array.
+
+        Returns None if there is no new frame.
+        '''
+        import numpy
+        frame = self.rgba_frame
+        if frame is None:
+            return None
+        return numpy.asarray(frame)
+
+    def data_frame(
+        self,
+        format: typing.Optional[ColorFormat] = None,
+    ) -> typing.Optional[Frame]:
+        '''Return the current frame in the given format as a Frame.
+
+        The format defaults to Camera.color_format. YUV 4:2:0 frames have
+        shape (h * 3 / 2, w): the luma plane followed by the chroma planes.
+        The rows are as far apart as in the camera's buffer, which may
+        be padded (see al_camera_set_stride), as given by Frame.strides.
+        The chroma rows of a padded YUV420P frame are half as long, so
+        such a frame has shape (h * 3 / 2, stride), padding included.
+        Like Camera.rgba_frame, this is a view without a copy.
+        Returns None if no frame has been read yet.
+        '''
+        assert self._cam
+        if format is None:
+            format = self.color_format
+        if format not in (
+            ColorFormat.RGBA,
+            ColorFormat.YUV420P,
+            ColorFormat.YUV420SP,
+        ):
+            raise AlExceptionUnsupportedColorFormat
+        image = _AlImage()
+        status = _al_camera_get_image(self._cam, format, ctypes.byref(image))
+        if not status == Status.OK:
+            raise AlException(str(status))
+        w, h, stride = image.width, image.height, image.stride
+        if not image.data or w == 0 or h == 0:
+            return None
+        if format == ColorFormat.RGBA:
+            return Frame(self, image.data, (h, w, 4), (stride * 4, 4, 1))
+        if format == ColorFormat.YUV420P and stride != w:
+            return Frame(self, image.data, (h * 3 // 2, stride))
+        return Frame(self, image.data, (h * 3 // 2, w), (stride, 1))
+
+    def data_array(
+        self,
+        format: typing.Optional[ColorFormat] = None,
+    ) -> typing.Any:
+        '''Similar to Camera.data_frame but returns a NumPy array.'''
+        import numpy
+        frame = self.data_frame(format)
+        if frame is None:
+            return None
+        return numpy.asarray(frame)
+
+    def readinto(
+        self,
+        buffer: typing.Any,
+        format: ColorFormat = ColorFormat.RGBA,
+        timeout: int = 0,
+        stride: typing.Optional[int] = None,
+    ) -> int:
+        '''Read the next frame into a preallocated, writable buffer.
+
+        The buffer can be any writable, contiguous object that supports
+        the buffer protocol (bytearray, memoryview, numpy.ndarray, etc.).
+        The frame is converted to the given format, with rows 'stride'
+        pixels apart (the width by default).
+
+        Waits at most 'timeout' milliseconds for a new frame,
+        or indefinitely if negative.
+        Returns the number of bytes written, or zero if there was no
+        new frame in time.
+        '''
+        assert self._cam
+        w, h = self.width, self.height
+        if stride is None:
+            stride = w
+        if format == ColorFormat.RGBA:
+            size = stride * h * 4
+        elif format in (ColorFormat.YUV420P, ColorFormat.YUV420SP):
+            size = stride * h * 3 // 2
+        else:
+            raise AlExceptionUnsupportedColorFormat
+        view = memoryview(buffer).cast('B')
+        if view.nbytes < size:
+            raise ValueError('buffer is too small: {} < {}'.format(
+                view.nbytes,
+                size,
+            ))
+        data = (ctypes.c_char * view.nbytes).from_buffer(view)
+        image = _AlImage(
+            width=w,
+            height=h,
+            stride=stride,
+            data=ctypes.addressof(data),
+            format=format,
+        )
+        status = _al_camera_read_into(
+            self._cam,
+            format,
+            ctypes.byref(image),
+            timeout,
+        )
+        del data
+        view.release()
+        if status == Status.TIMEOUT:
+            return 0
+        if not status == Status.OK:
+            raise AlException(str(status))
+        return size
+
+    @property
+    def fd(self) -> int:
+        '''Return a file descriptor that becomes readable on a new frame.
+
+        The descriptor is non-blocking and owned by the camera:
+        do not close it. Drain it with os.read before reading the frame.
+        '''
+        assert self._cam
+        fd = ctypes.c_int(-1)
+        status = _al_camera_get_fd(self._cam, ctypes.byref(fd))
+        if not status == Status.OK:
+            raise AlException(str(status))
+        return fd.value
+
+    async def frames(
+        self,
+        copy: bool = True,
+    ) -> typing.AsyncIterator[typing.Union[bytes, Frame]]:
+        '''Yield frames in RGBA format as they arrive.
+
+            async for frame in camera.frames():
+                ...
+
+        The event loop waits on Camera.fd, so it wakes once per frame
+        without polling or threads. Frames that arrive while the
+        consumer is busy are skipped.
+
+        With copy=False, this yields a Frame instead of bytes,
+        which is only valid until the next frame (see libal.Frame).
+        '''
+        loop = asyncio.get_running_loop()
+        # A generator left with break is only closed later, so each one
+        # needs its own descriptor to add and remove a reader for.
+        fd = os.dup(self.fd)
+        ready = asyncio.Event()
+        loop.add_reader(fd, ready.set)
+        try:
+            while True:
+                await ready.wait()
+                ready.clear()
+                try:
+                    while os.read(fd, 4096):
+                        pass
+                except BlockingIOError:
+                    pass
+                frame: typing.Union[bytes, Frame, None]
+                frame = self.rgba_bytes if copy else self.rgba_frame
+                if frame:
+                    yield frame
+        finally:
+            loop.remove_reader(fd)
+            os.close(fd)
+
+    @property
+    def stats(self) -> typing.Dict[str, int]:
+        '''Return the pipeline statistics of the camera since it was
+        created: frames made available, delivered, dropped and never
+        read, bytes copied, and the total and maximum nanoseconds spent
+        processing each frame, repacking its planes and converting it
+        to RGBA, and the total latency of the frames read (see struct
+        al_camera_stats in al.h).
+        '''
+        assert self._cam
+        stats = _AlCameraStats()
+        status = _al_camera_get_stats(self._cam, ctypes.byref(stats))
+        if not status == Status.OK:
+            raise AlException(str(status))
+        return {
+            name: getattr(stats, name)
+            for name, _ in _AlCameraStats._fields_
+        }
+
+    @property
+    def memory(self) -> typing.Dict[str, int]:
+        '''Return the memory held by the image buffers of the camera, in
+        the same form as libal.memory_stats().
+        '''
+        assert self._cam
+        stats = _AlMemoryStats()
+        status = _al_camera_get_memory(self._cam, ctypes.byref(stats))
+        if not status == Status.OK:
+            raise AlException(str(status))
+        return {
+            name: getattr(stats, name)
+            for name, _ in _AlMemoryStats._fields_
+        }
+
+    @property
+    def frame_info(self) -> typing.Tuple[int, int]:
+        '''Return the sequence number (from 1) and the capture timestamp
+        in nanoseconds of the last frame read, or zeros.
+
+        The timestamp is on the camera's clock: CLOCK_BOOTTIME on
+        Android and the host clock on Darwin.
+        '''
+        assert self._cam
+        frame = _AlCameraFrame()
+        status = _al_camera_get_frame(self._cam, ctypes.byref(frame))
+        if not status == Status.OK:
+            raise AlException(str(status))
+        return (frame.sequence, frame.timestamp)
+
+    def latency(self, percentile: float = 50) -> int:
+        '''Return a percentile (0 to 100) of the latency from capture to
+        delivery of the frames read so far, in nanoseconds, or zero.
+        '''
+        assert self._cam
+        if not 0 <= percentile <= 100:
+            raise ValueError('percentile must be between 0 and 100')
+        ns = ctypes.c_uint64()
+        status = _al_camera_get_latency(
+            self._cam,
+            percentile,
+            ctypes.byref(ns),
+        )
+        if not status == Status.OK:
+            raise AlException(str(status))
+        return ns.value
+
     @property
     def facing(self) -> Facing:
         assert self._cam
@@ -334,3 +701,37 @@ class Camera:
         self.stop()
         if self._cam:
             _al_camera_free(self._cam)
+
+
+if _libal is not None:
+
+    _libal._init(
+        {
+            name: ctypes.cast(getattr(libal, name), ctypes.c_void_p).value
+            for name in _libal.functions
+        },
+        AlException,
+        AlExceptionUnsupportedColorFormat,
+        ColorFormat,
+        ctypes.c_void_p,
+    )
+
+    class _NativeCamera(_libal.Camera, Camera):
+        # The extension type owns the al_camera, caches the immutable
+        # properties and releases the GIL in blocking calls; the rest
+        # of the methods are inherited from the ctypes implementation.
+
+        def __init__(self, index: int, width: int, height: int) -> None:
+            _libal.Camera.__init__(self, index, width, height)
+            self.index = index
+            self._cam = ctypes.cast(
+                self._address,
+                ctypes.POINTER(_AlCamera),
+            )
+
+        def __del__(self) -> None:
+            pass
+
+    _NativeCamera.__name__ = 'Camera'
+    _NativeCamera.__qualname__ = 'Camera'
+    Camera = _NativeCamera  # type: ignore
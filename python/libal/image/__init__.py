@@ -0,0 +1,414 @@
+# This file is part of Aluminium Library.
+#
+# Aluminium Library is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by the
+# Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# Aluminium Library is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+# See the GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License along
+# with Aluminium Library. If not, see <https://www.gnu.org/licenses/>.
+
+
+'''The Aluminium Library image module.'''
+
+
+__all__ = [
+    'Image',
+    'Operation',
+    'Output',
+    'PADDING',
+    'batch',
+]
+
+
+import ctypes
+import enum
+import typing
+
+from .. import (
+    _AlImage,
+    AlException,
+    ColorFormat,
+    Frame,
+    libal,
+    Status,
+)
+
+
+# enum al_status al_image_alloc(struct al_image *);
+_al_image_alloc = libal.al_image_alloc
+_al_image_alloc.restype = ctypes.c_int
+_al_image_alloc.argtypes = [
+    ctypes.POINTER(_AlImage),
+]
+
+# enum al_status al_image_alloc_padded(struct al_image *);
+_al_image_alloc_padded = libal.al_image_alloc_padded
+_al_image_alloc_padded.restype = ctypes.c_int
+_al_image_alloc_padded.argtypes = [
+    ctypes.POINTER(_AlImage),
+]
+
+# void al_image_free(struct al_image *);
+_al_image_free = libal.al_image_free
+_al_image_free.restype = None
+_al_image_free.argtypes = [
+    ctypes.POINTER(_AlImage),
+]
+
+# enum al_status al_image_convert(
+#   const struct al_image *,
+#   struct al_image *
+# );
+_al_image_convert = libal.al_image_convert
+_al_image_convert.restype = ctypes.c_int
+_al_image_convert.argtypes = [
+    ctypes.POINTER(_AlImage),
+    ctypes.POINTER(_AlImage),
+]
+
+# enum al_status al_image_rotate(
+#   struct al_image *,
+#   struct al_image *,
+#   int
+# );
+_al_image_rotate = libal.al_image_rotate
+_al_image_rotate.restype = ctypes.c_int
+_al_image_rotate.argtypes = [
+    ctypes.POINTER(_AlImage),
+    ctypes.POINTER(_AlImage),
+    ctypes.c_int,
+]
+
+# enum al_status al_image_copy(
+#   const struct al_image *,
+#   struct al_image *
+# );
+_al_image_copy = libal.al_image_copy
+_al_image_copy.restype = ctypes.c_int
+_al_image_copy.argtypes = [
+    ctypes.POINTER(_AlImage),
+    ctypes.POINTER(_AlImage),
+]
+
+
+class Output(enum.IntEnum):
+    '''The stores of copy and convert: AUTO streams copies larger than
+    half the cache; STREAM bypasses the cache, for outputs that this
+    thread will not read again soon; CACHE keeps them in it, for a next
+    stage on this thread.'''
+    AUTO = 0
+    STREAM = 1
+    CACHE = 2
+
+
+# enum al_status al_image_copy_output(
+#   const struct al_image *,
+#   struct al_image *,
+#   enum al_image_output
+# );
+_al_image_copy_output = libal.al_image_copy_output
+_al_image_copy_output.restype = ctypes.c_int
+_al_image_copy_output.argtypes = [
+    ctypes.POINTER(_AlImage),
+    ctypes.POINTER(_AlImage),
+    ctypes.c_int,
+]
+
+# enum al_status al_image_convert_output(
+#   const struct al_image *,
+#   struct al_image *,
+#   enum al_image_output
+# );
+_al_image_convert_output = libal.al_image_convert_output
+_al_image_convert_output.restype = ctypes.c_int
+_al_image_convert_output.argtypes = [
+    ctypes.POINTER(_AlImage),
+    ctypes.POINTER(_AlImage),
+    ctypes.c_int,
+]
+
+# enum al_status al_image_resize(
+#   const struct al_image *,
+#   struct al_image *
+# );
+_al_image_resize = libal.al_image_resize
+_al_image_resize.restype = ctypes.c_int
+_al_image_resize.argtypes = [
+    ctypes.POINTER(_AlImage),
+    ctypes.POINTER(_AlImage),
+]
+
+
+class Operation(enum.IntEnum):
+    COPY = 0
+    CONVERT = 1
+    RESIZE = 2
+    ROTATE = 3
+
+
+# struct al_image_op;
+class _AlImageOp(ctypes.Structure):
+    _fields_ = [
+        ('operation', ctypes.c_int),
+        ('degrees', ctypes.c_int),
+    ]
+
+
+# enum al_status al_image_batch(
+#   const struct al_image_op *,
+#   struct al_image *,
+#   struct al_image *,
+#   size_t
+# );
+_al_image_batch = libal.al_image_batch
+_al_image_batch.restype = ctypes.c_int
+_al_image_batch.argtypes = [
+    ctypes.POINTER(_AlImageOp),
+    ctypes.POINTER(_AlImage),
+    ctypes.POINTER(_AlImage),
+    ctypes.c_size_t,
+]
+
+
+# #define AL_IMAGE_PADDING 64
+PADDING = 64
+
+
+class Image:
+    '''An image in memory allocated (and aligned) by libal.
+
+    The stride is in pixels, and defaults to the width rounded up
+    to a multiple of 32. If padded, the stride is rounded up so that
+    every row is a whole number of PADDING bytes, and PADDING more
+    bytes follow the last row, for kernels that work on whole vectors.
+    An Image exports the buffer protocol, the NumPy array interface
+    and DLPack, like Frame, over its whole buffer including the row
+    padding (but not the bytes after the last row): the shape is
+    (height, stride, 4) for RGBA and (height * 3 // 2, stride) for YUV.
+
+    copy, rotate and convert run in libal, with the GIL released,
+    and write into a preallocated destination Image, so a loop can
+    reuse the same buffers for every frame.
+
+    To read camera frames into an Image, use
+    camera.readinto(image.memoryview(), image.format, stride=image.stride).
+    '''
+
+    def __init__(
+        self,
+        width: int,
+        height: int,
+        format: ColorFormat = ColorFormat.RGBA,
+        stride: int = 0,
+        padded: bool = False,
+    ) -> None:
+        self._image = _AlImage(
+            width=width,
+            height=height,
+            stride=stride,
+            data=None,
+            format=format,
+        )
+        if padded:
+            status = _al_image_alloc_padded(ctypes.byref(self._image))
+        else:
+            status = _al_image_alloc(ctypes.byref(self._image))
+        if not status == Status.OK:
+            raise AlException(str(status))
+
+    @property
+    def width(self) -> int:
+        return self._image.width
+
+    @property
+    def height(self) -> int:
+        return self._image.height
+
+    @property
+    def stride(self) -> int:
+        '''Return the distance between rows, in pixels.'''
+        return self._image.stride
+
+    @property
+    def format(self) -> ColorFormat:
+        return ColorFormat(self._image.format)
+
+    @property
+    def shape(self) -> typing.Tuple[int, ...]:
+        if self.format == ColorFormat.RGBA:
+            return (self.height, self.stride, 4)
+        return (self.height * 3 // 2, self.stride)
+
+    @property
+    def nbytes(self) -> int:
+        n = 1
+        for x in self.shape:
+            n *= x
+        return n
+
+    @property
+    def frame(self) -> Frame:
+        '''Return a view of the image, without a copy.'''
+        assert self._image.data
+        return Frame(self, self._image.data, self.shape)
+
+    @property
+    def __array_interface__(self) -> typing.Dict[str, typing.Any]:
+        return self.frame.__array_interface__
+
+    def __dlpack_device__(self) -> typing.Tuple[int, int]:
+        return self.frame.__dlpack_device__()
+
+    def __dlpack__(
+        self,
+        *args: typing.Any,
+        **kwargs: typing.Any,
+    ) -> typing.Any:
+        return self.frame.__dlpack__(*args, **kwargs)
+
+    def memoryview(self) -> memoryview:
+        '''Return a writable memoryview of the image, without a copy.'''
+        return self.frame.memoryview()
+
+    def __buffer__(self, flags: int) -> memoryview:
+        return self.memoryview()
+
+    def tobytes(self) -> bytes:
+        '''Return a copy of the image.'''
+        return self.frame.tobytes()
+
+    def _check(self, status: int) -> 'Image':
+        if not status == Status.OK:
+            raise AlException(str(status))
+        return self
+
+    def copy(self, dst: 'Image', output: Output = Output.AUTO) -> 'Image':
+        '''Copy this image into dst, of the same format; return dst.'''
+        if not dst.format == self.format:
+            raise ValueError('formats differ: {} != {}'.format(
+                self.format,
+                dst.format,
+            ))
+        status = _al_image_copy_output(
+            ctypes.byref(self._image),
+            ctypes.byref(dst._image),
+            output,
+        )
+        return dst._check(status)
+
+    def rotate(self, dst: 'Image', degrees: int) -> 'Image':
+        '''Rotate this image into dst by a multiple of 90 degrees;
+        return dst.'''
+        if not dst.format == self.format:
+            raise ValueError('formats differ: {} != {}'.format(
+                self.format,
+                dst.format,
+            ))
+        if not degrees % 90 == 0:
+            raise ValueError('degrees must be a multiple of 90')
+        if degrees % 180 == 0:
+            size = (self.width, self.height)
+        else:
+            size = (self.height, self.width)
+        if not (dst.width, dst.height) == size:
+            raise ValueError('dst must be {}x{}'.format(*size))
+        status = _al_image_rotate(
+            ctypes.byref(self._image),
+            ctypes.byref(dst._image),
+            degrees,
+        )
+        return dst._check(status)
+
+    def convert(
+        self,
+        dst: 'Image',
+        output: Output = Output.AUTO,
+    ) -> 'Image':
+        '''Convert this image into dst, of the same size, in the format
+        of dst; return dst.'''
+        status = _al_image_convert_output(
+            ctypes.byref(self._image),
+            ctypes.byref(dst._image),
+            output,
+        )
+        return dst._check(status)
+
+    def resize(self, dst: 'Image') -> 'Image':
+        '''Scale this image to the size of dst (nearest neighbour),
+        in the same format; return dst.'''
+        status = _al_image_resize(
+            ctypes.byref(self._image),
+            ctypes.byref(dst._image),
+        )
+        return dst._check(status)
+
+    def __len__(self) -> int:
+        return self.nbytes
+
+    def __repr__(self) -> str:
+        return '<Image {}x{} stride={} format={}>'.format(
+            self.width,
+            self.height,
+            self.stride,
+            self.format.name,
+        )
+
+    def __del__(self) -> None:
+        if self._image.data:
+            _al_image_free(ctypes.byref(self._image))
+
+
+def batch(
+    operation: Operation,
+    src: typing.Sequence[Image],
+    dst: typing.Sequence[Image],
+    degrees: int = 0,
+) -> None:
+    '''Apply an operation to every pair (src[i], dst[i]) in one call.
+
+    libal spreads the images over one thread per CPU, with the GIL
+    released, so this is much faster than a loop over Image methods
+    for many small images or for long clips.
+    '''
+    if not len(src) == len(dst):
+        raise ValueError('src and dst differ in length')
+    if operation == Operation.ROTATE and not degrees % 90 == 0:
+        raise ValueError('degrees must be a multiple of 90')
+    for (i, (x, y)) in enumerate(zip(src, dst)):
+        if not operation == Operation.CONVERT and not x.format == y.format:
+            raise ValueError('formats differ at {}: {} != {}'.format(
+                i,
+                x.format,
+                y.format,
+            ))
+        if operation == Operation.COPY:
+            ok = x.width <= y.width and x.height <= y.height
+        elif operation == Operation.CONVERT:
+            ok = (x.width, x.height) == (y.width, y.height)
+        elif operation == Operation.ROTATE and not degrees % 180 == 0:
+            ok = (x.height, x.width) == (y.width, y.height)
+        elif operation == Operation.ROTATE:
+            ok = (x.width, x.height) == (y.width, y.height)
+        else:
+            ok = True
+        if not ok:
+            raise ValueError('sizes differ at {}: {}x{}, {}x{}'.format(
+                i,
+                x.width,
+                x.height,
+                y.width,
+                y.height,
+            ))
+    n = len(src)
+    op = _AlImageOp(operation=operation, degrees=degrees)
+    src_array = (_AlImage * n)(*[x._image for x in src])
+    dst_array = (_AlImage * n)(*[x._image for x in dst])
+    status = _al_image_batch(ctypes.byref(op), src_array, dst_array, n)
+    if not status == Status.OK:
+        raise AlException(str(status))
@@ -0,0 +1,154 @@
+# This file is part of Aluminium Library.
+#
+# Aluminium Library is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by the
+# Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# Aluminium Library is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+# See the GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License along
+# with Aluminium Library. If not, see <https://www.gnu.org/licenses/>.
+
+
+'''The Aluminium Library metrics module.'''
+
+
+__all__ = [
+    'Metrics',
+]
+
+
+import ctypes
+import typing
+
+from .. import (
+    AlException,
+    libal,
+    Status,
+)
+from ..camera import (
+    _AlCamera,
+    Camera,
+)
+
+
+# struct al_metrics;
+class _AlMetrics(ctypes.Structure):
+    pass
+
+
+# enum al_status al_metrics_new(struct al_metrics **, const char *, int);
+_al_metrics_new = libal.al_metrics_new
+_al_metrics_new.restype = ctypes.c_int
+_al_metrics_new.argtypes = [
+    ctypes.POINTER(ctypes.POINTER(_AlMetrics)),
+    ctypes.c_char_p,
+    ctypes.c_int,
+]
+
+# void al_metrics_free(struct al_metrics *);
+_al_metrics_free = libal.al_metrics_free
+_al_metrics_free.restype = None
+_al_metrics_free.argtypes = [
+    ctypes.POINTER(_AlMetrics),
+]
+
+# enum al_status al_metrics_get_port(struct al_metrics *, int *);
+_al_metrics_get_port = libal.al_metrics_get_port
+_al_metrics_get_port.restype = ctypes.c_int
+_al_metrics_get_port.argtypes = [
+    ctypes.POINTER(_AlMetrics),
+    ctypes.POINTER(ctypes.c_int),
+]
+
+# enum al_status al_metrics_add_camera(
+#   struct al_metrics *,
+#   struct al_camera *,
+#   const char *
+# );
+_al_metrics_add_camera = libal.al_metrics_add_camera
+_al_metrics_add_camera.restype = ctypes.c_int
+_al_metrics_add_camera.argtypes = [
+    ctypes.POINTER(_AlMetrics),
+    ctypes.POINTER(_AlCamera),
+    ctypes.c_char_p,
+]
+
+# enum al_status al_metrics_remove_camera(
+#   struct al_metrics *,
+#   struct al_camera *
+# );
+_al_metrics_remove_camera = libal.al_metrics_remove_camera
+_al_metrics_remove_camera.restype = ctypes.c_int
+_al_metrics_remove_camera.argtypes = [
+    ctypes.POINTER(_AlMetrics),
+    ctypes.POINTER(_AlCamera),
+]
+
+
+class Metrics:
+    '''Serve the statistics of libal and of its cameras to Prometheus,
+    at http://address:port/metrics, from a thread of its own.
+
+    The memory accounting is always exported; add the cameras to export
+    with add_camera, and remove them before they are closed.
+    '''
+
+    def __init__(
+        self,
+        address: typing.Optional[str] = None,
+        port: int = 0,
+    ) -> None:
+
+        self._metrics = ctypes.POINTER(_AlMetrics)()
+        self._cameras: typing.List[Camera] = []
+
+        status = _al_metrics_new(
+            ctypes.byref(self._metrics),
+            address.encode('utf-8') if address is not None else None,
+            port,
+        )
+        if not status == Status.OK:
+            raise AlException(str(status))
+
+    @property
+    def port(self) -> int:
+        '''Return the port the exporter is listening on.'''
+        assert self._metrics
+        port = ctypes.c_int()
+        status = _al_metrics_get_port(self._metrics, ctypes.byref(port))
+        if not status == Status.OK:
+            raise AlException(str(status))
+        return port.value
+
+    def add_camera(
+        self,
+        camera: Camera,
+        name: typing.Optional[str] = None,
+    ) -> None:
+        '''Export the statistics of a camera, labelled camera="name".'''
+        assert self._metrics
+        status = _al_metrics_add_camera(
+            self._metrics,
+            camera._cam,
+            name.encode('utf-8') if name is not None else None,
+        )
+        if not status == Status.OK:
+            raise AlException(str(status))
+        # Keep the camera open for as long as it is exported.
+        self._cameras.append(camera)
+
+    def remove_camera(self, camera: Camera) -> None:
+        assert self._metrics
+        status = _al_metrics_remove_camera(self._metrics, camera._cam)
+        if not status == Status.OK:
+            raise AlException(str(status))
+        self._cameras.remove(camera)
+
+    def __del__(self) -> None:
+        if self._metrics:
+            _al_metrics_free(self._metrics)
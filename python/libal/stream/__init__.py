@@ -0,0 +1,159 @@
+# This file is part of Aluminium Library.
+#
+# Aluminium Library is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by the
+# Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# Aluminium Library is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+# See the GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License along
+# with Aluminium Library. If not, see <https://www.gnu.org/licenses/>.
+
+
+'''The Aluminium Library frame streaming module.'''
+
+
+__all__ = [
+    'StreamFormat',
+    'Stream',
+]
+
+
+import ctypes
+import enum
+import typing
+
+from .. import (
+    AlException,
+    libal,
+    Status,
+)
+from ..camera import (
+    _AlCamera,
+    Camera,
+)
+
+
+class StreamFormat(enum.IntEnum):
+    NV12 = 0
+    MJPEG = 1
+
+
+# struct al_stream;
+class _AlStream(ctypes.Structure):
+    pass
+
+
+# enum al_status al_stream_new(
+#   struct al_stream **,
+#   enum al_stream_format,
+#   const char *,
+#   int
+# );
+_al_stream_new = libal.al_stream_new
+_al_stream_new.restype = ctypes.c_int
+_al_stream_new.argtypes = [
+    ctypes.POINTER(ctypes.POINTER(_AlStream)),
+    ctypes.c_int,
+    ctypes.c_char_p,
+    ctypes.c_int,
+]
+
+# void al_stream_free(struct al_stream *);
+_al_stream_free = libal.al_stream_free
+_al_stream_free.restype = None
+_al_stream_free.argtypes = [
+    ctypes.POINTER(_AlStream),
+]
+
+# enum al_status al_stream_get_port(struct al_stream *, int *);
+_al_stream_get_port = libal.al_stream_get_port
+_al_stream_get_port.restype = ctypes.c_int
+_al_stream_get_port.argtypes = [
+    ctypes.POINTER(_AlStream),
+    ctypes.POINTER(ctypes.c_int),
+]
+
+# enum al_status al_stream_poll(struct al_stream *, int);
+_al_stream_poll = libal.al_stream_poll
+_al_stream_poll.restype = ctypes.c_int
+_al_stream_poll.argtypes = [
+    ctypes.POINTER(_AlStream),
+    ctypes.c_int,
+]
+
+# enum al_status al_stream_send_camera(
+#   struct al_stream *,
+#   struct al_camera *
+# );
+_al_stream_send_camera = libal.al_stream_send_camera
+_al_stream_send_camera.restype = ctypes.c_int
+_al_stream_send_camera.argtypes = [
+    ctypes.POINTER(_AlStream),
+    ctypes.POINTER(_AlCamera),
+]
+
+
+class Stream:
+    '''Serve frames to local or LAN clients.
+
+    With StreamFormat.MJPEG, open http://address:port/ in a browser.
+    With StreamFormat.NV12, each frame is sent over plain TCP with a
+    24-byte header (see stream.c).
+    '''
+
+    def __init__(
+        self,
+        format: StreamFormat = StreamFormat.MJPEG,
+        address: typing.Optional[str] = None,
+        port: int = 0,
+    ) -> None:
+
+        self._stream = ctypes.POINTER(_AlStream)()
+
+        status = _al_stream_new(
+            ctypes.byref(self._stream),
+            format,
+            address.encode('utf-8') if address is not None else None,
+            port,
+        )
+        if not status == Status.OK:
+            raise AlException(str(status))
+
+    @property
+    def port(self) -> int:
+        '''Return the port the stream is listening on.'''
+        assert self._stream
+        port = ctypes.c_int()
+        status = _al_stream_get_port(self._stream, ctypes.byref(port))
+        if not status == Status.OK:
+            raise AlException(str(status))
+        return port.value
+
+    def poll(self, timeout: int = 0) -> None:
+        '''Accept clients and service their sockets.
+
+        Waits at most 'timeout' milliseconds, or indefinitely if negative.
+        '''
+        assert self._stream
+        status = _al_stream_poll(self._stream, timeout)
+        if not status == Status.OK:
+            raise AlException(str(status))
+
+    def send_camera(self, camera: Camera) -> None:
+        '''Send the camera's latest frame to every client, if it is new.
+
+        The frame is not consumed: Camera.rgba, etc. still return it.
+        '''
+        assert self._stream
+        status = _al_stream_send_camera(self._stream, camera._cam)
+        if not status == Status.OK:
+            raise AlException(str(status))
+
+    def __del__(self) -> None:
+        if self._stream:
+            _al_stream_free(self._stream)
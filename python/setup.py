@@ -3,11 +3,21 @@
 import sys
 
 try:
-    from setuptools import setup
+    from setuptools import Extension, setup
 except ImportError:
-    from distutils.core import setup
+    from distutils.core import Extension, setup
 
 setup(
     py_modules=['libal'],
+    # Optional: libal falls back to ctypes if this fails to build.
+    ext_modules=[
+        Extension(
+            'libal._libal',
+            sources=['libal/_libal.c'],
+            # al.h, in a checkout; make sdist copies it into libal/.
+            include_dirs=['..'],
+            optional=True,
+        ),
+    ],
     platforms=['macosx-11.0-arm64'] if 'bdist_wheel' in sys.argv else [],
 )
@@ -0,0 +1,179 @@
+/* Copyright 2023-2025, Mansour Moufid <mansourmoufid@gmail.com> */
+
+/*
+ * This file is part of Aluminium Library.
+ *
+ * Aluminium Library is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Aluminium Library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with Aluminium Library. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <assert.h>
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "al.h"
+#include "stats.h"
+
+static inline
+uint64_t
+_load(atomic_uint_least64_t *counter)
+{
+    return atomic_load_explicit(counter, memory_order_relaxed);
+}
+
+// Take a snapshot of the counters; they may be updated in between.
+__attribute__((visibility("hidden")))
+void
+al_stats_get(struct al_stats *stats, struct al_camera_stats *x)
+{
+    *x = (struct al_camera_stats) {
+        .frames = _load(&stats->frames),
+        .delivered = _load(&stats->delivered),
+        .dropped = _load(&stats->dropped),
+        .unread = _load(&stats->unread),
+        .bytes_copied = _load(&stats->bytes),
+        .process_ns = _load(&stats->process.ns),
+        .process_max_ns = _load(&stats->process.max_ns),
+        .repack_ns = _load(&stats->repack.ns),
+        .repack_max_ns = _load(&stats->repack.max_ns),
+        .convert_ns = _load(&stats->convert.ns),
+        .convert_max_ns = _load(&stats->convert.max_ns),
+        .latency_ns = _load(&stats->latency_ns),
+    };
+}
+
+// The last frame delivered to the application.
+__attribute__((visibility("hidden")))
+void
+al_stats_get_frame(struct al_stats *stats, struct al_camera_frame *frame)
+{
+    *frame = (struct al_camera_frame) {
+        .sequence = _load(&stats->delivered_sequence),
+        .timestamp = _load(&stats->delivered_timestamp),
+    };
+}
+
+// The largest value that falls in a bucket.
+static
+uint64_t
+_highest(size_t i)
+{
+    const size_t n = 1 << AL_HISTOGRAM_PRECISION;
+    if (i < n)
+        return i;
+    const size_t shift = (i >> AL_HISTOGRAM_PRECISION) - 1;
+    const uint64_t lowest = (uint64_t) (n + i % n) << shift;
+    return lowest + ((uint64_t) 1 << shift) - 1;
+}
+
+/*
+ * Return the value below which the given percentage (0 to 100) of
+ * recorded values fall, or 0 if there are none.
+ */
+__attribute__((visibility("hidden")))
+uint64_t
+al_histogram_percentile(struct al_histogram *histogram, double percentile)
+{
+    assert(percentile >= 0 && percentile <= 100);
+    uint64_t counts[AL_HISTOGRAM_SIZE];
+    uint64_t total = 0;
+    for (size_t i = 0; i < AL_HISTOGRAM_SIZE; i++) {
+        counts[i] = _load(&histogram->buckets[i]);
+        total += counts[i];
+    }
+    if (total == 0)
+        return 0;
+    // The rank of the value, rounded up, from 1 to total.
+    const double x = percentile / 100 * (double) total;
+    uint64_t rank = (uint64_t) x;
+    if ((double) rank < x || rank == 0)
+        rank++;
+    uint64_t sum = 0;
+    for (size_t i = 0; i < AL_HISTOGRAM_SIZE; i++) {
+        sum += counts[i];
+        if (sum >= rank)
+            return _highest(i);
+    }
+    return _highest(AL_HISTOGRAM_SIZE - 1);
+}
+
+/*
+ * Count the recorded values at most each of n bounds, in increasing
+ * order, like the buckets of a Prometheus histogram. A value is counted
+ * by the whole bucket it falls in, so the bounds are as precise as the
+ * buckets.
+ */
+__attribute__((visibility("hidden")))
+void
+al_histogram_cumulative(
+    struct al_histogram *histogram,
+    const uint64_t *bounds,
+    uint64_t *counts,
+    size_t n
+) {
+    assert(bounds != NULL || n == 0);
+    assert(counts != NULL || n == 0);
+    uint64_t sum = 0;
+    size_t j = 0;
+    for (size_t i = 0; i < AL_HISTOGRAM_SIZE && j < n; i++) {
+        const uint64_t highest = _highest(i);
+        while (j < n && bounds[j] < highest)
+            counts[j++] = sum;
+        sum += _load(&histogram->buckets[i]);
+    }
+    while (j < n)
+        counts[j++] = sum;
+}
+
+#if defined(TEST)
+
+#include <stdlib.h> // calloc, free
+
+int
+main(void)
+{
+    // Buckets are contiguous and values within 1/32 of their bucket.
+    size_t last = 0;
+    for (uint64_t x = 1; x < ((uint64_t) 1 << 20); x++) {
+        const size_t i = al_histogram_index(x);
+        assert(i == last || i == last + 1);
+        assert(_highest(i) >= x);
+        assert(_highest(i) - x <= x / 32);
+        last = i;
+    }
+    assert(al_histogram_index(UINT64_MAX) == AL_HISTOGRAM_SIZE - 1);
+
+    struct al_histogram *histogram = calloc(1, sizeof (struct al_histogram));
+    assert(histogram != NULL);
+    assert(al_histogram_percentile(histogram, 50) == 0);
+    for (uint64_t x = 1; x <= 1000; x++)
+        al_histogram_record(histogram, x * 1000);
+    const uint64_t p50 = al_histogram_percentile(histogram, 50);
+    const uint64_t p99 = al_histogram_percentile(histogram, 99);
+    assert(p50 >= 500000 && p50 <= 500000 + 500000 / 32);
+    assert(p99 >= 990000 && p99 <= 990000 + 990000 / 32);
+    assert(al_histogram_percentile(histogram, 0) == _highest(al_histogram_index(1000)));
+    assert(al_histogram_percentile(histogram, 100) >= 1000000);
+    const uint64_t bounds[] = {0, 500000, 2000000, UINT64_MAX};
+    uint64_t counts[4];
+    al_histogram_cumulative(histogram, bounds, counts, 4);
+    assert(counts[0] == 0);
+    assert(counts[1] >= 500 - 500 / 32 && counts[1] <= 500);
+    assert(counts[2] == 1000 && counts[3] == 1000);
+    free(histogram);
+
+    return 0;
+}
+
+#endif
@@ -0,0 +1,210 @@
+/* Copyright 2023-2025, Mansour Moufid <mansourmoufid@gmail.com> */
+
+/*
+ * This file is part of Aluminium Library.
+ *
+ * Aluminium Library is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Aluminium Library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with Aluminium Library. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <stdatomic.h>
+#include <stdint.h>
+#include <time.h> // clock_gettime
+
+#include "al.h"
+
+/*
+ * Pipeline statistics of a camera (see al_camera_get_stats).
+ *
+ * The camera callback updates the counters with relaxed atomics, without
+ * the frame lock, and readers take a snapshot at any time. A stage is
+ * timed from the end of the previous one, so timing a frame costs one
+ * call to clock_gettime per stage.
+ */
+struct al_stats_stage {
+    atomic_uint_least64_t ns;
+    atomic_uint_least64_t max_ns;
+};
+
+/*
+ * A histogram of latencies in nanoseconds, with buckets of logarithmic
+ * size like HdrHistogram: values below 2^PRECISION have their own
+ * bucket, and larger ones are rounded down to PRECISION significant bits
+ * (within 3%), up to 2^RANGE ns (about 18 minutes).
+ */
+#define AL_HISTOGRAM_PRECISION 5
+#define AL_HISTOGRAM_RANGE 40
+#define AL_HISTOGRAM_SIZE \
+    ((AL_HISTOGRAM_RANGE - AL_HISTOGRAM_PRECISION + 1) << AL_HISTOGRAM_PRECISION)
+
+struct al_histogram {
+    atomic_uint_least64_t buckets[AL_HISTOGRAM_SIZE];
+};
+
+struct al_stats {
+    atomic_uint_least64_t frames; // also the sequence number of the last
+    atomic_uint_least64_t timestamp; // capture time of the last frame
+    atomic_uint_least64_t delivered;
+    atomic_uint_least64_t delivered_sequence;
+    atomic_uint_least64_t delivered_timestamp;
+    atomic_uint_least64_t dropped;
+    atomic_uint_least64_t unread;
+    atomic_uint_least64_t bytes;
+    struct al_stats_stage process;
+    struct al_stats_stage repack;
+    struct al_stats_stage convert;
+    atomic_uint_least64_t latency_ns; // the sum of the latencies below
+    struct al_histogram latency; // from capture to delivery
+};
+
+static inline
+uint64_t
+al_stats_now(void)
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (uint64_t) t.tv_sec * 1000000000 + (uint64_t) t.tv_nsec;
+}
+
+static inline
+void
+al_stats_add(atomic_uint_least64_t *counter, uint64_t n)
+{
+    atomic_fetch_add_explicit(counter, n, memory_order_relaxed);
+}
+
+// Add the time since start to a stage; return the time now.
+static inline
+uint64_t
+al_stats_time(struct al_stats_stage *stage, uint64_t start)
+{
+    const uint64_t now = al_stats_now();
+    const uint64_t ns = now - start;
+    atomic_fetch_add_explicit(&stage->ns, ns, memory_order_relaxed);
+    uint_least64_t max = atomic_load_explicit(
+        &stage->max_ns,
+        memory_order_relaxed
+    );
+    while (ns > max) {
+        if (atomic_compare_exchange_weak_explicit(
+            &stage->max_ns,
+            &max,
+            ns,
+            memory_order_relaxed,
+            memory_order_relaxed
+        ))
+            break;
+    }
+    return now;
+}
+
+static inline
+size_t
+al_histogram_index(uint64_t x)
+{
+    const uint64_t max = ((uint64_t) 1 << AL_HISTOGRAM_RANGE) - 1;
+    if (x > max)
+        x = max;
+    if (x < (1 << AL_HISTOGRAM_PRECISION))
+        return (size_t) x;
+    const int shift = 63 - __builtin_clzll(x) - AL_HISTOGRAM_PRECISION;
+    return ((size_t) (shift + 1) << AL_HISTOGRAM_PRECISION)
+        + (size_t) (x >> shift) - (1 << AL_HISTOGRAM_PRECISION);
+}
+
+static inline
+void
+al_histogram_record(struct al_histogram *histogram, uint64_t x)
+{
+    al_stats_add(&histogram->buckets[al_histogram_index(x)], 1);
+}
+
+uint64_t al_histogram_percentile(struct al_histogram *, double);
+void al_histogram_cumulative(
+    struct al_histogram *,
+    const uint64_t *,
+    uint64_t *,
+    size_t
+);
+
+/*
+ * A new frame, captured at the given time, was made available; call with
+ * the frame lock held, before setting the read flag. Returns its sequence
+ * number, starting at 1.
+ */
+static inline
+uint64_t
+al_stats_frame(struct al_stats *stats, uint64_t timestamp)
+{
+    atomic_store_explicit(&stats->timestamp, timestamp, memory_order_relaxed);
+    return atomic_fetch_add_explicit(
+        &stats->frames,
+        1,
+        memory_order_relaxed
+    ) + 1;
+}
+
+/*
+ * The last frame was delivered to the application at the given time, on
+ * the same clock as its capture time.
+ */
+static inline
+void
+al_stats_deliver(struct al_stats *stats, uint64_t now)
+{
+    const uint64_t sequence = atomic_load_explicit(
+        &stats->frames,
+        memory_order_relaxed
+    );
+    const uint64_t timestamp = atomic_load_explicit(
+        &stats->timestamp,
+        memory_order_relaxed
+    );
+    atomic_store_explicit(
+        &stats->delivered_sequence,
+        sequence,
+        memory_order_relaxed
+    );
+    atomic_store_explicit(
+        &stats->delivered_timestamp,
+        timestamp,
+        memory_order_relaxed
+    );
+    const uint64_t latency = now > timestamp ? now - timestamp : 0;
+    al_stats_add(&stats->delivered, 1);
+    al_stats_add(&stats->latency_ns, latency);
+    al_histogram_record(&stats->latency, latency);
+}
+
+// The size of the pixels of an image, without the padding.
+static inline
+uint64_t
+al_stats_image_bytes(const struct al_image *image)
+{
+    const uint64_t n = (uint64_t) image->width * image->height;
+    switch (image->format) {
+        case AL_COLOR_FORMAT_YUV420SP:
+        case AL_COLOR_FORMAT_YUV420P:
+            return n * 3 / 2;
+        case AL_COLOR_FORMAT_RGBA:
+            return n * 4;
+        case AL_COLOR_FORMAT_UNKNOWN:
+            break;
+    }
+    return 0;
+}
+
+void al_stats_get(struct al_stats *, struct al_camera_stats *);
+void al_stats_get_frame(struct al_stats *, struct al_camera_frame *);
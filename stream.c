@@ -0,0 +1,835 @@
+/* Copyright 2023-2025, Mansour Moufid <mansourmoufid@gmail.com> */
+
+/*
+ * This file is part of Aluminium Library.
+ *
+ * Aluminium Library is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Aluminium Library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with Aluminium Library. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*
+ * A single-threaded frame server.
+ *
+ * The caller drives it from its own loop: al_stream_poll accepts clients
+ * and services their sockets, and al_stream_send (or al_stream_send_camera)
+ * publishes a frame to every connected client. Each frame is packed or
+ * encoded once, into a reference-counted buffer shared by all clients.
+ * A client that is still busy with an earlier frame skips the new one
+ * instead of queueing it.
+ *
+ * AL_STREAM_FORMAT_NV12 is raw TCP. Every frame is preceded by a 24-byte
+ * header, in network byte order:
+ *
+ *      char magic[4];      "NV12"
+ *      uint32_t width;
+ *      uint32_t height;
+ *      uint32_t size;      of the payload, width * height * 3 / 2
+ *      uint64_t sequence;
+ *
+ * AL_STREAM_FORMAT_MJPEG is HTTP, multipart/x-mixed-replace, and can be
+ * viewed in a browser.
+ */
+
+#if defined(DEBUG)
+#undef NDEBUG
+#endif
+
+#include <assert.h>
+#include <errno.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h> // calloc, free, realloc
+#include <string.h> // memcpy, strerror
+
+#include "al.h"
+
+#if defined(__linux__)
+
+#include <arpa/inet.h> // htonl, htons, inet_pton
+#include <fcntl.h> // fcntl, O_NONBLOCK
+#include <netinet/in.h> // struct sockaddr_in, INADDR_LOOPBACK
+#include <stdio.h> // snprintf
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <sys/uio.h> // struct iovec
+#include <unistd.h> // close
+
+#include "common.h" // DEBUG
+#include "jpeg.h"
+
+#define N_CLIENTS 64
+#define N_EVENTS 16
+
+#define JPEG_QUALITY 75
+
+#define BOUNDARY "alframe"
+
+static const char http_response[] =
+    "HTTP/1.0 200 OK\r\n"
+    "Cache-Control: no-cache, no-store\r\n"
+    "Pragma: no-cache\r\n"
+    "Connection: close\r\n"
+    "Content-Type: multipart/x-mixed-replace; boundary=" BOUNDARY "\r\n"
+    "\r\n";
+
+struct frame {
+    struct frame *next;
+    size_t refs;
+    uint8_t header[128];
+    size_t header_size;
+    uint8_t *data;
+    size_t size;
+    size_t capacity;
+};
+
+struct client {
+    int fd;
+    bool writing;
+    struct frame *frame;
+    size_t offset;
+};
+
+struct al_stream {
+    enum al_stream_format format;
+    int listener;
+    int epoll;
+    int port;
+    struct al_jpeg *jpeg;
+    struct client clients[N_CLIENTS];
+    size_t n_clients;
+    struct frame *frames;
+    uint64_t sequence;
+    uint64_t camera_sequence; // of the last camera frame sent
+    struct al_image image; // the camera frame, copied under its lock
+};
+
+enum flush_status {
+    FLUSH_DONE,
+    FLUSH_PENDING,
+    FLUSH_ERROR,
+};
+
+static inline
+void
+put_u32(uint8_t *x, uint32_t y)
+{
+    y = htonl(y);
+    memcpy(x, &y, sizeof y);
+}
+
+static
+struct frame *
+frame_get(struct al_stream *stream, size_t capacity)
+{
+    struct frame *frame = stream->frames;
+    if (frame != NULL) {
+        stream->frames = frame->next;
+    } else {
+        errno = 0;
+        frame = calloc(1, sizeof (struct frame));
+        if (frame == NULL) {
+            DEBUG("calloc: errno=%i [%s]", errno, strerror(errno));
+            return NULL;
+        }
+    }
+    frame->next = NULL;
+    if (frame->capacity < capacity) {
+        errno = 0;
+        uint8_t *data = realloc(frame->data, capacity);
+        if (data == NULL) {
+            DEBUG("realloc: errno=%i [%s]", errno, strerror(errno));
+            frame->next = stream->frames;
+            stream->frames = frame;
+            return NULL;
+        }
+        frame->data = data;
+        frame->capacity = capacity;
+    }
+    frame->refs = 1;
+    frame->header_size = 0;
+    frame->size = 0;
+    return frame;
+}
+
+static
+void
+frame_put(struct al_stream *stream, struct frame *frame)
+{
+    assert(frame->refs > 0);
+    frame->refs--;
+    if (frame->refs == 0) {
+        frame->next = stream->frames;
+        stream->frames = frame;
+    }
+}
+
+static
+enum al_status
+set_nonblocking(int fd)
+{
+    int flags = fcntl(fd, F_GETFL);
+    if (flags < 0 || fcntl(fd, F_SETFL, flags | O_NONBLOCK) < 0) {
+        DEBUG("fcntl: errno=%i [%s]", errno, strerror(errno));
+        return AL_ERROR;
+    }
+    (void) fcntl(fd, F_SETFD, FD_CLOEXEC);
+    return AL_OK;
+}
+
+static
+void
+drop_client(struct al_stream *stream, struct client *client)
+{
+    assert(client->fd >= 0);
+    (void) epoll_ctl(stream->epoll, EPOLL_CTL_DEL, client->fd, NULL);
+    close(client->fd);
+    client->fd = -1;
+    client->writing = false;
+    if (client->frame != NULL)
+        frame_put(stream, client->frame);
+    client->frame = NULL;
+    client->offset = 0;
+    assert(stream->n_clients > 0);
+    stream->n_clients--;
+}
+
+static
+enum al_status
+want_write(struct al_stream *stream, struct client *client, bool write)
+{
+    if (client->writing == write)
+        return AL_OK;
+    struct epoll_event event = {
+        .events = EPOLLIN | (write ? EPOLLOUT : 0),
+        .data.ptr = client,
+    };
+    if (epoll_ctl(stream->epoll, EPOLL_CTL_MOD, client->fd, &event) < 0) {
+        DEBUG("epoll_ctl: errno=%i [%s]", errno, strerror(errno));
+        return AL_ERROR;
+    }
+    client->writing = write;
+    return AL_OK;
+}
+
+static
+enum flush_status
+flush_client(struct al_stream *stream, struct client *client)
+{
+    while (client->frame != NULL) {
+        struct frame *frame = client->frame;
+        struct iovec iov[2];
+        size_t n = 0;
+        size_t offset = client->offset;
+        if (offset < frame->header_size) {
+            iov[n].iov_base = frame->header + offset;
+            iov[n].iov_len = frame->header_size - offset;
+            n++;
+            offset = 0;
+        } else {
+            offset -= frame->header_size;
+        }
+        iov[n].iov_base = frame->data + offset;
+        iov[n].iov_len = frame->size - offset;
+        n++;
+        // writev, without raising SIGPIPE when a client goes away
+        struct msghdr message = {
+            .msg_iov = iov,
+            .msg_iovlen = n,
+        };
+        ssize_t written = sendmsg(client->fd, &message, MSG_NOSIGNAL);
+        if (written < 0) {
+            if (errno == EINTR)
+                continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+                return FLUSH_PENDING;
+            return FLUSH_ERROR;
+        }
+        client->offset += (size_t) written;
+        if (client->offset == frame->header_size + frame->size) {
+            frame_put(stream, frame);
+            client->frame = NULL;
+            client->offset = 0;
+        }
+    }
+    return FLUSH_DONE;
+}
+
+static
+void
+accept_clients(struct al_stream *stream)
+{
+    for (;;) {
+        int fd = accept(stream->listener, NULL, NULL);
+        if (fd < 0) {
+            if (errno == EINTR)
+                continue;
+            if (!(errno == EAGAIN || errno == EWOULDBLOCK)) {
+                DEBUG("accept: errno=%i [%s]", errno, strerror(errno));
+            }
+            return;
+        }
+        struct client *client = NULL;
+        for (size_t i = 0; i < N_CLIENTS; i++) {
+            if (stream->clients[i].fd < 0) {
+                client = &stream->clients[i];
+                break;
+            }
+        }
+        if (client == NULL || set_nonblocking(fd) != AL_OK) {
+            close(fd);
+            continue;
+        }
+        if (stream->format == AL_STREAM_FORMAT_MJPEG) {
+            // the socket buffer is empty, so this is not a short write
+            ssize_t n = send(
+                fd,
+                http_response,
+                sizeof http_response - 1,
+                MSG_NOSIGNAL
+            );
+            if (n != (ssize_t) (sizeof http_response - 1)) {
+                close(fd);
+                continue;
+            }
+        }
+        struct epoll_event event = {
+            .events = EPOLLIN,
+            .data.ptr = client,
+        };
+        if (epoll_ctl(stream->epoll, EPOLL_CTL_ADD, fd, &event) < 0) {
+            DEBUG("epoll_ctl: errno=%i [%s]", errno, strerror(errno));
+            close(fd);
+            continue;
+        }
+        client->fd = fd;
+        client->writing = false;
+        client->frame = NULL;
+        client->offset = 0;
+        stream->n_clients++;
+    }
+}
+
+static
+bool
+read_client(struct client *client)
+{
+    // requests are not parsed, only drained
+    uint8_t buffer[1024];
+    for (;;) {
+        ssize_t n = recv(client->fd, buffer, sizeof buffer, 0);
+        if (n > 0)
+            continue;
+        if (n == 0)
+            return false;
+        if (errno == EINTR)
+            continue;
+        return errno == EAGAIN || errno == EWOULDBLOCK;
+    }
+}
+
+enum al_status
+al_stream_new(
+    struct al_stream **stream,
+    enum al_stream_format format,
+    const char *address,
+    int port
+) {
+    assert(stream != NULL);
+    enum al_status ret = AL_ERROR;
+
+    switch (format) {
+        case AL_STREAM_FORMAT_NV12:
+        case AL_STREAM_FORMAT_MJPEG:
+            break;
+        default:
+            return AL_ERROR;
+    }
+    if (port < 0 || port > 0xffff)
+        return AL_ERROR;
+
+    struct sockaddr_in addr = {
+        .sin_family = AF_INET,
+        .sin_port = htons((uint16_t) port),
+        .sin_addr.s_addr = htonl(INADDR_LOOPBACK),
+    };
+    if (address != NULL) {
+        if (inet_pton(AF_INET, address, &addr.sin_addr) != 1)
+            return AL_ERROR;
+    }
+
+    errno = 0;
+    *stream = calloc(1, sizeof (struct al_stream));
+    if (*stream == NULL) {
+        DEBUG("calloc: errno=%i [%s]", errno, strerror(errno));
+        ret = AL_NOMEMORY;
+        goto error0;
+    }
+    (*stream)->format = format;
+    for (size_t i = 0; i < N_CLIENTS; i++)
+        (*stream)->clients[i].fd = -1;
+
+    if (format == AL_STREAM_FORMAT_MJPEG) {
+        (*stream)->jpeg = al_jpeg_new(JPEG_QUALITY);
+        if ((*stream)->jpeg == NULL) {
+            ret = AL_NOMEMORY;
+            goto error1;
+        }
+    }
+
+    (*stream)->listener = socket(AF_INET, SOCK_STREAM, 0);
+    if ((*stream)->listener < 0) {
+        DEBUG("socket: errno=%i [%s]", errno, strerror(errno));
+        goto error2;
+    }
+    int yes = 1;
+    (void) setsockopt(
+        (*stream)->listener,
+        SOL_SOCKET,
+        SO_REUSEADDR,
+        &yes,
+        sizeof yes
+    );
+    if (bind((*stream)->listener, (struct sockaddr *) &addr, sizeof addr) < 0) {
+        DEBUG("bind: errno=%i [%s]", errno, strerror(errno));
+        goto error3;
+    }
+    if (listen((*stream)->listener, N_CLIENTS) < 0) {
+        DEBUG("listen: errno=%i [%s]", errno, strerror(errno));
+        goto error3;
+    }
+    if (set_nonblocking((*stream)->listener) != AL_OK)
+        goto error3;
+    socklen_t length = sizeof addr;
+    if (getsockname((*stream)->listener, (struct sockaddr *) &addr, &length) < 0) {
+        DEBUG("getsockname: errno=%i [%s]", errno, strerror(errno));
+        goto error3;
+    }
+    (*stream)->port = ntohs(addr.sin_port);
+
+    (*stream)->epoll = epoll_create(N_CLIENTS + 1);
+    if ((*stream)->epoll < 0) {
+        DEBUG("epoll_create: errno=%i [%s]", errno, strerror(errno));
+        goto error3;
+    }
+    (void) fcntl((*stream)->epoll, F_SETFD, FD_CLOEXEC);
+    struct epoll_event event = {
+        .events = EPOLLIN,
+        .data.ptr = NULL,
+    };
+    if (epoll_ctl((*stream)->epoll, EPOLL_CTL_ADD, (*stream)->listener, &event) < 0) {
+        DEBUG("epoll_ctl: errno=%i [%s]", errno, strerror(errno));
+        goto error4;
+    }
+
+    ret = AL_OK;
+    return ret;
+
+error4:
+    close((*stream)->epoll);
+error3:
+    close((*stream)->listener);
+error2:
+    al_jpeg_free((*stream)->jpeg);
+error1:
+    free(*stream);
+    *stream = NULL;
+error0:
+    return ret;
+}
+
+void
+al_stream_free(struct al_stream *stream)
+{
+    if (stream == NULL)
+        return;
+    for (size_t i = 0; i < N_CLIENTS; i++) {
+        if (stream->clients[i].fd >= 0)
+            drop_client(stream, &stream->clients[i]);
+    }
+    while (stream->frames != NULL) {
+        struct frame *frame = stream->frames;
+        stream->frames = frame->next;
+        free(frame->data);
+        free(frame);
+    }
+    close(stream->epoll);
+    close(stream->listener);
+    al_jpeg_free(stream->jpeg);
+    al_image_free(&stream->image);
+    free(stream);
+}
+
+enum al_status
+al_stream_get_port(struct al_stream *stream, int *port)
+{
+    assert(stream != NULL);
+    assert(port != NULL);
+    *port = stream->port;
+    return AL_OK;
+}
+
+enum al_status
+al_stream_poll(struct al_stream *stream, int timeout)
+{
+    assert(stream != NULL);
+    struct epoll_event events[N_EVENTS];
+    int n = epoll_wait(stream->epoll, events, N_EVENTS, timeout);
+    if (n < 0) {
+        if (errno == EINTR)
+            return AL_OK;
+        DEBUG("epoll_wait: errno=%i [%s]", errno, strerror(errno));
+        return AL_ERROR;
+    }
+    for (int i = 0; i < n; i++) {
+        struct client *client = events[i].data.ptr;
+        if (client == NULL) {
+            accept_clients(stream);
+            continue;
+        }
+        if (client->fd < 0)
+            continue;
+        if (events[i].events & (EPOLLERR | EPOLLHUP)) {
+            drop_client(stream, client);
+            continue;
+        }
+        if (events[i].events & EPOLLIN) {
+            if (!read_client(client)) {
+                drop_client(stream, client);
+                continue;
+            }
+        }
+        if (events[i].events & EPOLLOUT) {
+            switch (flush_client(stream, client)) {
+                case FLUSH_DONE:
+                    if (want_write(stream, client, false) != AL_OK)
+                        drop_client(stream, client);
+                    break;
+                case FLUSH_PENDING:
+                    break;
+                case FLUSH_ERROR:
+                    drop_client(stream, client);
+                    break;
+            }
+        }
+    }
+    return AL_OK;
+}
+
+static
+enum al_status
+pack_nv12(struct frame *frame, const struct al_image *image)
+{
+    const size_t width = image->width;
+    const size_t height = image->height;
+    const size_t stride = image->stride;
+    const uint8_t *src = image->data;
+    uint8_t *dst = frame->data;
+    for (size_t i = 0; i < height; i++)
+        memcpy(&dst[i * width], &src[i * stride], width);
+    dst += width * height;
+    src += height * stride;
+    switch (image->format) {
+        case AL_COLOR_FORMAT_YUV420SP:
+            for (size_t i = 0; i < height / 2; i++)
+                memcpy(&dst[i * width], &src[i * stride], width);
+            break;
+        case AL_COLOR_FORMAT_YUV420P:
+            {
+            const uint8_t *u = src;
+            const uint8_t *v = src + (height / 2) * (stride / 2);
+            for (size_t i = 0; i < height / 2; i++) {
+                for (size_t j = 0; j < width / 2; j++) {
+                    dst[i * width + 2 * j + 0] = u[i * (stride / 2) + j];
+                    dst[i * width + 2 * j + 1] = v[i * (stride / 2) + j];
+                }
+            }
+            }
+            break;
+        default:
+            return AL_NOTIMPLEMENTED;
+    }
+    frame->size = width * height * 3 / 2;
+
+    uint8_t *header = frame->header;
+    memcpy(header, "NV12", 4);
+    put_u32(header + 4, (uint32_t) width);
+    put_u32(header + 8, (uint32_t) height);
+    put_u32(header + 12, (uint32_t) frame->size);
+    frame->header_size = 24;
+    return AL_OK;
+}
+
+static
+size_t
+encode_jpeg(struct al_stream *stream, struct frame *frame, const struct al_image *image)
+{
+    const uint8_t *y = image->data;
+    const uint8_t *u = y + image->height * image->stride;
+    switch (image->format) {
+        case AL_COLOR_FORMAT_YUV420SP:
+            return al_jpeg_encode_yuv420(
+                stream->jpeg,
+                y, u, u + 1,
+                image->width,
+                image->height,
+                image->stride,
+                image->stride,
+                2,
+                frame->data,
+                frame->capacity
+            );
+        case AL_COLOR_FORMAT_YUV420P:
+            return al_jpeg_encode_yuv420(
+                stream->jpeg,
+                y, u, u + (image->height / 2) * (image->stride / 2),
+                image->width,
+                image->height,
+                image->stride,
+                image->stride / 2,
+                1,
+                frame->data,
+                frame->capacity
+            );
+        default:
+            return 0;
+    }
+}
+
+enum al_status
+al_stream_send(struct al_stream *stream, const struct al_image *image)
+{
+    assert(stream != NULL);
+    assert(image != NULL);
+    if (image->data == NULL)
+        return AL_ERROR;
+    if (image->width == 0 || image->height == 0)
+        return AL_ERROR;
+    if (image->width % 2 != 0 || image->height % 2 != 0)
+        return AL_ERROR;
+    if (image->stride < image->width)
+        return AL_ERROR;
+    switch (image->format) {
+        case AL_COLOR_FORMAT_YUV420SP:
+        case AL_COLOR_FORMAT_YUV420P:
+            break;
+        default:
+            return AL_NOTIMPLEMENTED;
+    }
+
+    // nobody is watching
+    if (stream->n_clients == 0)
+        return AL_OK;
+
+    struct frame *frame = NULL;
+    switch (stream->format) {
+        case AL_STREAM_FORMAT_NV12:
+            {
+            frame = frame_get(stream, image->width * image->height * 3 / 2);
+            if (frame == NULL)
+                return AL_NOMEMORY;
+            enum al_status status = pack_nv12(frame, image);
+            if (status != AL_OK) {
+                frame_put(stream, frame);
+                return status;
+            }
+            uint8_t *header = frame->header;
+            put_u32(header + 16, (uint32_t) (stream->sequence >> 32));
+            put_u32(header + 20, (uint32_t) (stream->sequence & 0xffffffff));
+            }
+            break;
+        case AL_STREAM_FORMAT_MJPEG:
+            {
+            // most frames compress to well under a byte per pixel
+            frame = frame_get(stream, image->width * image->height);
+            if (frame == NULL)
+                return AL_NOMEMORY;
+            frame->size = encode_jpeg(stream, frame, image);
+            if (frame->size == 0) {
+                frame_put(stream, frame);
+                frame = frame_get(
+                    stream,
+                    al_jpeg_max_size(image->width, image->height)
+                );
+                if (frame == NULL)
+                    return AL_NOMEMORY;
+                frame->size = encode_jpeg(stream, frame, image);
+            }
+            if (frame->size == 0) {
+                frame_put(stream, frame);
+                return AL_ERROR;
+            }
+            int n = snprintf(
+                (char *) frame->header,
+                sizeof frame->header,
+                "\r\n--" BOUNDARY "\r\n"
+                "Content-Type: image/jpeg\r\n"
+                "Content-Length: %zu\r\n"
+                "\r\n",
+                frame->size
+            );
+            assert(n > 0 && (size_t) n < sizeof frame->header);
+            frame->header_size = (size_t) n;
+            }
+            break;
+    }
+    stream->sequence++;
+
+    for (size_t i = 0; i < N_CLIENTS; i++) {
+        struct client *client = &stream->clients[i];
+        if (client->fd < 0)
+            continue;
+        // slow clients skip this frame
+        if (client->frame != NULL)
+            continue;
+        client->frame = frame;
+        client->offset = 0;
+        frame->refs++;
+        switch (flush_client(stream, client)) {
+            case FLUSH_DONE:
+                break;
+            case FLUSH_PENDING:
+                if (want_write(stream, client, true) != AL_OK)
+                    drop_client(stream, client);
+                break;
+            case FLUSH_ERROR:
+                drop_client(stream, client);
+                break;
+        }
+    }
+    frame_put(stream, frame);
+
+    return AL_OK;
+}
+
+/*
+ * Send the camera's latest frame, if there is a new one, in the camera's
+ * own YUV format when it has one.
+ *
+ * This does not consume the frame: the stream follows the camera's frame
+ * sequence number, and another reader still gets the frame from
+ * al_camera_get_rgba, etc.
+ */
+enum al_status
+al_stream_send_camera(struct al_stream *stream, struct al_camera *cam)
+{
+    assert(stream != NULL);
+    assert(cam != NULL);
+    // nobody is watching
+    if (stream->n_clients == 0)
+        return AL_OK;
+    enum al_color_format format = AL_COLOR_FORMAT_UNKNOWN;
+    enum al_status status = al_camera_get_color_format(cam, &format);
+    if (status != AL_OK)
+        return status;
+    switch (format) {
+        case AL_COLOR_FORMAT_YUV420SP:
+        case AL_COLOR_FORMAT_YUV420P:
+            break;
+        default:
+            format = AL_COLOR_FORMAT_YUV420SP;
+            break;
+    }
+    size_t width = 0;
+    size_t height = 0;
+    status = al_camera_get_width(cam, &width);
+    if (status != AL_OK)
+        return status;
+    status = al_camera_get_height(cam, &height);
+    if (status != AL_OK)
+        return status;
+    // no frame yet
+    if (width == 0 || height == 0)
+        return AL_OK;
+    // The camera rewrites its buffers, so the frame is copied here under
+    // the frame lock, then packed or encoded from this copy.
+    struct al_image *image = &stream->image;
+    if (
+        image->width != width ||
+        image->height != height ||
+        image->format != format
+    ) {
+        al_image_free(image);
+        image->width = width;
+        image->height = height;
+        image->format = format;
+        status = al_image_alloc(image);
+        if (status != AL_OK)
+            return status;
+    }
+    const uint64_t sequence = stream->camera_sequence;
+    status = al_camera_copy_into(cam, format, image, &stream->camera_sequence);
+    if (status != AL_OK)
+        return status;
+    if (stream->camera_sequence == sequence)
+        return AL_OK;
+    return al_stream_send(stream, image);
+}
+
+#else
+
+enum al_status
+al_stream_new(
+    struct al_stream **stream,
+    enum al_stream_format format,
+    const char *address,
+    int port
+) {
+    assert(stream != NULL);
+    (void) format;
+    (void) address;
+    (void) port;
+    *stream = NULL;
+    return AL_NOTIMPLEMENTED;
+}
+
+void
+al_stream_free(struct al_stream *stream)
+{
+    (void) stream;
+}
+
+enum al_status
+al_stream_get_port(struct al_stream *stream, int *port)
+{
+    (void) stream;
+    (void) port;
+    return AL_NOTIMPLEMENTED;
+}
+
+enum al_status
+al_stream_poll(struct al_stream *stream, int timeout)
+{
+    (void) stream;
+    (void) timeout;
+    return AL_NOTIMPLEMENTED;
+}
+
+enum al_status
+al_stream_send(struct al_stream *stream, const struct al_image *image)
+{
+    (void) stream;
+    (void) image;
+    return AL_NOTIMPLEMENTED;
+}
+
+enum al_status
+al_stream_send_camera(struct al_stream *stream, struct al_camera *cam)
+{
+    (void) stream;
+    (void) cam;
+    return AL_NOTIMPLEMENTED;
+}
+
+#endif
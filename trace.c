@@ -0,0 +1,212 @@
+/* Copyright 2023-2025, Mansour Moufid <mansourmoufid@gmail.com> */
+
+/*
+ * This file is part of Aluminium Library.
+ *
+ * Aluminium Library is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Aluminium Library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with Aluminium Library. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stddef.h>
+#include <stdio.h> // FILE, fopen, fprintf
+#include <stdlib.h> // getenv
+
+#include "al.h"
+#include "trace.h"
+
+#if defined(AL_TRACE)
+
+#include <errno.h>
+#include <inttypes.h> // PRIu64
+#include <pthread.h> // pthread_key_create, pthread_once, pthread_setspecific
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h> // strerror
+#include <time.h> // clock_gettime
+#include <unistd.h> // getpid
+
+#include "common.h" // DEBUG
+
+// Events per thread; older events are overwritten.
+#define AL_TRACE_SIZE (1 << 16)
+
+struct event {
+    uint64_t ns;
+    const char *name;
+    char phase;
+};
+
+/*
+ * Only the owner thread writes to its ring, and publishes each event by
+ * incrementing count. Rings are never freed, and are linked into a list
+ * that only grows; when a thread exits, its ring is marked free and the
+ * next new thread takes it over, events and tid included. So there are
+ * only as many rings as threads alive at once, and a tid in the trace
+ * names a ring rather than a thread.
+ */
+struct ring {
+    struct event events[AL_TRACE_SIZE];
+    atomic_size_t count;
+    atomic_bool free;
+    unsigned int tid;
+    struct ring *next;
+};
+
+static _Atomic(struct ring *) _rings = NULL;
+static atomic_uint _tids = 0;
+static _Thread_local struct ring *_ring = NULL;
+
+// Its destructor frees the ring of an exiting thread.
+static pthread_key_t _key;
+static pthread_once_t _key_once = PTHREAD_ONCE_INIT;
+static bool _key_ok = false;
+
+static
+void
+_release(void *arg)
+{
+    struct ring *ring = arg;
+    _ring = NULL;
+    atomic_store(&ring->free, true);
+}
+
+static
+void
+_key_init(void)
+{
+    _key_ok = pthread_key_create(&_key, _release) == 0;
+}
+
+static
+struct ring *
+_take_ring(void)
+{
+    for (struct ring *ring = atomic_load(&_rings); ring; ring = ring->next) {
+        if (atomic_exchange(&ring->free, false))
+            return ring;
+    }
+    return NULL;
+}
+
+static
+struct ring *
+_new_ring(void)
+{
+    pthread_once(&_key_once, _key_init);
+    struct ring *ring = _take_ring();
+    if (ring == NULL) {
+        ring = calloc(1, sizeof (struct ring));
+        if (ring == NULL)
+            return NULL;
+        atomic_init(&ring->count, 0);
+        atomic_init(&ring->free, false);
+        ring->tid = atomic_fetch_add(&_tids, 1) + 1;
+        ring->next = atomic_load(&_rings);
+        while (!atomic_compare_exchange_weak(&_rings, &ring->next, ring))
+            continue;
+    }
+    // Without the key, the ring stays with this thread for good.
+    if (_key_ok)
+        (void) pthread_setspecific(_key, ring);
+    return ring;
+}
+
+__attribute__((visibility("hidden")))
+void
+al_trace_event(const char *name, char phase)
+{
+    if (_ring == NULL) {
+        _ring = _new_ring();
+        if (_ring == NULL)
+            return;
+    }
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    const size_t i = atomic_load_explicit(&_ring->count, memory_order_relaxed);
+    _ring->events[i % AL_TRACE_SIZE] = (struct event) {
+        .ns = (uint64_t) t.tv_sec * 1000000000 + (uint64_t) t.tv_nsec,
+        .name = name,
+        .phase = phase,
+    };
+    atomic_store_explicit(&_ring->count, i + 1, memory_order_release);
+}
+
+static
+void
+_write(FILE *file, struct ring *ring, int pid, bool *first)
+{
+    const size_t count = atomic_load_explicit(
+        &ring->count,
+        memory_order_acquire
+    );
+    // The oldest events may be overwritten while we read; skip a margin.
+    size_t i = 0;
+    if (count > AL_TRACE_SIZE)
+        i = count - AL_TRACE_SIZE + AL_TRACE_SIZE / 16;
+    for (; i < count; i++) {
+        const struct event e = ring->events[i % AL_TRACE_SIZE];
+        fprintf(
+            file,
+            "%s\n{\"name\": \"%s\", \"ph\": \"%c\", "
+                "\"ts\": %" PRIu64 ".%03u, \"pid\": %i, \"tid\": %u%s}",
+            *first ? "" : ",",
+            e.name,
+            e.phase,
+            e.ns / 1000,
+            (unsigned int) (e.ns % 1000),
+            pid,
+            ring->tid,
+            e.phase == 'i' ? ", \"s\": \"t\"" : ""
+        );
+        *first = false;
+    }
+}
+
+#endif
+
+/*
+ * Write the events recorded so far by all threads to a Chrome trace file
+ * at path, or at $AL_TRACE_FILE if path is NULL (if neither, do nothing).
+ * The camera calls this when it is freed. Returns AL_NOTIMPLEMENTED
+ * unless built with TRACE=1.
+ */
+enum al_status
+al_trace_flush(const char *path)
+{
+#if defined(AL_TRACE)
+    if (path == NULL)
+        path = getenv("AL_TRACE_FILE");
+    if (path == NULL)
+        return AL_OK;
+    FILE *file = fopen(path, "w");
+    if (file == NULL) {
+        DEBUG("fopen: %s", strerror(errno));
+        return AL_ERROR;
+    }
+    fprintf(file, "{\"displayTimeUnit\": \"ns\", \"traceEvents\": [");
+    bool first = true;
+    const int pid = (int) getpid();
+    for (struct ring *ring = atomic_load(&_rings); ring; ring = ring->next)
+        _write(file, ring, pid, &first);
+    fprintf(file, "\n]}\n");
+    if (fclose(file) != 0) {
+        DEBUG("fclose: %s", strerror(errno));
+        return AL_ERROR;
+    }
+    return AL_OK;
+#else
+    (void) path;
+    return AL_NOTIMPLEMENTED;
+#endif
+}
@@ -0,0 +1,48 @@
+/* Copyright 2023-2025, Mansour Moufid <mansourmoufid@gmail.com> */
+
+/*
+ * This file is part of Aluminium Library.
+ *
+ * Aluminium Library is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Aluminium Library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with Aluminium Library. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "al.h"
+
+/*
+ * Tracing of the frame pipeline, for chrome://tracing or Perfetto.
+ *
+ * Built with TRACE=1 (-DAL_TRACE), each thread records begin/end and
+ * instant events into its own ring buffer, without locks, and
+ * al_trace_flush writes them all to a Chrome trace (JSON) file. Otherwise
+ * the macros below compile to nothing.
+ *
+ * Names must be string literals (or otherwise outlive the trace).
+ */
+#if defined(AL_TRACE)
+
+void al_trace_event(const char *, char);
+
+#define AL_TRACE_BEGIN(name) al_trace_event((name), 'B')
+#define AL_TRACE_END(name) al_trace_event((name), 'E')
+#define AL_TRACE_INSTANT(name) al_trace_event((name), 'i')
+
+#else
+
+#define AL_TRACE_BEGIN(name) ((void) 0)
+#define AL_TRACE_END(name) ((void) 0)
+#define AL_TRACE_INSTANT(name) ((void) 0)
+
+#endif
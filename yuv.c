@@ -19,6 +19,7 @@ limitations under the License. */
 #endif
 
 #include <assert.h>
+#include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
 
@@ -27,11 +28,14 @@ limitations under the License. */
 #include <string.h>
 #endif
 
+#include "arithmetic.h"
+#include "cpu.h"
+#include "trace.h"
 #include "yuv.h"
 
 static inline
 int32_t
-__attribute__((const))
+__attribute__((always_inline, const))
 min(int32_t a, int32_t b)
 {
     if (a < b)
@@ -42,7 +46,7 @@ min(int32_t a, int32_t b)
 
 static inline
 int32_t
-__attribute__((const))
+__attribute__((always_inline, const))
 max(int32_t a, int32_t b)
 {
     if (a > b)
@@ -53,7 +57,7 @@ max(int32_t a, int32_t b)
 
 static inline
 uint32_t
-__attribute__((const))
+__attribute__((always_inline, const))
 yuv_to_rgb(int32_t y, int32_t u, int32_t v)
 {
     y -= 16;
@@ -74,8 +78,10 @@ yuv_to_rgb(int32_t y, int32_t u, int32_t v)
     return (uint32_t) ((a << 24) | (b << 16) | (g << 8) | r);
 }
 
+static inline
 void
-al_yuv_to_rgba(
+__attribute__((always_inline))
+_yuv_to_rgba(
     const uint8_t *restrict y_data,
     const uint8_t *u_data,
     const uint8_t *v_data,
@@ -122,6 +128,100 @@ al_yuv_to_rgba(
     }
 }
 
+/*
+ * The same conversion, specialized: the chroma layout (uv_pixel_stride 1
+ * for I420, 2 for NV12 and NV21), a width that is a multiple of multiple
+ * (1 for any), and whether the rows of Y and of the output are aligned to
+ * AL_YUV_ALIGNMENT are constants in each instance, so the compiler can
+ * drop the branches, and unroll and vectorize the rows in blocks of
+ * multiple pixels with aligned loads and stores.
+ */
+#define AL_YUV_ALIGNMENT 32
+
+static inline
+void
+__attribute__((always_inline))
+_yuv_to_rgba_specialized(
+    const uint8_t *restrict y_data,
+    const uint8_t *u_data,
+    const uint8_t *v_data,
+    uint32_t *restrict output,
+    const size_t width,
+    const size_t height,
+    const size_t y_stride,
+    const size_t uv_stride,
+    const size_t uv_pixel_stride,
+    const size_t multiple,
+    const bool aligned
+) {
+    assert(y_data != NULL);
+    assert(u_data != NULL);
+    assert(v_data != NULL);
+    assert(output != NULL);
+    assert(width % multiple == 0);
+    // The number of pairs of pixels in a row, a multiple of multiple / 2.
+    const size_t n = multiple > 1 ? width / multiple * (multiple / 2) : width / 2;
+    for (size_t i = 0; i < height; i++) {
+        uint32_t *restrict out = output + i * width;
+        const uint8_t *restrict y = y_data + i * y_stride;
+        const uint8_t *u = u_data + (i / 2) * uv_stride;
+        const uint8_t *v = v_data + (i / 2) * uv_stride;
+        if (aligned) {
+            out = __builtin_assume_aligned(out, AL_YUV_ALIGNMENT);
+            y = __builtin_assume_aligned(y, AL_YUV_ALIGNMENT);
+        }
+        for (size_t j = 0; j < n; j++) {
+            const int32_t uj = u[j * uv_pixel_stride];
+            const int32_t vj = v[j * uv_pixel_stride];
+            out[2 * j + 0] = yuv_to_rgb(y[2 * j + 0], uj, vj);
+            out[2 * j + 1] = yuv_to_rgb(y[2 * j + 1], uj, vj);
+        }
+    }
+}
+
+// The last geometry seen by a thread, and the kernel chosen for it.
+struct geometry {
+    size_t width;
+    size_t uv_pixel_stride;
+    bool aligned;
+    al_yuv_to_rgb_t *kernel;
+};
+
+static inline
+al_yuv_to_rgb_t *
+__attribute__((always_inline))
+_select(
+    al_yuv_to_rgb_t *const kernels[2][3][2],
+    struct geometry *cache,
+    const uint8_t *y_data,
+    const uint32_t *output,
+    const size_t width,
+    const size_t y_stride,
+    const size_t uv_pixel_stride
+) {
+    const bool aligned = (
+        (uintptr_t) y_data
+        | (uintptr_t) output
+        | y_stride
+        | width * sizeof (uint32_t)
+    ) % AL_YUV_ALIGNMENT == 0;
+    if (
+        cache->kernel != NULL
+        && cache->width == width
+        && cache->uv_pixel_stride == uv_pixel_stride
+        && cache->aligned == aligned
+    )
+        return cache->kernel;
+    const size_t m = width % 32 == 0 ? 2 : width % 16 == 0 ? 1 : 0;
+    *cache = (struct geometry) {
+        .width = width,
+        .uv_pixel_stride = uv_pixel_stride,
+        .aligned = aligned,
+        .kernel = kernels[uv_pixel_stride == 2][m][aligned],
+    };
+    return cache->kernel;
+}
+
 #if !defined(DEBUG)
 #define _al_debug_buffer(...) 
 #else
@@ -144,13 +244,15 @@ _al_debug_buffer(const uint8_t *buffer, size_t size)
  *  U0V0U1V1U2V2U3V3        U0U1U2U3
  *                          V0V1V2V3
  */
+static inline
 void
-__attribute__((visibility("hidden")))
-al_yuv_nv12_to_i420(
+__attribute__((always_inline))
+_nv12_to_i420(
     const uint8_t *restrict nv12_data,
     uint8_t *restrict i420_data,
     const size_t width,
-    const size_t height
+    const size_t height,
+    const bool wide
 ) {
     assert(nv12_data != NULL);
     assert(i420_data != NULL);
@@ -163,7 +265,31 @@ al_yuv_nv12_to_i420(
         uint8_t *uv_i420 = i420_data + width * height;
         uint8_t *u_i420 = uv_i420 + (width / 2) * (i / 2);
         uint8_t *v_i420 = uv_i420 + (width / 2) * (height / 2 + i / 2);
-        for (size_t j = 0; j < width / 2; j++) {
+        size_t j = 0;
+#if defined(AL_SIMD)
+        // 32 pixel pairs at a time, in 256-bit vectors.
+        for (; wide && j + 32 <= width / 2; j += 32) {
+            memcpy(y_i420, y_nv12, 64);
+            al_u8x32_unzip(u_i420, v_i420, u_nv12);
+            y_nv12 += 64; y_i420 += 64;
+            u_nv12 += 64; v_nv12 += 64;
+            u_i420 += 32; v_i420 += 32;
+        }
+        // 16 pixel pairs at a time: the Y bytes as they are, the UV
+        // bytes deinterleaved into U and V.
+        for (; j + 16 <= width / 2; j += 16) {
+            const al_u8x16 uv0 = al_u8x16_load(u_nv12);
+            const al_u8x16 uv1 = al_u8x16_load(u_nv12 + 16);
+            al_u8x16_store(y_i420, al_u8x16_load(y_nv12));
+            al_u8x16_store(y_i420 + 16, al_u8x16_load(y_nv12 + 16));
+            al_u8x16_store(u_i420, al_u8x16_unzip_even(uv0, uv1));
+            al_u8x16_store(v_i420, al_u8x16_unzip_odd(uv0, uv1));
+            y_nv12 += 32; y_i420 += 32;
+            u_nv12 += 32; v_nv12 += 32;
+            u_i420 += 16; v_i420 += 16;
+        }
+#endif
+        for (; j < width / 2; j++) {
             _al_debug_buffer(i420_data, width * height * 3 / 2);
             *y_i420++ = *y_nv12++;
             *y_i420++ = *y_nv12++;
@@ -182,13 +308,15 @@ al_yuv_nv12_to_i420(
  *  U0V0U1V1U2V2U3V3        U0U1U2U3
  *                          V0V1V2V3
  */
+static inline
 void
-__attribute__((visibility("hidden")))
-al_yuv_i420_to_nv12(
+__attribute__((always_inline))
+_i420_to_nv12(
     const uint8_t *restrict i420_data,
     uint8_t *restrict nv12_data,
     const size_t width,
-    const size_t height
+    const size_t height,
+    const bool wide
 ) {
     assert(nv12_data != NULL);
     assert(i420_data != NULL);
@@ -201,7 +329,30 @@ al_yuv_i420_to_nv12(
         uint8_t *uv_nv12 = nv12_data + width * height;
         uint8_t *u_nv12 = uv_nv12 + width * (i / 2);
         uint8_t *v_nv12 = uv_nv12 + width * (i / 2) + 1;
-        for (size_t j = 0; j < width / 2; j++) {
+        size_t j = 0;
+#if defined(AL_SIMD)
+        // 32 pixel pairs at a time, in 256-bit vectors.
+        for (; wide && j + 32 <= width / 2; j += 32) {
+            memcpy(y_nv12, y_i420, 64);
+            al_u8x32_zip(u_nv12, u_i420, v_i420);
+            y_i420 += 64; y_nv12 += 64;
+            u_i420 += 32; v_i420 += 32;
+            u_nv12 += 64; v_nv12 += 64;
+        }
+        // 16 pixel pairs at a time: the U and V bytes interleaved.
+        for (; j + 16 <= width / 2; j += 16) {
+            const al_u8x16 u = al_u8x16_load(u_i420);
+            const al_u8x16 v = al_u8x16_load(v_i420);
+            al_u8x16_store(y_nv12, al_u8x16_load(y_i420));
+            al_u8x16_store(y_nv12 + 16, al_u8x16_load(y_i420 + 16));
+            al_u8x16_store(u_nv12, al_u8x16_zip_lo(u, v));
+            al_u8x16_store(u_nv12 + 16, al_u8x16_zip_hi(u, v));
+            y_i420 += 32; y_nv12 += 32;
+            u_i420 += 16; v_i420 += 16;
+            u_nv12 += 32; v_nv12 += 32;
+        }
+#endif
+        for (; j < width / 2; j++) {
             _al_debug_buffer(nv12_data, width * height * 3 / 2);
             *y_nv12++ = *y_i420++;
             *y_nv12++ = *y_i420++;
@@ -212,6 +363,216 @@ al_yuv_i420_to_nv12(
     }
 }
 
+// One instance of _yuv_to_rgba_specialized.
+#define AL_YUV_TO_RGBA_KERNEL(suffix, target, ps, m, a) \
+    static target void _yuv_to_rgba_##suffix##_##ps##_##m##_##a( \
+        const uint8_t *restrict y_data, \
+        const uint8_t *u_data, \
+        const uint8_t *v_data, \
+        uint32_t *restrict output, \
+        const size_t width, \
+        const size_t height, \
+        const size_t y_stride, \
+        const size_t uv_stride, \
+        const size_t y_pixel_stride, \
+        const size_t uv_pixel_stride \
+    ) { \
+        assert(y_pixel_stride == 1); \
+        assert(uv_pixel_stride == ps); \
+        (void) y_pixel_stride; \
+        (void) uv_pixel_stride; \
+        _yuv_to_rgba_specialized( \
+            y_data, u_data, v_data, output, width, height, \
+            y_stride, uv_stride, ps, m, a \
+        ); \
+    }
+
+#define AL_YUV_TO_RGBA_KERNELS(suffix, target, ps) \
+    AL_YUV_TO_RGBA_KERNEL(suffix, target, ps, 1, 0) \
+    AL_YUV_TO_RGBA_KERNEL(suffix, target, ps, 1, 1) \
+    AL_YUV_TO_RGBA_KERNEL(suffix, target, ps, 16, 0) \
+    AL_YUV_TO_RGBA_KERNEL(suffix, target, ps, 16, 1) \
+    AL_YUV_TO_RGBA_KERNEL(suffix, target, ps, 32, 0) \
+    AL_YUV_TO_RGBA_KERNEL(suffix, target, ps, 32, 1)
+
+#define AL_YUV_TO_RGBA_TABLE(suffix, ps) \
+    { \
+        { \
+            _yuv_to_rgba_##suffix##_##ps##_1_0, \
+            _yuv_to_rgba_##suffix##_##ps##_1_1, \
+        }, \
+        { \
+            _yuv_to_rgba_##suffix##_##ps##_16_0, \
+            _yuv_to_rgba_##suffix##_##ps##_16_1, \
+        }, \
+        { \
+            _yuv_to_rgba_##suffix##_##ps##_32_0, \
+            _yuv_to_rgba_##suffix##_##ps##_32_1, \
+        }, \
+    }
+
+/*
+ * The kernels above, compiled for a target: the portable baseline,
+ * or one of the x86 extensions for runtime dispatch (see cpu.c).
+ * The conversion to RGBA picks one of its specialized instances for the
+ * geometry of the frame, and each thread remembers the last choice.
+ * The chroma repacking uses 256-bit vectors if wide (AVX2 and up).
+ */
+#define AL_YUV_VARIANT(suffix, storage, target, wide) \
+    AL_YUV_TO_RGBA_KERNELS(suffix, target, 1) \
+    AL_YUV_TO_RGBA_KERNELS(suffix, target, 2) \
+    static al_yuv_to_rgb_t *const _yuv_to_rgba_kernels_##suffix[2][3][2] = { \
+        AL_YUV_TO_RGBA_TABLE(suffix, 1), \
+        AL_YUV_TO_RGBA_TABLE(suffix, 2), \
+    }; \
+    static _Thread_local struct geometry _yuv_to_rgba_cache_##suffix; \
+    storage target void _al_yuv_to_rgba_##suffix( \
+        const uint8_t *restrict y_data, \
+        const uint8_t *u_data, \
+        const uint8_t *v_data, \
+        uint32_t *restrict output, \
+        const size_t width, \
+        const size_t height, \
+        const size_t y_stride, \
+        const size_t uv_stride, \
+        const size_t y_pixel_stride, \
+        const size_t uv_pixel_stride \
+    ) { \
+        assert(y_pixel_stride == 1); \
+        assert(uv_pixel_stride == 1 || uv_pixel_stride == 2); \
+        _select( \
+            _yuv_to_rgba_kernels_##suffix, \
+            &_yuv_to_rgba_cache_##suffix, \
+            y_data, output, width, y_stride, uv_pixel_stride \
+        )( \
+            y_data, u_data, v_data, output, width, height, \
+            y_stride, uv_stride, y_pixel_stride, uv_pixel_stride \
+        ); \
+    } \
+    storage target void _al_yuv_nv12_to_i420_##suffix( \
+        const uint8_t *restrict nv12_data, \
+        uint8_t *restrict i420_data, \
+        const size_t width, \
+        const size_t height \
+    ) { \
+        _nv12_to_i420(nv12_data, i420_data, width, height, wide); \
+    } \
+    storage target void _al_yuv_i420_to_nv12_##suffix( \
+        const uint8_t *restrict i420_data, \
+        uint8_t *restrict nv12_data, \
+        const size_t width, \
+        const size_t height \
+    ) { \
+        _i420_to_nv12(i420_data, nv12_data, width, height, wide); \
+    }
+
+AL_YUV_VARIANT(scalar, __attribute__((visibility("hidden"))), , false)
+
+#if defined(__x86_64__) || defined(__i386__)
+AL_YUV_VARIANT(sse4_2, static, __attribute__((target("sse4.2"))), false)
+AL_YUV_VARIANT(avx2, static, __attribute__((target("avx2"))), true)
+AL_YUV_VARIANT(avx512, static, __attribute__((target("avx512f,avx512bw"))), true)
+#endif
+
+// The plain conversion, the reference for the specialized ones.
+__attribute__((visibility("hidden")))
+void
+_al_yuv_to_rgba_generic(
+    const uint8_t *restrict y_data,
+    const uint8_t *u_data,
+    const uint8_t *v_data,
+    uint32_t *restrict output,
+    const size_t width,
+    const size_t height,
+    const size_t y_stride,
+    const size_t uv_stride,
+    const size_t y_pixel_stride,
+    const size_t uv_pixel_stride
+) {
+    _yuv_to_rgba(
+        y_data, u_data, v_data, output, width, height,
+        y_stride, uv_stride, y_pixel_stride, uv_pixel_stride
+    );
+}
+
+#define AL_YUV_VARIANT_ENTRY(suffix, check) \
+    { \
+        .name = #suffix, \
+        .supported = check, \
+        .to_rgba = _al_yuv_to_rgba_##suffix, \
+        .nv12_to_i420 = _al_yuv_nv12_to_i420_##suffix, \
+        .i420_to_nv12 = _al_yuv_i420_to_nv12_##suffix, \
+    }
+
+__attribute__((visibility("hidden")))
+const struct al_yuv_variant al_yuv_variants[] = {
+    AL_YUV_VARIANT_ENTRY(scalar, NULL),
+#if defined(__x86_64__) || defined(__i386__)
+    AL_YUV_VARIANT_ENTRY(sse4_2, al_cpu_sse4_2),
+    AL_YUV_VARIANT_ENTRY(avx2, al_cpu_avx2),
+    AL_YUV_VARIANT_ENTRY(avx512, al_cpu_avx512),
+#endif
+};
+
+__attribute__((visibility("hidden")))
+const size_t al_yuv_variants_count =
+    sizeof (al_yuv_variants) / sizeof (al_yuv_variants[0]);
+
+void
+al_yuv_to_rgba(
+    const uint8_t *restrict y_data,
+    const uint8_t *u_data,
+    const uint8_t *v_data,
+    uint32_t *restrict output,
+    const size_t width,
+    const size_t height,
+    const size_t y_stride,
+    const size_t uv_stride,
+    const size_t y_pixel_stride,
+    const size_t uv_pixel_stride
+) {
+    AL_TRACE_BEGIN("al_yuv_to_rgba");
+    al_kernels.to_rgba(
+        y_data,
+        u_data,
+        v_data,
+        output,
+        width,
+        height,
+        y_stride,
+        uv_stride,
+        y_pixel_stride,
+        uv_pixel_stride
+    );
+    AL_TRACE_END("al_yuv_to_rgba");
+}
+
+void
+__attribute__((visibility("hidden")))
+al_yuv_nv12_to_i420(
+    const uint8_t *restrict nv12_data,
+    uint8_t *restrict i420_data,
+    const size_t width,
+    const size_t height
+) {
+    AL_TRACE_BEGIN("al_yuv_nv12_to_i420");
+    al_kernels.nv12_to_i420(nv12_data, i420_data, width, height);
+    AL_TRACE_END("al_yuv_nv12_to_i420");
+}
+
+void
+__attribute__((visibility("hidden")))
+al_yuv_i420_to_nv12(
+    const uint8_t *restrict i420_data,
+    uint8_t *restrict nv12_data,
+    const size_t width,
+    const size_t height
+) {
+    AL_TRACE_BEGIN("al_yuv_i420_to_nv12");
+    al_kernels.i420_to_nv12(i420_data, nv12_data, width, height);
+    AL_TRACE_END("al_yuv_i420_to_nv12");
+}
+
 #if defined(TEST)
 
 #include <stdint.h> // uint8_t
@@ -249,6 +610,83 @@ main(void)
     al_yuv_i420_to_nv12(i420, buffer, 4, 4);
     assert(memcmp(buffer, nv12, sizeof(nv12)) == 0);
 
+    // Wide enough for the vector loops, and back again.
+    uint8_t wide[70 * 2 * 3 / 2], planar[sizeof(wide)], packed[sizeof(wide)];
+    for (size_t i = 0; i < sizeof(wide); i++)
+        wide[i] = (uint8_t) (i * 7 + 3);
+    al_yuv_nv12_to_i420(wide, planar, 70, 2);
+    assert(planar[70 * 2 + 34] == wide[70 * 2 + 68]);
+    assert(planar[70 * 2 + 35 + 34] == wide[70 * 2 + 69]);
+    al_yuv_i420_to_nv12(planar, packed, 70, 2);
+    assert(memcmp(packed, wide, sizeof(wide)) == 0);
+
+#if defined(AL_SIMD)
+    al_u8x16 a, b;
+    for (int i = 0; i < 16; i++) {
+        a[i] = (uint8_t) i;
+        b[i] = (uint8_t) (16 + i);
+    }
+    const al_u8x16 lo = al_u8x16_zip_lo(a, b);
+    const al_u8x16 hi = al_u8x16_zip_hi(a, b);
+    for (int i = 0; i < 8; i++) {
+        assert(lo[2 * i] == i && lo[2 * i + 1] == 16 + i);
+        assert(hi[2 * i] == 8 + i && hi[2 * i + 1] == 24 + i);
+    }
+    const al_u8x16 even = al_u8x16_unzip_even(lo, hi);
+    const al_u8x16 odd = al_u8x16_unzip_odd(lo, hi);
+    for (int i = 0; i < 16; i++) {
+        assert(even[i] == a[i] && odd[i] == b[i]);
+    }
+    const al_i16x8 a_lo = al_u8x16_widen_lo(b);
+    const al_i16x8 a_hi = al_u8x16_widen_hi(b);
+    for (int i = 0; i < 8; i++) {
+        assert(a_lo[i] == 16 + i && a_hi[i] == 24 + i);
+    }
+    const al_i16x8 x = {-300, 300, 32767, -32768, 1, -1, 0, 255};
+    const al_i16x8 y = {300, 300, 32767, -32768, -1, -1, 5, 255};
+    const al_i32x4 xy_lo = al_i16x8_mul_widen_lo(x, y);
+    const al_i32x4 xy_hi = al_i16x8_mul_widen_hi(x, y);
+    for (int i = 0; i < 4; i++) {
+        assert(xy_lo[i] == (int32_t) x[i] * y[i]);
+        assert(xy_hi[i] == (int32_t) x[4 + i] * y[4 + i]);
+    }
+    const al_i16x8 s = al_i32x4_pack_i16(xy_lo, xy_hi);
+    const int16_t s_expected[] = {-32768, 32767, 32767, 32767, -1, 1, 0, 32767};
+    for (int i = 0; i < 8; i++) {
+        assert(s[i] == s_expected[i]);
+    }
+    const al_u8x16 u = al_i16x8_pack_u8(x, y);
+    const uint8_t u_expected[] = {
+        0, 255, 255, 0, 1, 0, 0, 255,
+        255, 255, 255, 0, 0, 0, 5, 255,
+    };
+    for (int i = 0; i < 16; i++) {
+        assert(u[i] == u_expected[i]);
+    }
+    al_u8x16 index;
+    for (int i = 0; i < 16; i++)
+        index[i] = (uint8_t) (15 - i);
+    index[0] = 16;
+    index[1] = 200;
+    const al_u8x16 r = al_u8x16_shuffle(b, index);
+    assert(r[0] == 0 && r[1] == 0);
+    for (int i = 2; i < 16; i++) {
+        assert(r[i] == b[15 - i]);
+    }
+    assert(al_u8x16_hadd(al_u8x16_splat(255)) == 255 * 16);
+    assert(al_u8x16_hadd(a) == 120);
+    assert(al_u32x4_hadd((al_u32x4) {1, 2, 3, 0xfffffff0}) == 0xfffffff6);
+    uint8_t pairs[64], evens[32], odds[32], zipped[64];
+    for (int i = 0; i < 64; i++)
+        pairs[i] = (uint8_t) i;
+    al_u8x32_unzip(evens, odds, pairs);
+    for (int i = 0; i < 32; i++) {
+        assert(evens[i] == 2 * i && odds[i] == 2 * i + 1);
+    }
+    al_u8x32_zip(zipped, evens, odds);
+    assert(memcmp(zipped, pairs, sizeof(pairs)) == 0);
+#endif
+
     return 0;
 }
 
@@ -2,6 +2,10 @@
 
 #pragma once
 
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
 typedef void (al_yuv_to_rgb_t)(
     const uint8_t *restrict,
     const uint8_t *,
@@ -26,3 +30,25 @@ typedef void (al_yuv_to_yuv_t)(
 
 al_yuv_to_yuv_t al_yuv_nv12_to_i420;
 al_yuv_to_yuv_t al_yuv_i420_to_nv12;
+
+/*
+ * Implementations of the kernels above, for the conformance tests and the
+ * dispatcher. The first variant is the portable scalar code, which is the
+ * reference for the others. A variant sets supported if it needs a CPU
+ * feature, and leaves a kernel NULL if it does not provide it.
+ */
+struct al_yuv_variant {
+    const char *name;
+    bool (*supported)(void);
+    al_yuv_to_rgb_t *to_rgba;
+    al_yuv_to_yuv_t *nv12_to_i420;
+    al_yuv_to_yuv_t *i420_to_nv12;
+};
+
+extern const struct al_yuv_variant al_yuv_variants[];
+extern const size_t al_yuv_variants_count;
+
+al_yuv_to_rgb_t _al_yuv_to_rgba_generic;
+al_yuv_to_rgb_t _al_yuv_to_rgba_scalar;
+al_yuv_to_yuv_t _al_yuv_nv12_to_i420_scalar;
+al_yuv_to_yuv_t _al_yuv_i420_to_nv12_scalar;